@@ -0,0 +1,628 @@
+/**
+ * @file    adc_acq.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Free running acquisition of the master ADC inputs
+ *
+ * @details The ADC converts ADC0, ADC1, VSYS and the internal temperature in round robin.
+ *          The samples are moved by DMA from the ADC FIFO to a ring buffer without CPU load.
+ *          A measure read the last sample of the input from the ring, a statistic
+ *          (mean, min, max, standard deviation) is computed on the next samples of the input
+ *          with integer accumulation, the conversion to voltage is done only on the result.
+ *          A triggered capture of ADC0 or ADC1 take the ADC for a waveform acquisition up
+ *          to 500 kS/s, the free running acquisition is restarted at the end of the capture.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+#include "include/functadv.h"
+#include "include/adc_acq.h"
+#include "include/adc_cal.h"
+
+/**
+ * @brief Ring buffer written by DMA, aligned on its size for the DMA ring wrap.
+ */
+static uint16_t adc_ring[ADC_ACQ_RING] __attribute__((aligned(ADC_ACQ_RING * sizeof(uint16_t))));
+
+/**
+ * @brief ADC input converted on each slot of the round robin.
+ */
+static const uint8_t adc_order[ADC_ACQ_NB_CH] = {0, 1, 3, 4};
+
+/**
+ * @brief Capture buffer written by DMA, aligned on its size for the DMA ring wrap.
+ */
+static uint16_t cap_ring[ADC_CAP_RING] __attribute__((aligned(ADC_CAP_RING * sizeof(uint16_t))));
+
+/**
+ * @brief State of the acquisition engine.
+ */
+static struct
+{
+  int dma_ch;                     // DMA channel reading the ADC FIFO
+  bool irq_installed;             // DMA interrupt handler added
+  volatile uint8_t mode;          // ADC_MODE_OFF, ADC_MODE_FREE or ADC_MODE_CAPTURE
+  volatile uint32_t reload;       // number of transfer count reload
+  uint32_t avg_count;             // default number of samples used by measure (SENSe:AVERage:COUNt)
+  uint16_t last[ADC_ACQ_NB_CH];   // last samples of free running acquisition, used during capture
+} acq = {-1, false, ADC_MODE_OFF, 0, ADC_ACQ_DEF_COUNT, {0, 0, 0, 0}};
+
+/**
+ * @brief State of the triggered capture.
+ */
+static struct
+{
+  adc_cap_cfg_t cfg[2];        // configuration of ADC0 and ADC1
+  uint8_t channel;             // channel captured
+  volatile uint8_t state;      // ADC_CAP_IDLE, ADC_CAP_ARMED, ADC_CAP_TRIGGERED or ADC_CAP_DONE
+  volatile uint32_t trig_pos;  // sample index of the trigger
+  uint32_t scan_pos;           // next sample checked for level trigger
+  uint32_t start;              // sample index of first point returned
+  uint32_t points;             // number of points of the capture
+  uint16_t level;              // level trigger on ADC count
+  repeating_timer_t timer;     // timer checking trigger and end of capture
+} cap = {.cfg = {{ADC_CAP_DEF_RATE, ADC_CAP_DEF_POINTS, 0, ADC_TRIG_IMM, 0, 0},
+                 {ADC_CAP_DEF_RATE, ADC_CAP_DEF_POINTS, 0, ADC_TRIG_IMM, 0, 0}}};
+
+/**
+ * @brief DMA interrupt, reload the transfer count for a continuous acquisition.
+ *        The write address continue on the ring.
+ */
+static void adc_acq_dma_irq(void)
+{
+  if (acq.dma_ch < 0 || !dma_channel_get_irq0_status(acq.dma_ch)) return;  // shared interrupt
+
+  dma_channel_acknowledge_irq0(acq.dma_ch);
+  acq.reload++;
+  dma_channel_set_trans_count(acq.dma_ch, ADC_ACQ_DMA_COUNT, true);
+}
+
+/**
+ * @brief Return the number of samples written since the start of the acquisition
+ *
+ * @return uint32_t  Index of the next sample to be written (modulo 2^32)
+ */
+static uint32_t adc_acq_head(void)
+{
+  uint32_t reload, remain;
+
+  do
+  {  // read again if the count is reloaded during the read
+    reload = acq.reload;
+    remain = dma_channel_hw_addr(acq.dma_ch)->transfer_count;
+  } while (reload != acq.reload);
+
+  return reload * ADC_ACQ_DMA_COUNT + (ADC_ACQ_DMA_COUNT - remain);
+}
+
+/**
+ * @brief Return the slot of an ADC input on the round robin
+ *
+ * @param channel  ADC input (0,1,3 or 4)
+ * @return int     Slot number, -1 if the input is not on the round robin
+ */
+static int adc_acq_slot(uint8_t channel)
+{
+  for (int i = 0; i < ADC_ACQ_NB_CH; i++)
+  {
+    if (adc_order[i] == channel) return i;
+  }
+  return -1;
+}
+
+/**
+ * @brief Claim the DMA channel and install the DMA interrupt
+ *
+ * @return true   DMA channel available
+ */
+static bool adc_acq_claim(void)
+{
+  if (acq.dma_ch < 0)
+  {
+    acq.dma_ch = dma_claim_unused_channel(false);
+    if (acq.dma_ch < 0) return false;  // no DMA channel available
+  }
+
+  if (!acq.irq_installed)
+  {
+    irq_add_shared_handler(DMA_IRQ_0, adc_acq_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    acq.irq_installed = true;
+  }
+  return true;
+}
+
+/**
+ * @brief Start the DMA transfer from ADC FIFO to a ring buffer and start the ADC
+ *
+ * @param ring       Ring buffer, aligned on its size
+ * @param ring_bits  Size of the ring in bytes, power of 2
+ */
+static void adc_acq_dma_run(uint16_t* ring, uint ring_bits)
+{
+  dma_channel_config cfg = dma_channel_get_default_config(acq.dma_ch);
+  channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+  channel_config_set_read_increment(&cfg, false);
+  channel_config_set_write_increment(&cfg, true);
+  channel_config_set_ring(&cfg, true, ring_bits);  // wrap write address on the ring
+  channel_config_set_dreq(&cfg, DREQ_ADC);
+
+  adc_fifo_setup(true, true, 1, false, false);  // DREQ on each sample, 12 bits value
+  adc_fifo_drain();
+
+  acq.reload = 0;
+  dma_channel_acknowledge_irq0(acq.dma_ch);
+  dma_channel_set_irq0_enabled(acq.dma_ch, true);
+  dma_channel_configure(acq.dma_ch, &cfg, ring, &adc_hw->fifo, ADC_ACQ_DMA_COUNT, true);
+  adc_run(true);
+}
+
+/**
+ * @brief Stop the ADC and the DMA transfer
+ */
+static void adc_acq_halt(void)
+{
+  adc_run(false);
+  dma_channel_set_irq0_enabled(acq.dma_ch, false);  // abort could raise the completion interrupt
+  dma_channel_abort(acq.dma_ch);
+  dma_channel_acknowledge_irq0(acq.dma_ch);
+  adc_set_round_robin(0);
+  adc_fifo_setup(false, false, 0, false, false);
+  adc_fifo_drain();
+}
+
+/**
+ * @brief Configure the round robin and run the free running acquisition
+ */
+static void adc_acq_free_run(void)
+{
+  adc_set_temp_sensor_enabled(true);
+  adc_select_input(adc_order[0]);  // round robin start on first slot
+  adc_set_round_robin(ADC_ACQ_RR_MASK);
+  adc_set_clkdiv(ADC_CLOCK / ADC_ACQ_RATE - 1);
+  acq.mode = ADC_MODE_FREE;
+  adc_acq_dma_run(adc_ring, ADC_ACQ_RING_BITS);
+}
+
+/**
+ * @brief Disable the GPIO interrupt used as trigger
+ */
+static void adc_cap_gpio_off(void)
+{
+  const adc_cap_cfg_t* c = &cap.cfg[cap.channel];
+
+  if (c->source == ADC_TRIG_GPIO_RISE || c->source == ADC_TRIG_GPIO_FALL)
+  {
+    gpio_set_irq_enabled(c->pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, false);
+  }
+}
+
+/**
+ * @brief Start the free running acquisition of ADC0, ADC1, VSYS and temperature.
+ *        adc_init() must be called before.
+ *
+ * @return true   Acquisition is running
+ * @return false  No DMA channel available
+ */
+bool adc_acq_start(void)
+{
+  if (acq.mode != ADC_MODE_OFF) return true;
+  if (!adc_acq_claim()) return false;
+
+  adc_run(false);
+  adc_acq_free_run();
+  fprintf(stdout, "ADC acquisition started on DMA channel %d\n", acq.dma_ch);
+  return true;
+}
+
+/**
+ * @brief Stop the free running acquisition or the capture, the ADC is free for single conversion.
+ */
+void adc_acq_stop(void)
+{
+  if (acq.mode == ADC_MODE_OFF) return;
+
+  if (acq.mode == ADC_MODE_CAPTURE)
+  {
+    cancel_repeating_timer(&cap.timer);
+    adc_cap_gpio_off();
+    cap.state = ADC_CAP_IDLE;
+  }
+  adc_acq_halt();
+  acq.mode = ADC_MODE_OFF;
+}
+
+/**
+ * @brief Return the state of the acquisition
+ *
+ * @return true   ADC is used by the free running acquisition or by a capture
+ */
+bool adc_acq_running(void)
+{
+  return acq.mode != ADC_MODE_OFF;
+}
+
+/**
+ * @brief Return the last sample of an ADC input. The acquisition must be running.
+ *
+ * @param channel    ADC input (0,1,3 or 4)
+ * @return uint16_t  Raw 12 bits value
+ */
+uint16_t adc_acq_last(uint8_t channel)
+{
+  int slot = adc_acq_slot(channel);
+  uint32_t head, pos;
+
+  if (slot < 0 || acq.mode == ADC_MODE_OFF) return 0;
+  if (acq.mode == ADC_MODE_CAPTURE) return acq.last[slot];  // value before the capture
+
+  do
+  {  // wait the first round after the start
+    head = adc_acq_head();
+  } while (head < ADC_ACQ_NB_CH);
+
+  pos = head - 1;
+  pos -= (pos - slot) % ADC_ACQ_NB_CH;  // last position of the input on the round robin
+
+  return adc_ring[pos % ADC_ACQ_RING] & 0xfff;
+}
+
+/**
+ * @brief Convert a raw ADC value (could be an average) on unit of the input
+ *
+ * @param channel  ADC input (0,1,3 or 4)
+ * @param raw      Raw value on ADC count
+ * @return float   Voltage for ADC0/ADC1/VSYS, Celsius for temperature
+ */
+float adc_acq_convert(uint8_t channel, float raw)
+{
+  return adc_cal_convert_float(channel, raw);  // calibration of the input applied
+}
+
+/**
+ * @brief Compute the statistic on the next samples of an ADC input.
+ *        The samples are accumulated as integer, conversion is done on the result.
+ *
+ * @param channel   ADC input (0,1,3 or 4)
+ * @param count     Number of samples (1 to ADC_ACQ_MAX_COUNT)
+ * @param st        Pointer on statistic returned
+ * @return uint8_t  NOERR if statistic is valid, EOOR if parameter out of range, EDE if acquisition failed
+ */
+uint8_t adc_acq_stat(uint8_t channel, uint32_t count, adc_stat_t* st)
+{
+  int slot = adc_acq_slot(channel);
+  uint32_t pos, head, n = 0;
+  uint32_t sum = 0;
+  uint64_t sumsq = 0;
+  uint16_t v, vmin = 0xffff, vmax = 0;
+  float mean, var, lo, hi;
+  absolute_time_t until;
+
+  if (slot < 0 || count < 1 || count > ADC_ACQ_MAX_COUNT) return EOOR;
+  if (acq.mode != ADC_MODE_FREE) return EDE;
+
+  pos = adc_acq_head();
+  pos += (slot - pos % ADC_ACQ_NB_CH + ADC_ACQ_NB_CH) % ADC_ACQ_NB_CH;  // first new sample of the input
+
+  // time of acquisition with 100 ms of margin
+  until = make_timeout_time_ms((uint64_t)count * ADC_ACQ_NB_CH * 1000 / ADC_ACQ_RATE + 100);
+
+  while (n < count)
+  {
+    head = adc_acq_head();
+    while ((int32_t)(head - pos) > 0 && n < count)
+    {
+      v = adc_ring[pos % ADC_ACQ_RING] & 0xfff;
+      sum += v;
+      sumsq += (uint32_t)v * v;
+      if (v < vmin) vmin = v;
+      if (v > vmax) vmax = v;
+      pos += ADC_ACQ_NB_CH;
+      n++;
+    }
+    if (n < count && time_reached(until)) return EDE;  // acquisition is stopped
+  }
+
+  mean = (float)sum / n;
+  var = (n > 1) ? (float)((double)(sumsq - (uint64_t)sum * sum / n) / (n - 1)) : 0;
+
+  lo = adc_acq_convert(channel, vmin);
+  hi = adc_acq_convert(channel, vmax);
+  st->mean = adc_acq_convert(channel, mean);
+  st->min = min(lo, hi);  // temperature slope is negative
+  st->max = (lo > hi) ? lo : hi;
+  st->stddev = sqrtf(var) * fabsf(adc_acq_convert(channel, 1) - adc_acq_convert(channel, 0));
+
+  return NOERR;
+}
+
+/**
+ * @brief Set the default number of samples used by the ADC measure
+ *
+ * @param count     Number of samples (1 to ADC_ACQ_MAX_COUNT)
+ * @return uint8_t  NOERR or EOOR if out of range
+ */
+uint8_t adc_acq_set_count(uint32_t count)
+{
+  if (count < 1 || count > ADC_ACQ_MAX_COUNT) return EOOR;
+  acq.avg_count = count;
+  return NOERR;
+}
+
+/**
+ * @brief Return the default number of samples used by the ADC measure
+ *
+ * @return uint32_t  Number of samples
+ */
+uint32_t adc_acq_get_count(void)
+{
+  return acq.avg_count;
+}
+
+/**
+ * @brief Trigger the capture at the last sample acquired.
+ *        The trigger is delayed if the pre-trigger points are not yet acquired.
+ */
+static void adc_cap_trigger_now(void)
+{
+  uint32_t head = adc_acq_head();
+  uint32_t pre = cap.cfg[cap.channel].pretrig;
+
+  cap.trig_pos = (head > pre) ? head : pre;
+  cap.state = ADC_CAP_TRIGGERED;
+}
+
+/**
+ * @brief GPIO interrupt, edge detected on the trigger GPIO
+ *
+ * @param gpio    GPIO number
+ * @param events  Edge detected
+ */
+static void adc_cap_gpio_irq(uint gpio, uint32_t events)
+{
+  if (acq.mode != ADC_MODE_CAPTURE || cap.state != ADC_CAP_ARMED || gpio != cap.cfg[cap.channel].pin) return;
+
+  adc_cap_trigger_now();
+  adc_cap_gpio_off();
+}
+
+/**
+ * @brief Timer callback, search the level trigger on new samples and stop the capture
+ *        when all post-trigger points are acquired. The free running acquisition is restarted.
+ *
+ * @param rt       Repeating timer
+ * @return true    Capture not completed, timer continue
+ * @return false   Capture completed, timer stopped
+ */
+static bool adc_cap_poll(repeating_timer_t* rt)
+{
+  const adc_cap_cfg_t* c = &cap.cfg[cap.channel];
+  uint32_t head = adc_acq_head();
+  uint16_t prev, cur;
+
+  if (cap.state == ADC_CAP_ARMED && (c->source == ADC_TRIG_RISE || c->source == ADC_TRIG_FALL))
+  {
+    while ((int32_t)(head - cap.scan_pos) > 0)
+    {
+      prev = cap_ring[(cap.scan_pos - 1) % ADC_CAP_RING];
+      cur = cap_ring[cap.scan_pos % ADC_CAP_RING];
+      if ((c->source == ADC_TRIG_RISE && prev < cap.level && cur >= cap.level) ||
+          (c->source == ADC_TRIG_FALL && prev > cap.level && cur <= cap.level))
+      {
+        cap.trig_pos = cap.scan_pos;
+        cap.state = ADC_CAP_TRIGGERED;
+        break;
+      }
+      cap.scan_pos++;
+    }
+  }
+
+  if (cap.state == ADC_CAP_TRIGGERED && (int32_t)(head - cap.trig_pos) >= (int32_t)(cap.points - c->pretrig))
+  {
+    adc_acq_halt();
+    cap.start = cap.trig_pos - c->pretrig;
+    cap.state = ADC_CAP_DONE;
+    adc_acq_free_run();  // ADC is returned to the measure of all inputs
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Event from relay command, trigger the capture if the source is ADC_TRIG_RELAY
+ */
+void adc_acq_event(void)
+{
+  if (acq.mode == ADC_MODE_CAPTURE && cap.state == ADC_CAP_ARMED && cap.cfg[cap.channel].source == ADC_TRIG_RELAY)
+  {
+    adc_cap_trigger_now();
+  }
+}
+
+/**
+ * @brief Set the sample rate of the capture
+ *
+ * @param channel   ADC input (0 or 1)
+ * @param rate      Sample rate in sample/s (ADC_CAP_MIN_RATE to ADC_CAP_MAX_RATE)
+ * @return uint8_t  NOERR or EOOR if out of range
+ */
+uint8_t adc_cap_set_rate(uint8_t channel, uint32_t rate)
+{
+  if (channel > 1 || rate < ADC_CAP_MIN_RATE || rate > ADC_CAP_MAX_RATE) return EOOR;
+  cap.cfg[channel].rate = rate;
+  return NOERR;
+}
+
+/**
+ * @brief Set the number of points of the capture
+ *
+ * @param channel   ADC input (0 or 1)
+ * @param points    Number of points (1 to ADC_CAP_MAX_POINTS)
+ * @return uint8_t  NOERR or EOOR if out of range
+ */
+uint8_t adc_cap_set_points(uint8_t channel, uint32_t points)
+{
+  if (channel > 1 || points < 1 || points > ADC_CAP_MAX_POINTS) return EOOR;
+  cap.cfg[channel].points = points;
+  return NOERR;
+}
+
+/**
+ * @brief Set the number of points acquired before the trigger
+ *
+ * @param channel   ADC input (0 or 1)
+ * @param pretrig   Number of points, must be lower than the number of points
+ * @return uint8_t  NOERR or EOOR if out of range
+ */
+uint8_t adc_cap_set_pretrig(uint8_t channel, uint32_t pretrig)
+{
+  if (channel > 1 || pretrig >= ADC_CAP_MAX_POINTS) return EOOR;
+  cap.cfg[channel].pretrig = pretrig;
+  return NOERR;
+}
+
+/**
+ * @brief Set the trigger of the capture
+ *
+ * @param channel   ADC input (0 or 1)
+ * @param source    Trigger source (ADC_TRIG_xxx)
+ * @param level     Level in Volt for a level trigger
+ * @param pin       GPIO for a GPIO trigger
+ * @return uint8_t  NOERR or EOOR if out of range
+ */
+uint8_t adc_cap_set_trigger(uint8_t channel, uint8_t source, float level, uint8_t pin)
+{
+  if (channel > 1 || source > ADC_TRIG_RELAY) return EOOR;
+  if ((source == ADC_TRIG_RISE || source == ADC_TRIG_FALL) && (level <= 0 || level >= ADC_REF)) return EOOR;
+  if ((source == ADC_TRIG_GPIO_RISE || source == ADC_TRIG_GPIO_FALL) && pin > 28) return EOOR;
+
+  cap.cfg[channel].source = source;
+  cap.cfg[channel].level = level;
+  cap.cfg[channel].pin = pin;
+  return NOERR;
+}
+
+/**
+ * @brief Return the configuration of the capture
+ *
+ * @param channel               ADC input (0 or 1)
+ * @return const adc_cap_cfg_t* Configuration, NULL if channel is not valid
+ */
+const adc_cap_cfg_t* adc_cap_get_cfg(uint8_t channel)
+{
+  return (channel > 1) ? NULL : &cap.cfg[channel];
+}
+
+/**
+ * @brief Start the capture of an ADC input. The free running acquisition is stopped
+ *        until the end of the capture, the last values are used by the ADC measure.
+ *
+ * @param channel   ADC input (0 or 1)
+ * @return uint8_t  NOERR, EOOR if configuration not valid, EDE if DMA or timer not available
+ */
+uint8_t adc_cap_init(uint8_t channel)
+{
+  const adc_cap_cfg_t* c;
+
+  if (channel > 1) return EOOR;
+  c = &cap.cfg[channel];
+  if (c->pretrig >= c->points) return EOOR;
+  if (!adc_acq_claim()) return EDE;
+
+  if (acq.mode == ADC_MODE_CAPTURE) adc_acq_stop();  // new capture replace the previous one
+  if (acq.mode == ADC_MODE_FREE)
+  {
+    for (int i = 0; i < ADC_ACQ_NB_CH; i++)
+    {
+      acq.last[i] = adc_acq_last(adc_order[i]);  // keep the last values for the measure during capture
+    }
+    adc_acq_halt();
+  }
+
+  setup_ADC(true);  // ADC0 and ADC1 on analog function
+  cap.channel = channel;
+  cap.points = c->points;
+  cap.level = adc_cal_to_raw(channel, c->level);  // level on calibrated scale, as the capture data
+  cap.scan_pos = (c->pretrig > 0) ? c->pretrig : 1;  // level is searched after the pre-trigger points
+  cap.trig_pos = c->pretrig;
+  cap.state = (c->source == ADC_TRIG_IMM) ? ADC_CAP_TRIGGERED : ADC_CAP_ARMED;
+
+  adc_select_input(channel);
+  adc_set_clkdiv(ADC_CLOCK / c->rate - 1);
+  acq.mode = ADC_MODE_CAPTURE;
+  adc_acq_dma_run(cap_ring, ADC_CAP_RING_BITS);
+
+  if (c->source == ADC_TRIG_GPIO_RISE || c->source == ADC_TRIG_GPIO_FALL)
+  {
+    gpio_set_irq_enabled_with_callback(c->pin, (c->source == ADC_TRIG_GPIO_RISE) ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL,
+                                       true, adc_cap_gpio_irq);
+  }
+
+  if (!add_repeating_timer_us(-ADC_CAP_POLL_US, adc_cap_poll, NULL, &cap.timer))
+  {
+    adc_cap_abort();
+    return EDE;  // no timer available
+  }
+
+  fprintf(stdout, "ADC%d capture started: %lu points at %lu S/s, pre-trigger %lu\n", channel, c->points, c->rate,
+          c->pretrig);
+  return NOERR;
+}
+
+/**
+ * @brief Abort the capture and restart the free running acquisition
+ */
+void adc_cap_abort(void)
+{
+  if (acq.mode == ADC_MODE_CAPTURE)
+  {
+    adc_acq_stop();
+    adc_acq_start();
+  }
+}
+
+/**
+ * @brief Return the state of the capture
+ *
+ * @return uint8_t  ADC_CAP_IDLE, ADC_CAP_ARMED, ADC_CAP_TRIGGERED or ADC_CAP_DONE
+ */
+uint8_t adc_cap_state(void)
+{
+  return cap.state;
+}
+
+/**
+ * @brief Return the points of the completed capture. The points are on the ring buffer,
+ *        the data is returned in 2 parts if the capture wrap on the end of the ring.
+ *
+ * @param channel   ADC input (0 or 1)
+ * @param p1        First part of the data
+ * @param n1        Number of points on first part
+ * @param p2        Second part of the data
+ * @param n2        Number of points on second part (0 if no wrap)
+ * @return uint8_t  NOERR or EDE if no capture completed on the channel
+ */
+uint8_t adc_cap_data(uint8_t channel, const uint16_t** p1, uint32_t* n1, const uint16_t** p2, uint32_t* n2)
+{
+  uint32_t first;
+
+  if (cap.state != ADC_CAP_DONE || channel != cap.channel) return EDE;
+
+  first = cap.start % ADC_CAP_RING;
+  *p1 = &cap_ring[first];
+  *n1 = min(cap.points, ADC_CAP_RING - first);
+  *p2 = cap_ring;
+  *n2 = cap.points - *n1;
+  return NOERR;
+}
@@ -0,0 +1,333 @@
+/**
+ * @file    adc_cal.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Calibration of the ADC inputs of the Master Pico
+ *
+ * @details Gain and offset of each input are kept on a record protected by CRC on the
+ *          parameter store of the configuration eeprom. The record is loaded at boot and the coefficients are folded
+ *          with the nominal conversion (ADC_REF, temperature sensor constants) in one scale and
+ *          one base, a calibrated conversion has the cost of the nominal conversion.
+ *          The auto-calibration of ADC0 and ADC1 use two DAC levels, the DAC output must be
+ *          connected to the ADC input.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/sync.h"
+#include "include/functadv.h"
+#include "include/adc_acq.h"
+#include "include/adc_cal.h"
+#include "include/ee_log.h"
+#include "pico_lib2/src/dev/dev_24lc32/dev_24lc32.h"
+#include "pico_lib2/src/dev/dev_mcp4725/dev_mcp4725.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
+
+#define ADC_CAL_ACQ_US (1000000 * ADC_ACQ_NB_CH / ADC_ACQ_RATE)  // one round robin of the free running acquisition
+
+/**
+ * @brief Nominal conversion by input: value = base + raw x scale / 4096
+ *        ADC0, ADC1, ADC2 (not used), VSYS (voltage divider by 3),
+ *        TEMP (27 - (V - 0.706) / 0.001721 from RP2040 Datasheet)
+ */
+#define ADC_CAL_NOM_SCALE {Q16(ADC_REF), Q16(ADC_REF), 0, Q16(ADC_REF * 3), -Q16(ADC_REF / 0.001721)}
+#define ADC_CAL_NOM_BASE {0, 0, 0, 0, Q16(27 + 0.706 / 0.001721)}
+
+static const q16_t nom_scale[ADC_CAL_NB_CH] = ADC_CAL_NOM_SCALE;
+static const q16_t nom_base[ADC_CAL_NB_CH] = ADC_CAL_NOM_BASE;
+
+/**
+ * @brief Calibration record and conversion coefficients in RAM, nominal until the load.
+ */
+static struct
+{
+  adc_cal_rec_t rec;             // record stored on eeprom
+  q16_t scale[ADC_CAL_NB_CH];    // nominal scale x gain
+  q16_t base[ADC_CAL_NB_CH];     // nominal base x gain + offset
+} cal = {.rec = {.magic = ADC_CAL_MAGIC,
+                 .version = ADC_CAL_VERSION,
+                 .gain = {Q16_ONE, Q16_ONE, Q16_ONE, Q16_ONE, Q16_ONE}},
+         .scale = ADC_CAL_NOM_SCALE,
+         .base = ADC_CAL_NOM_BASE};
+
+/**
+ * @brief Fold gain and offset of the record with the nominal conversion
+ */
+static void adc_cal_apply(void)
+{
+  uint32_t save = save_and_disable_interrupts();  // conversion done also by timer callback
+
+  for (uint8_t ch = 0; ch < ADC_CAL_NB_CH; ch++)
+  {
+    cal.scale[ch] = q16_mul(nom_scale[ch], cal.rec.gain[ch]);
+    cal.base[ch] = q16_mul(nom_base[ch], cal.rec.gain[ch]) + cal.rec.offset[ch];
+  }
+  restore_interrupts(save);
+}
+
+/**
+ * @brief Set the nominal calibration (gain 1, offset 0) in RAM
+ */
+static void adc_cal_nominal(void)
+{
+  cal.rec.magic = ADC_CAL_MAGIC;
+  cal.rec.version = ADC_CAL_VERSION;
+  for (uint8_t ch = 0; ch < ADC_CAL_NB_CH; ch++)
+  {
+    cal.rec.gain[ch] = Q16_ONE;
+    cal.rec.offset[ch] = 0;
+  }
+  adc_cal_apply();
+}
+
+/**
+ * @brief Check if the input could be calibrated
+ */
+static bool adc_cal_valid_channel(uint8_t channel)
+{
+  return channel < ADC_CAL_NB_CH && channel != 2;
+}
+
+/**
+ * @brief Check a calibration record
+ */
+static bool adc_cal_rec_valid(const adc_cal_rec_t* rec)
+{
+  return rec->magic == ADC_CAL_MAGIC && rec->version == ADC_CAL_VERSION &&
+         rec->crc == ee_log_crc16((const uint8_t*)rec, offsetof(adc_cal_rec_t, crc), 0xFFFF);
+}
+
+/**
+ * @brief Load the calibration record from the parameter store. A record found at the previous
+ *        fixed location (ADD_EEPROM_CAL) is moved on the store. Nominal values are used if the
+ *        record is absent or corrupted. Called at boot after ee_log_init.
+ *
+ * @return uint8_t  NOERR, EDE on eeprom error, ECE if record not valid
+ */
+uint8_t adc_cal_load(void)
+{
+  uint8_t ee_address[2] = {ADD_EEPROM_CAL >> 8, ADD_EEPROM_CAL & 0xFF};
+  adc_cal_rec_t rec;
+  uint8_t len;
+  uint8_t status;
+
+  adc_cal_nominal();
+
+  status = ee_log_get(EE_KEY_ADC_CAL, &rec, sizeof(rec), &len);
+  if (status == EMP)
+  {
+    // no record on the store, look at the location used before the store
+    if (sys_i2c_rbyte_eeprom(i2c0, I2C_ADDRESS_AT24CX, ee_address, (uint8_t*)&rec, sizeof(rec)) != sizeof(rec))
+    {
+      fprintf(stdout, "ADC calibration, eeprom read error, nominal values used\n");
+      return EDE;
+    }
+    len = sizeof(rec);
+    if (adc_cal_rec_valid(&rec) && ee_log_put(EE_KEY_ADC_CAL, &rec, sizeof(rec)) == NOERR)
+    {
+      fprintf(stdout, "ADC calibration moved on parameter store\n");
+    }
+  }
+  else if (status != NOERR)
+  {
+    fprintf(stdout, "ADC calibration, parameter store error, nominal values used\n");
+    return status;
+  }
+
+  if (len != sizeof(rec) || !adc_cal_rec_valid(&rec))
+  {
+    fprintf(stdout, "ADC calibration record not valid, nominal values used\n");
+    return ECE;
+  }
+
+  cal.rec = rec;
+  adc_cal_apply();
+  fprintf(stdout, "ADC calibration loaded from eeprom\n");
+  return NOERR;
+}
+
+/**
+ * @brief Write the calibration record on the parameter store, the record is read back and compared
+ *
+ * @return uint8_t  NOERR, EDE on eeprom error, ECE if read data do not match, ERE if store is full
+ */
+uint8_t adc_cal_save(void)
+{
+  uint8_t status;
+
+  cal.rec.crc = ee_log_crc16((const uint8_t*)&cal.rec, offsetof(adc_cal_rec_t, crc), 0xFFFF);
+  status = ee_log_put(EE_KEY_ADC_CAL, &cal.rec, sizeof(cal.rec));
+  if (status != NOERR) return status;
+
+  fprintf(stdout, "ADC calibration saved on eeprom\n");
+  return NOERR;
+}
+
+/**
+ * @brief Set gain and offset of an input and save the record
+ *
+ * @param channel   ADC input (0,1,3 or 4)
+ * @param gain      Gain (ADC_CAL_MIN_GAIN to ADC_CAL_MAX_GAIN)
+ * @param offset    Offset in V or Celsius (+/- ADC_CAL_MAX_OFFSET)
+ * @return uint8_t  NOERR, EOOR if parameter out of range, EDE or ECE on eeprom error
+ */
+uint8_t adc_cal_set(uint8_t channel, q16_t gain, q16_t offset)
+{
+  if (!adc_cal_valid_channel(channel)) return EOOR;
+  if (gain < ADC_CAL_MIN_GAIN || gain > ADC_CAL_MAX_GAIN) return EOOR;
+  if (offset < -ADC_CAL_MAX_OFFSET || offset > ADC_CAL_MAX_OFFSET) return EOOR;
+
+  cal.rec.gain[channel] = gain;
+  cal.rec.offset[channel] = offset;
+  adc_cal_apply();
+  return adc_cal_save();
+}
+
+/**
+ * @brief Return gain and offset of an input
+ *
+ * @param channel   ADC input (0,1,3 or 4)
+ * @param gain      Gain returned
+ * @param offset    Offset returned
+ * @return uint8_t  NOERR or EOOR if input not valid
+ */
+uint8_t adc_cal_get(uint8_t channel, q16_t* gain, q16_t* offset)
+{
+  if (!adc_cal_valid_channel(channel)) return EOOR;
+
+  *gain = cal.rec.gain[channel];
+  *offset = cal.rec.offset[channel];
+  return NOERR;
+}
+
+/**
+ * @brief Return the sum of raw samples of an input
+ *
+ * @param channel   ADC input (0 or 1)
+ * @return uint32_t Sum of ADC_CAL_AUTO_SAMPLES samples
+ */
+static uint32_t adc_cal_sample(uint8_t channel)
+{
+  uint32_t sum = 0;
+  bool free_run = adc_acq_running();
+
+  if (!free_run) adc_select_input(channel);
+  for (uint32_t i = 0; i < ADC_CAL_AUTO_SAMPLES; i++)
+  {
+    if (free_run)
+    {
+      sleep_us(ADC_CAL_ACQ_US);  // new sample of the round robin
+      sum += adc_acq_last(channel);
+    }
+    else
+    {
+      sum += adc_read();
+    }
+  }
+  return sum;
+}
+
+/**
+ * @brief Two points calibration of ADC0 or ADC1 with the DAC. The DAC output must be connected
+ *        to the ADC input. The DAC value is restored at the end.
+ *
+ * @param channel   ADC input (0 or 1)
+ * @return uint8_t  NOERR, EOOR if input not valid or result out of range, EDE on device error
+ */
+uint8_t adc_cal_auto(uint8_t channel)
+{
+  const q16_t level[2] = {ADC_CAL_AUTO_LOW, ADC_CAL_AUTO_HIGH};
+  q16_t expected[2], nominal[2];
+  q16_t gain, offset;
+  uint16_t code, dac_save;
+  uint32_t sum;
+  uint8_t state = adc_cap_state();
+
+  if (channel > 1) return EOOR;
+  if (state == ADC_CAP_ARMED || state == ADC_CAP_TRIGGERED) return EDE;  // ADC used by a capture
+
+  dac_save = dev_mcp4725_get_raw(i2c0, MCP4725_ADDR0);
+
+  for (uint8_t i = 0; i < 2; i++)
+  {
+    if (dac_set_q(level[i], false) != NOERR) return EDE;
+    sleep_ms(ADC_CAL_SETTLE_MS);
+
+    code = dac_volt_to_code(level[i]);
+    expected[i] = (q16_t)(((int64_t)code * Q16(VDD) + (1 << 11)) >> 12);  // DAC output of the code
+    sum = adc_cal_sample(channel);
+    nominal[i] = nom_base[channel] + (q16_t)((int64_t)sum * nom_scale[channel] / (ADC_CAL_AUTO_SAMPLES << 12));
+  }
+  dev_mcp4725_set_raw(i2c0, MCP4725_ADDR0, dac_save);
+
+  if (nominal[1] <= nominal[0]) return EDE;  // DAC not connected to the input
+
+  gain = (q16_t)(((int64_t)(expected[1] - expected[0]) << Q16_SHIFT) / (nominal[1] - nominal[0]));
+  offset = expected[0] - q16_mul(gain, nominal[0]);
+
+  fprintf(stdout, "ADC%d auto-calibration, gain: %ld/65536, offset: %ld/65536 V\n", channel, gain, offset);
+  return adc_cal_set(channel, gain, offset);
+}
+
+/**
+ * @brief Restore the nominal calibration on all inputs and save the record
+ *
+ * @return uint8_t  NOERR, EDE or ECE on eeprom error
+ */
+uint8_t adc_cal_reset(void)
+{
+  adc_cal_nominal();
+  return adc_cal_save();
+}
+
+/**
+ * @brief Convert a raw sample to the calibrated value, integer operations only
+ *
+ * @param channel  ADC input
+ * @param raw      12 bits ADC value
+ * @return q16_t   Value in Volt (input 0,1,3) or Celsius (input 4)
+ */
+q16_t adc_cal_convert(uint8_t channel, uint16_t raw)
+{
+  if (channel >= ADC_CAL_NB_CH) return 0;
+  return cal.base[channel] + (q16_t)(((int64_t)raw * cal.scale[channel] + (1 << 11)) >> 12);
+}
+
+/**
+ * @brief Convert a mean of raw samples to the calibrated value, used by the statistic
+ *
+ * @param channel  ADC input
+ * @param raw      Raw value on ADC count
+ * @return float   Value in Volt (input 0,1,3) or Celsius (input 4)
+ */
+float adc_cal_convert_float(uint8_t channel, float raw)
+{
+  if (channel >= ADC_CAL_NB_CH) return 0;
+  return (cal.base[channel] + raw * cal.scale[channel] * (1.0f / 4096)) * (1.0f / 65536);
+}
+
+/**
+ * @brief Convert a calibrated value to the raw sample giving this value, inverse of adc_cal_convert.
+ *        Used for the level of the capture trigger.
+ *
+ * @param channel  ADC input
+ * @param value    Value in Volt (input 0,1,3) or Celsius (input 4)
+ * @return uint16_t  12 bits ADC value, limited to 0..4095
+ */
+uint16_t adc_cal_to_raw(uint8_t channel, float value)
+{
+  if (channel >= ADC_CAL_NB_CH || cal.scale[channel] == 0) return 0;
+  float raw = (value * 65536.0f - cal.base[channel]) * 4096.0f / cal.scale[channel];
+  if (raw <= 0) return 0;
+  if (raw >= 4095) return 4095;
+  return (uint16_t)(raw + 0.5f);
+}
@@ -0,0 +1,471 @@
+/**
+ * @file    cfg_param.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Configuration parameters of the Master Pico
+ *
+ * @details The parameters are declared once on CFG_PARAM_TABLE (cfg_param.h): the RAM structure,
+ *          the default values and the descriptors used by the SCPI commands are built from it.
+ *          Each value is kept in binary on the parameter store (one key by parameter), a write
+ *          modify RAM and the value is written by the background writer of functadv.c.
+ *          A name is found with a perfect hash: the seed is searched once on the first lookup,
+ *          a new parameter does not need any table to update.
+ *          The fixed structure used before the parameter store (schema version 0) is converted
+ *          at the first boot.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "pico/stdlib.h"
+#include "include/functadv.h"
+#include "include/scpi_user_config.h"
+#include "include/fts_scpi.h"
+#include "include/ee_log.h"
+#include "include/cfg_param.h"
+#include "pico_lib2/src/dev/dev_24lc32/dev_24lc32.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
+
+_Static_assert(EE_KEY_CFG_BASE + CFG_NB_PARAM - 1 <= EE_LOG_MAX_KEY, "parameters must fit on the store keys");
+_Static_assert(CFG_NB_PARAM <= CFG_HASH_SLOTS / 2, "lookup table too small");
+_Static_assert(CFG_NB_PARAM <= EE_MAX_UNIT, "parameters must fit on the background writer");
+
+#define CFG_INIT_CFG_T_STR(field, sdef, ndef) .field = sdef,
+#define CFG_INIT_CFG_T_U32(field, sdef, ndef) .field = ndef,
+#define CFG_INIT_CFG_T_BOOL(field, sdef, ndef) .field = ndef,
+#define CFG_INIT(id, field, name, type, size, sdef, ndef, min, max) CFG_INIT_##type(field, sdef, ndef)
+
+#define CFG_SIZE_CHECK(id, field, name, type, size, sdef, ndef, min, max) \
+  _Static_assert(sizeof(((cfg_values_t*)0)->field) <= CFG_TEXT_SIZE && (size) < EE_LOG_MAX_VALUE, name " too long");
+CFG_PARAM_TABLE(CFG_SIZE_CHECK)
+
+#define CFG_DESC(id, field, name, type, size, sdef, ndef, min, max) \
+  {name, type, offsetof(cfg_values_t, field), size, min, max},
+
+/**
+ * @brief Descriptor of a parameter
+ */
+typedef struct
+{
+  const char* name;  // name used by the SCPI commands
+  cfg_type_t type;   // type of value
+  uint16_t offset;   // offset on cfg_values_t
+  uint8_t size;      // maximum number of characters of a string
+  uint32_t min;      // minimum of a number
+  uint32_t max;      // maximum of a number
+} cfg_desc_t;
+
+static const cfg_desc_t cfg_desc[CFG_NB_PARAM] = {CFG_PARAM_TABLE(CFG_DESC)};
+static const cfg_values_t cfg_def = {CFG_PARAM_TABLE(CFG_INIT)};
+
+cfg_values_t cfg_val = {CFG_PARAM_TABLE(CFG_INIT)};  // default values until the load
+
+/**
+ * @brief Fixed structure at ADD_EEPROM_BASE used before the parameter store (schema version 0),
+ *        all values as strings without end of string when the field is full.
+ */
+typedef struct
+{
+  char check[1];
+  char partnumber[13];
+  char serialnumber[6];
+  char mod_option[15];
+  char com_ser_speed[7];
+  char com_ser_echo[2];
+  char slave_force_run[2];
+  char testboard_num[13];
+  char parameter1[15];
+  char parameter2[15];
+  char parameter3[15];
+  char parameter4[15];
+  char parameter5[15];
+  char test[10];
+} cfg_legacy_t;
+
+#define CFG_LEGACY_CHECK '#'  // first byte of a valid structure
+#define CFG_LEGACY(id, field) {id, offsetof(cfg_legacy_t, field), sizeof(((cfg_legacy_t*)0)->field)}
+
+/**
+ * @brief Field of the fixed structure converted to a parameter
+ */
+static const struct
+{
+  cfg_id_t id;
+  uint8_t offset;
+  uint8_t size;
+} cfg_legacy[] = {
+    CFG_LEGACY(CFG_CHECK, check),
+    CFG_LEGACY(CFG_PARTNUMBER, partnumber),
+    CFG_LEGACY(CFG_SERIALNUMBER, serialnumber),
+    CFG_LEGACY(CFG_MOD_OPTION, mod_option),
+    CFG_LEGACY(CFG_COM_SER_SPEED, com_ser_speed),
+    CFG_LEGACY(CFG_COM_SER_ECHO, com_ser_echo),
+    CFG_LEGACY(CFG_SLAVE_FORCE_RUN, slave_force_run),
+    CFG_LEGACY(CFG_TESTBOARD_NUM, testboard_num),
+    CFG_LEGACY(CFG_PARAMETER1, parameter1),
+    CFG_LEGACY(CFG_PARAMETER2, parameter2),
+    CFG_LEGACY(CFG_PARAMETER3, parameter3),
+    CFG_LEGACY(CFG_PARAMETER4, parameter4),
+    CFG_LEGACY(CFG_PARAMETER5, parameter5),
+    CFG_LEGACY(CFG_TEST, test),
+};
+
+/**
+ * @brief State of the configuration.
+ */
+static struct
+{
+  uint8_t state;                  // result of the load
+  bool hashed;                    // lookup table built
+  uint32_t seed;                  // seed of the perfect hash
+  uint8_t slot[CFG_HASH_SLOTS];   // parameter by hash slot, 0xFF if empty
+} cp = {.state = EDE};
+
+/**
+ * @brief FNV-1a hash of a name, not case sensitive
+ */
+static uint32_t cfg_hash(const char* name, uint32_t seed)
+{
+  uint32_t h = 2166136261u ^ seed;
+
+  while (*name)
+  {
+    h ^= (uint8_t)toupper((unsigned char)*name++);
+    h *= 16777619u;
+  }
+  return h & (CFG_HASH_SLOTS - 1);
+}
+
+/**
+ * @brief Search the first seed without collision between the names of the schema
+ */
+static void cfg_hash_build(void)
+{
+  for (cp.seed = 0;; cp.seed++)
+  {
+    uint32_t i;
+
+    memset(cp.slot, 0xFF, sizeof(cp.slot));
+    for (i = 0; i < CFG_NB_PARAM; i++)
+    {
+      uint32_t h = cfg_hash(cfg_desc[i].name, cp.seed);
+      if (cp.slot[h] != 0xFF) break;  // collision, next seed
+      cp.slot[h] = i;
+    }
+    if (i == CFG_NB_PARAM) break;
+  }
+  cp.hashed = true;
+}
+
+/**
+ * @brief Find a parameter by name
+ *
+ * @param name  Name of the parameter, not case sensitive
+ * @return int  Index of the parameter (cfg_id_t), -1 if not found
+ */
+int cfg_param_find(const char* name)
+{
+  uint8_t i;
+
+  if (!cp.hashed) cfg_hash_build();
+
+  i = cp.slot[cfg_hash(name, cp.seed)];
+  if (i == 0xFF || strcasecmp(name, cfg_desc[i].name) != 0) return -1;
+  return i;
+}
+
+/**
+ * @brief Return the name of a parameter
+ */
+const char* cfg_param_name(cfg_id_t id)
+{
+  return cfg_desc[id].name;
+}
+
+/**
+ * @brief Return the address of the value of a parameter on RAM
+ */
+static void* cfg_param_ptr(cfg_id_t id)
+{
+  return (uint8_t*)&cfg_val + cfg_desc[id].offset;
+}
+
+/**
+ * @brief Return the size of the value of a parameter on RAM
+ */
+static size_t cfg_param_size(cfg_id_t id)
+{
+  switch (cfg_desc[id].type)
+  {
+    case CFG_T_STR:
+      return cfg_desc[id].size + 1;
+    case CFG_T_U32:
+      return sizeof(uint32_t);
+    default:
+      return sizeof(bool);
+  }
+}
+
+/**
+ * @brief Convert a text to the value of a parameter, without change of the RAM value
+ *
+ * @param id        Parameter
+ * @param text      Text of the value, size characters maximum for a string
+ * @param len       Length of the text
+ * @param value     Value converted (cfg_values_t field)
+ * @return uint8_t  NOERR, EOOR if too long or out of range, ENDE if a number is expected
+ */
+static uint8_t cfg_param_parse(cfg_id_t id, const char* text, size_t len, void* value)
+{
+  const cfg_desc_t* d = &cfg_desc[id];
+  long number;
+
+  if (d->type == CFG_T_STR)
+  {
+    if (len > d->size) return EOOR;
+    memset(value, 0, d->size + 1);  // padded with 0, the compare of the whole field is valid
+    memcpy(value, text, len);
+    return NOERR;
+  }
+
+  if (len == 0 || len >= CFG_TEXT_SIZE || stringtonumber(text, len, &number) != 0) return ENDE;
+  if (number < (long)d->min || number > (long)d->max) return EOOR;
+
+  if (d->type == CFG_T_U32)
+    *(uint32_t*)value = number;
+  else
+    *(bool*)value = (number != 0);
+  return NOERR;
+}
+
+/**
+ * @brief Set a parameter from a text. The value is written on the parameter store
+ *        by the background writer (cfg_eeprom_event) or by cfg_eeprom_flush.
+ *
+ * @param id        Parameter
+ * @param text      Text of the value
+ * @return uint8_t  NOERR, EOOR if too long or out of range, ENDE if a number is expected
+ */
+uint8_t cfg_param_set_text(cfg_id_t id, const char* text)
+{
+  uint8_t value[CFG_TEXT_SIZE];
+  uint8_t status;
+  size_t size = cfg_param_size(id);
+
+  status = cfg_param_parse(id, text, strlen(text), value);
+  if (status != NOERR) return status;
+
+  if (memcmp(cfg_param_ptr(id), value, size) == 0) return NOERR;  // same value, nothing to write
+  memcpy(cfg_param_ptr(id), value, size);
+  cfg_eeprom_touch(id);
+  return NOERR;
+}
+
+/**
+ * @brief Return the text of a parameter
+ *
+ * @param id        Parameter
+ * @param text      Text returned
+ * @param size      Size of text (CFG_TEXT_SIZE)
+ * @return uint32_t Length of the text
+ */
+uint32_t cfg_param_get_text(cfg_id_t id, char* text, size_t size)
+{
+  const void* p = cfg_param_ptr(id);
+
+  switch (cfg_desc[id].type)
+  {
+    case CFG_T_STR:
+      return snprintf(text, size, "%s", (const char*)p);
+    case CFG_T_U32:
+      return snprintf(text, size, "%lu", *(const uint32_t*)p);
+    default:
+      return snprintf(text, size, "%u", *(const bool*)p ? 1 : 0);
+  }
+}
+
+/**
+ * @brief Write a parameter on the parameter store, store function of the background writer
+ */
+static uint8_t cfg_param_store(uint32_t id)
+{
+  const void* p = cfg_param_ptr(id);
+  uint8_t len;
+
+  switch (cfg_desc[id].type)
+  {
+    case CFG_T_STR:
+      len = strlen((const char*)p);
+      if (len == 0) len = 1;  // empty string kept with its end of string
+      break;
+    case CFG_T_U32:
+      len = sizeof(uint32_t);
+      break;
+    default:
+      len = sizeof(bool);
+      break;
+  }
+  return ee_log_put(EE_KEY_CFG_BASE + id, p, len);
+}
+
+/**
+ * @brief Read a parameter from the parameter store. The default value is kept if the
+ *        parameter is absent (added after the last write) or not valid.
+ */
+static void cfg_param_fetch(cfg_id_t id)
+{
+  const cfg_desc_t* d = &cfg_desc[id];
+  uint8_t data[EE_LOG_MAX_VALUE];
+  uint8_t len;
+
+  if (ee_log_get(EE_KEY_CFG_BASE + id, data, sizeof(data), &len) != NOERR)
+  {
+    cfg_eeprom_touch(id);  // default value written on the store
+    return;
+  }
+
+  switch (d->type)
+  {
+    case CFG_T_STR:
+      if (len > d->size) len = d->size;
+      memset(cfg_param_ptr(id), 0, d->size + 1);  // no rest of the default value after the string
+      memcpy(cfg_param_ptr(id), data, len);
+      break;
+    case CFG_T_U32:
+    {
+      uint32_t v;
+      memcpy(&v, data, sizeof(v));
+      if (len == sizeof(v) && v >= d->min && v <= d->max) *(uint32_t*)cfg_param_ptr(id) = v;
+      break;
+    }
+    default:
+      if (len == sizeof(bool)) *(bool*)cfg_param_ptr(id) = (data[0] != 0);
+      break;
+  }
+}
+
+/**
+ * @brief Migration from schema version 0: fixed structure of strings at ADD_EEPROM_BASE.
+ *        Each field is converted with the rules of the parameter, the default value is kept
+ *        if the structure is not valid or a field can not be converted.
+ */
+static uint8_t cfg_migrate_v0(void)
+{
+  at24cx_dev_t dev;
+  cfg_legacy_t legacy;
+  const char* raw = (const char*)&legacy;
+
+  at24cx_i2c_device_register(&dev, EEMODEL, I2C_ADDRESS_AT24CX);
+  if (at24cx_i2c_sequential_read(dev, ADD_EEPROM_BASE, (uint8_t*)&legacy, sizeof(legacy)) != AT24CX_OK) return EDE;
+
+  if (legacy.check[0] != CFG_LEGACY_CHECK)
+  {
+    fprintf(stdout, "No configuration to convert, default values used\n");
+  }
+  else
+  {
+    for (uint32_t i = 0; i < count_of(cfg_legacy); i++)
+    {
+      uint8_t value[CFG_TEXT_SIZE];
+      const char* field = &raw[cfg_legacy[i].offset];
+      size_t len = strnlen(field, cfg_legacy[i].size);
+
+      if (cfg_param_parse(cfg_legacy[i].id, field, len, value) == NOERR)
+      {
+        memcpy(cfg_param_ptr(cfg_legacy[i].id), value, cfg_param_size(cfg_legacy[i].id));
+      }
+      else
+      {
+        fprintf(stdout, "Parameter %s not converted, default value used\n", cfg_desc[cfg_legacy[i].id].name);
+      }
+    }
+    fprintf(stdout, "Configuration converted from fixed structure\n");
+  }
+  cfg_eeprom_touch_all(CFG_NB_PARAM);  // all parameters written
+  return NOERR;
+}
+
+/**
+ * @brief Migration steps, index is the version converted to the next version
+ */
+static uint8_t (*const cfg_migrate[CFG_SCHEMA_VERSION])(void) = {cfg_migrate_v0};
+
+/**
+ * @brief Load the configuration from the parameter store, convert the values of a previous schema.
+ *        Called at boot after ee_log_init.
+ *
+ * @return uint8_t  NOERR, error of the parameter store or of the conversion
+ */
+uint8_t cfg_param_load(void)
+{
+  uint16_t version = 0;
+  uint8_t len;
+  uint8_t status;
+
+  cfg_val = cfg_def;
+  cfg_eeprom_attach(NULL);
+
+  status = ee_log_get(EE_KEY_CFG_VERSION, &version, sizeof(version), &len);
+  if (status != NOERR && status != EMP)
+  {
+    cp.state = status;
+    return status;
+  }
+  cfg_eeprom_attach(cfg_param_store);  // RAM is the reference from now
+
+  if (version > 0)
+  {
+    for (uint32_t i = 0; i < CFG_NB_PARAM; i++) cfg_param_fetch(i);
+  }
+
+  if (version > CFG_SCHEMA_VERSION)
+  {
+    fprintf(stdout, "Configuration schema %u newer than firmware %u\n", version, CFG_SCHEMA_VERSION);
+  }
+
+  for (; version < CFG_SCHEMA_VERSION; version++)
+  {
+    fprintf(stdout, "Configuration schema %u converted\n", version);
+    status = cfg_migrate[version]();
+    if (status != NOERR) break;
+
+    status = cfg_eeprom_flush(true);  // converted values written before the version
+    if (status == NOERR) status = ee_log_put(EE_KEY_CFG_VERSION, &(uint16_t){version + 1}, sizeof(uint16_t));
+    if (status != NOERR) break;
+  }
+
+  if (status != NOERR) cfg_eeprom_attach(NULL);  // store not usable, default values kept on RAM
+  cp.state = status;
+  fprintf(stdout, "Configuration loaded, schema %u, %u parameters\n", version, CFG_NB_PARAM);
+  return status;
+}
+
+/**
+ * @brief Return the result of the load
+ *
+ * @return uint8_t  NOERR if the configuration come from the parameter store
+ */
+uint8_t cfg_param_state(void)
+{
+  return cp.state;
+}
+
+/**
+ * @brief Set all parameters to the default value and write them now
+ *
+ * @return uint8_t  NOERR or error of the parameter store
+ */
+uint8_t cfg_param_default(void)
+{
+  cfg_val = cfg_def;
+  cfg_eeprom_attach(cfg_param_store);  // store used even if the load failed
+  cfg_eeprom_touch_all(CFG_NB_PARAM);
+  return cfg_eeprom_flush(true);
+}
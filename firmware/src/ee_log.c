@@ -0,0 +1,453 @@
+/**
+ * @file    ee_log.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Journaled key/value store on the configuration eeprom
+ *
+ * @details Values are appended as records with a sequence number and a CRC, never written in place.
+ *          The cells are used in turn on the whole bank and on the two banks by the compaction, a
+ *          value updated often does not wear the same cells. The active bank is kept on RAM: it is
+ *          read with one sequential read at boot, the index of the last record of each key is built
+ *          from this copy and a value is read without I2C transfer.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "include/functadv.h"
+#include "include/ee_log.h"
+#include "pico_lib2/src/dev/dev_24lc32/dev_24lc32.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
+
+#define EE_LOG_HDR sizeof(ee_log_bank_t)                                   // first record of a bank
+#define EE_LOG_REC_SIZE(len) (sizeof(ee_log_rec_t) + (len) + sizeof(uint16_t))  // record with value and CRC
+#define EE_LOG_MAX_LIVE (EE_LOG_BANK_SIZE / 2)                             // valid records must fit after compaction
+
+_Static_assert(EE_LOG_BASE % EE_PAGESIZE == 0 && EE_LOG_BANK_SIZE % EE_PAGESIZE == 0, "banks must be page aligned");
+_Static_assert(EE_LOG_MAX_KEY < 32, "keys must fit on the copy mask");
+
+/**
+ * @brief State of the store.
+ */
+static struct
+{
+  at24cx_dev_t dev;                        // configuration eeprom
+  bool ready;                              // store initialized
+  uint8_t bank;                            // active bank
+  uint16_t gen;                            // generation of the active bank
+  uint32_t end;                            // offset of the next record on the active bank
+  uint16_t seq;                            // sequence of the next record
+  uint32_t live;                           // bytes of the valid records
+  uint16_t index[EE_LOG_MAX_KEY + 1];      // offset of the last record of a key, 0 if no value
+  bool compacting;                         // valid records copied on the other bank
+  uint32_t copied;                         // keys copied on the other bank (bit = key)
+  uint32_t dst_end;                        // offset of the next record on the other bank
+  uint16_t dst_seq;                        // sequence of the next record on the other bank
+  uint32_t compactions;                    // compactions since boot
+  uint32_t errors;                         // write or verify errors since boot
+  uint8_t mirror[EE_LOG_BANK_SIZE];        // copy of the active bank
+} el;
+
+/**
+ * @brief CRC-16 CCITT (polynomial 0x1021)
+ *
+ * @param data      Bytes to check
+ * @param len       Number of bytes
+ * @param crc       Initial value, 0xFFFF or the CRC of the previous bytes
+ * @return uint16_t CRC
+ */
+uint16_t ee_log_crc16(const uint8_t* data, size_t len, uint16_t crc)
+{
+  while (len--)
+  {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int i = 0; i < 8; i++)
+    {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+/**
+ * @brief Return the eeprom address of an offset on a bank
+ */
+static uint32_t ee_log_addr(uint8_t bank, uint32_t offset)
+{
+  return EE_LOG_BASE + bank * EE_LOG_BANK_SIZE + offset;
+}
+
+/**
+ * @brief Write bytes on eeprom, read back and compare
+ *
+ * @param addr      EEPROM address
+ * @param data      Bytes to write
+ * @param len       Number of bytes (up to one record)
+ * @return uint8_t  NOERR, EDE on eeprom error, ECE if read data do not match
+ */
+static uint8_t ee_log_write(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+  uint8_t rd[EE_LOG_REC_SIZE(EE_LOG_MAX_VALUE)];
+
+  if (at24cx_i2c_write(el.dev, addr, data, len) != AT24CX_OK || at24cx_i2c_sequential_read(el.dev, addr, rd, len) != AT24CX_OK)
+  {
+    el.errors++;
+    fprintf(stdout, "Parameter store, eeprom error at 0x%03lX\n", addr);
+    return EDE;
+  }
+  if (memcmp(rd, data, len) != 0)
+  {
+    el.errors++;
+    fprintf(stdout, "Parameter store, data do not match at 0x%03lX\n", addr);
+    return ECE;
+  }
+  return NOERR;
+}
+
+/**
+ * @brief Build a record
+ *
+ * @param buf       Record built (EE_LOG_REC_SIZE(len) bytes)
+ * @param key       Key
+ * @param data      Value
+ * @param len       Length of the value
+ * @param seq       Sequence of the record on the bank
+ * @param gen       Generation of the bank, initial value of the CRC
+ * @return uint32_t Size of the record
+ */
+static uint32_t ee_log_build(uint8_t* buf, uint8_t key, const uint8_t* data, uint8_t len, uint16_t seq, uint16_t gen)
+{
+  ee_log_rec_t rec = {.key = key, .len = len, .seq = seq};
+  uint32_t size = sizeof(rec) + len;
+  uint16_t crc;
+
+  memcpy(buf, &rec, sizeof(rec));
+  memcpy(&buf[sizeof(rec)], data, len);
+  crc = ee_log_crc16(buf, size, gen);
+  memcpy(&buf[size], &crc, sizeof(crc));
+  return size + sizeof(crc);
+}
+
+/**
+ * @brief Check the header of a bank
+ */
+static bool ee_log_bank_valid(const ee_log_bank_t* h)
+{
+  return h->magic == EE_LOG_MAGIC && h->crc == ee_log_crc16((const uint8_t*)h, offsetof(ee_log_bank_t, crc), 0xFFFF);
+}
+
+/**
+ * @brief Build the index from the copy of the active bank. The scan stop on the first record
+ *        with a bad key, sequence or CRC: end of the log or write interrupted.
+ */
+static void ee_log_scan(void)
+{
+  uint32_t off = EE_LOG_HDR;
+  uint16_t seq = 0;
+  ee_log_rec_t rec;
+  uint16_t crc;
+
+  memset(el.index, 0, sizeof(el.index));
+  while (off + EE_LOG_REC_SIZE(0) <= EE_LOG_BANK_SIZE)
+  {
+    memcpy(&rec, &el.mirror[off], sizeof(rec));
+    if (rec.key == 0 || rec.key > EE_LOG_MAX_KEY || rec.len > EE_LOG_MAX_VALUE || rec.seq != seq) break;
+    if (off + EE_LOG_REC_SIZE(rec.len) > EE_LOG_BANK_SIZE) break;
+    memcpy(&crc, &el.mirror[off + sizeof(rec) + rec.len], sizeof(crc));
+    if (crc != ee_log_crc16(&el.mirror[off], sizeof(rec) + rec.len, el.gen)) break;
+
+    el.index[rec.key] = rec.len ? off : 0;  // length 0 is an erased key
+    off += EE_LOG_REC_SIZE(rec.len);
+    seq++;
+  }
+  el.end = off;
+  el.seq = seq;
+
+  el.live = 0;
+  for (uint32_t k = 1; k <= EE_LOG_MAX_KEY; k++)
+  {
+    if (el.index[k]) el.live += EE_LOG_REC_SIZE(el.mirror[el.index[k] + offsetof(ee_log_rec_t, len)]);
+  }
+}
+
+/**
+ * @brief Write the header of a bank
+ */
+static uint8_t ee_log_write_header(uint8_t bank, uint16_t gen)
+{
+  ee_log_bank_t h = {.magic = EE_LOG_MAGIC, .gen = gen};
+
+  h.crc = ee_log_crc16((const uint8_t*)&h, offsetof(ee_log_bank_t, crc), 0xFFFF);
+  return ee_log_write(ee_log_addr(bank, 0), (const uint8_t*)&h, sizeof(h));
+}
+
+/**
+ * @brief Read the active bank on RAM and build the index
+ */
+static uint8_t ee_log_load(void)
+{
+  if (at24cx_i2c_sequential_read(el.dev, ee_log_addr(el.bank, 0), el.mirror, EE_LOG_BANK_SIZE) != AT24CX_OK) return EDE;
+  ee_log_scan();
+  return NOERR;
+}
+
+/**
+ * @brief Initialize the store: select the active bank, read it and build the index.
+ *        The first bank is formatted if no bank is valid.
+ *
+ * @return uint8_t  NOERR or EDE on eeprom error
+ */
+uint8_t ee_log_init(void)
+{
+  ee_log_bank_t h[2];
+  bool valid[2];
+  uint32_t t0 = time_us_32();
+  uint8_t status;
+
+  el.ready = false;
+  at24cx_i2c_device_register(&el.dev, EEMODEL, I2C_ADDRESS_AT24CX);
+  if (!el.dev.status) return EDE;
+
+  for (uint8_t b = 0; b < 2; b++)
+  {
+    if (at24cx_i2c_sequential_read(el.dev, ee_log_addr(b, 0), (uint8_t*)&h[b], sizeof(h[b])) != AT24CX_OK) return EDE;
+    valid[b] = ee_log_bank_valid(&h[b]);
+  }
+
+  if (!valid[0] && !valid[1])
+  {
+    fprintf(stdout, "Parameter store not found, format bank 0\n");
+    status = ee_log_write_header(0, 1);
+    if (status != NOERR) return status;
+    h[0].gen = 1;
+    valid[0] = true;
+  }
+
+  // newest generation is active, the other bank is an interrupted or previous compaction
+  el.bank = (valid[1] && (!valid[0] || (int16_t)(h[1].gen - h[0].gen) > 0)) ? 1 : 0;
+  el.gen = h[el.bank].gen;
+  el.compacting = false;
+
+  status = ee_log_load();
+  if (status != NOERR) return status;
+  el.ready = true;
+
+  fprintf(stdout, "Parameter store: bank %u, generation %u, %lu records, %lu bytes used, loaded in %lu us\n", el.bank, el.gen, (uint32_t)el.seq,
+          el.end, time_us_32() - t0);
+  return NOERR;
+}
+
+/**
+ * @brief Start the copy of the valid records on the other bank
+ */
+static void ee_log_compact_start(void)
+{
+  if (el.compacting) return;
+
+  el.compacting = true;
+  el.copied = 0;
+  el.dst_end = EE_LOG_HDR;
+  el.dst_seq = 0;
+}
+
+/**
+ * @brief Copy one valid record on the other bank. When all records are copied, the header of
+ *        the other bank is written and it become the active bank.
+ *
+ * @return uint8_t  NOERR or error of the eeprom write
+ */
+static uint8_t ee_log_compact_step(void)
+{
+  uint8_t buf[EE_LOG_REC_SIZE(EE_LOG_MAX_VALUE)];
+  uint8_t dst = el.bank ^ 1;
+  ee_log_rec_t rec;
+  uint32_t size;
+  uint8_t status;
+
+  for (uint8_t k = 1; k <= EE_LOG_MAX_KEY; k++)
+  {
+    if (!el.index[k] || (el.copied & (1u << k))) continue;
+
+    memcpy(&rec, &el.mirror[el.index[k]], sizeof(rec));
+    if (el.dst_end + EE_LOG_REC_SIZE(rec.len) > EE_LOG_BANK_SIZE)
+    {
+      el.compacting = false;  // bank filled by values updated during the copy, start again
+      ee_log_compact_start();
+      return NOERR;
+    }
+    size = ee_log_build(buf, k, &el.mirror[el.index[k] + sizeof(rec)], rec.len, el.dst_seq, el.gen + 1);
+    status = ee_log_write(ee_log_addr(dst, el.dst_end), buf, size);
+    if (status != NOERR) return status;  // same record written again on the next step
+
+    el.copied |= 1u << k;
+    el.dst_end += size;
+    el.dst_seq++;
+    return NOERR;
+  }
+
+  // all valid records copied, the header validate the other bank
+  status = ee_log_write_header(dst, el.gen + 1);
+  if (status != NOERR) return status;
+
+  el.bank = dst;
+  el.gen++;
+  el.compacting = false;
+  el.compactions++;
+  status = ee_log_load();
+  fprintf(stdout, "Parameter store compacted on bank %u, %lu bytes used\n", el.bank, el.end);
+  return status;
+}
+
+/**
+ * @brief Compact the store now: all valid records are copied on the other bank
+ *
+ * @return uint8_t  NOERR, EDE if the store is not initialized or on eeprom error, ECE on verify error
+ */
+uint8_t ee_log_compact(void)
+{
+  uint8_t status = NOERR;
+
+  if (!el.ready) return EDE;
+
+  ee_log_compact_start();
+  while (el.compacting && status == NOERR)
+  {
+    status = ee_log_compact_step();
+  }
+  return status;
+}
+
+/**
+ * @brief Background compaction, called by the main loop. One record is copied by call
+ *        when the bus is free.
+ */
+void ee_log_event(void)
+{
+  if (!el.compacting || sys_i2c_busy(i2c0)) return;
+
+  ee_log_compact_step();
+}
+
+/**
+ * @brief Read the value of a key from the copy on RAM
+ *
+ * @param key       Key (1 to EE_LOG_MAX_KEY)
+ * @param data      Value returned
+ * @param size      Size of data
+ * @param len       Length of the value returned
+ * @return uint8_t  NOERR, EIVN if key not valid, EMP if the key has no value, EOOR if data is too small,
+ *                  EDE if the store is not initialized
+ */
+uint8_t ee_log_get(uint8_t key, void* data, uint8_t size, uint8_t* len)
+{
+  ee_log_rec_t rec;
+
+  if (!el.ready) return EDE;
+  if (key == 0 || key > EE_LOG_MAX_KEY) return EIVN;
+  if (!el.index[key]) return EMP;
+
+  memcpy(&rec, &el.mirror[el.index[key]], sizeof(rec));
+  if (rec.len > size) return EOOR;
+
+  memcpy(data, &el.mirror[el.index[key] + sizeof(rec)], rec.len);
+  *len = rec.len;
+  return NOERR;
+}
+
+/**
+ * @brief Append a record on the active bank
+ */
+static uint8_t ee_log_append(uint8_t key, const uint8_t* data, uint8_t len)
+{
+  uint8_t buf[EE_LOG_REC_SIZE(EE_LOG_MAX_VALUE)];
+  uint32_t size = EE_LOG_REC_SIZE(len);
+  uint32_t live = el.live + size;
+  uint8_t status;
+
+  if (el.index[key]) live -= EE_LOG_REC_SIZE(el.mirror[el.index[key] + offsetof(ee_log_rec_t, len)]);
+  if (len == 0) live -= size;  // erased key is not copied by the compaction
+  if (live > EE_LOG_MAX_LIVE) return ERE;
+
+  if (el.end + size > EE_LOG_BANK_SIZE)
+  {
+    status = ee_log_compact();  // bank full, compaction completed now
+    if (status != NOERR) return status;
+    if (el.end + size > EE_LOG_BANK_SIZE) return ERE;
+  }
+
+  ee_log_build(buf, key, data, len, el.seq, el.gen);
+  status = ee_log_write(ee_log_addr(el.bank, el.end), buf, size);
+  if (status != NOERR) return status;  // record ignored at boot, overwritten by the next append
+
+  memcpy(&el.mirror[el.end], buf, size);
+  el.index[key] = len ? el.end : 0;
+  el.end += size;
+  el.seq++;
+  el.live = live;
+  el.copied &= ~(1u << key);  // value to copy again if a compaction is running
+
+  if (el.end >= EE_LOG_COMPACT_LEVEL) ee_log_compact_start();
+  return NOERR;
+}
+
+/**
+ * @brief Write the value of a key. Nothing is written if the value is not changed.
+ *
+ * @param key       Key (1 to EE_LOG_MAX_KEY)
+ * @param data      Value
+ * @param len       Length of the value (1 to EE_LOG_MAX_VALUE)
+ * @return uint8_t  NOERR, EIVN if key not valid, EOOR if length not valid, ERE if the store is full,
+ *                  EDE or ECE on eeprom error
+ */
+uint8_t ee_log_put(uint8_t key, const void* data, uint8_t len)
+{
+  if (!el.ready) return EDE;
+  if (key == 0 || key > EE_LOG_MAX_KEY) return EIVN;
+  if (len == 0 || len > EE_LOG_MAX_VALUE) return EOOR;
+
+  if (el.index[key] && el.mirror[el.index[key] + offsetof(ee_log_rec_t, len)] == len &&
+      memcmp(&el.mirror[el.index[key] + sizeof(ee_log_rec_t)], data, len) == 0)
+    return NOERR;  // same value
+
+  return ee_log_append(key, data, len);
+}
+
+/**
+ * @brief Erase the value of a key
+ *
+ * @param key       Key (1 to EE_LOG_MAX_KEY)
+ * @return uint8_t  NOERR, EIVN if key not valid, EDE or ECE on eeprom error
+ */
+uint8_t ee_log_erase(uint8_t key)
+{
+  if (!el.ready) return EDE;
+  if (key == 0 || key > EE_LOG_MAX_KEY) return EIVN;
+  if (!el.index[key]) return NOERR;  // no value
+
+  return ee_log_append(key, (const uint8_t*)"", 0);
+}
+
+/**
+ * @brief Return the state of the store
+ *
+ * @param st  State returned
+ */
+void ee_log_status(ee_log_status_t* st)
+{
+  st->bank = el.bank;
+  st->gen = el.gen;
+  st->used = el.end;
+  st->keys = 0;
+  for (uint32_t k = 1; k <= EE_LOG_MAX_KEY; k++)
+  {
+    if (el.index[k]) st->keys++;
+  }
+  st->compactions = el.compactions;
+  st->errors = el.errors;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file    fixq.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Q16.16 fixed point conversion to and from decimal text
+ *
+ * @details The measures are kept on Q16.16 from the raw value of the device to the answer.
+ *          The text is built with integer operations only, the parameter received is
+ *          converted without strtod or sscanf.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include "include/fixq.h"
+
+static const uint32_t pow10_tab[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+#define FIXQ_MAX_DIGITS 14  // mantissa shifted by 16 bits must stay on 64 bits
+
+/**
+ * @brief Write a Q16 value as decimal text, rounded to the number of decimals
+ *
+ * @param buf       Buffer receiving the text
+ * @param size      Size of the buffer
+ * @param v         Value to convert
+ * @param decimals  Number of decimals (0 to Q16_MAX_DECIMALS)
+ * @return int      Number of characters written (snprintf convention)
+ */
+int q16_format(char* buf, size_t size, q16_t v, uint8_t decimals)
+{
+  uint32_t a = (v < 0) ? -(uint32_t)v : (uint32_t)v;
+  uint32_t ipart = a >> Q16_SHIFT;
+  uint32_t scale, fpart;
+
+  if (decimals > Q16_MAX_DECIMALS) decimals = Q16_MAX_DECIMALS;
+  scale = pow10_tab[decimals];
+
+  // fraction rounded on the number of decimals
+  fpart = (uint32_t)(((uint64_t)(a & (Q16_ONE - 1)) * scale + (Q16_ONE / 2)) >> Q16_SHIFT);
+  if (fpart >= scale)
+  {  // rounding carry on integer part
+    fpart -= scale;
+    ipart++;
+  }
+
+  if (decimals == 0) return snprintf(buf, size, "%s%lu", (v < 0) ? "-" : "", (unsigned long)ipart);
+
+  return snprintf(buf, size, "%s%lu.%0*lu", (v < 0) ? "-" : "", (unsigned long)ipart, decimals, (unsigned long)fpart);
+}
+
+/**
+ * @brief Convert a decimal number (sign, digits, point, exponent) to Q16.
+ *        Text after the number (unit suffix, space) is ignored.
+ *
+ * @param s      Text to convert, not NUL terminated
+ * @param len    Number of characters
+ * @param v      Value converted
+ * @return true  Conversion done
+ * @return false No digit found or value outside of Q16 range
+ */
+bool q16_parse(const char* s, size_t len, q16_t* v)
+{
+  size_t i = 0;
+  bool neg = false, digit = false;
+  int64_t m = 0;  // mantissa, value = m x 10^e
+  int32_t e = 0;
+  uint8_t nd = 0;
+  int64_t q;
+
+  while (i < len && (s[i] == ' ' || s[i] == '\t')) i++;
+  if (i < len && (s[i] == '+' || s[i] == '-')) neg = (s[i++] == '-');
+
+  for (; i < len && s[i] >= '0' && s[i] <= '9'; i++, digit = true)
+  {
+    if (nd < FIXQ_MAX_DIGITS)
+    {
+      m = m * 10 + (s[i] - '0');
+      if (m) nd++;
+    }
+    else
+    {
+      e++;  // digit dropped, keep the magnitude
+    }
+  }
+  if (i < len && s[i] == '.')
+  {
+    for (i++; i < len && s[i] >= '0' && s[i] <= '9'; i++, digit = true)
+    {
+      if (nd < FIXQ_MAX_DIGITS)
+      {
+        m = m * 10 + (s[i] - '0');
+        if (m) nd++;
+        e--;
+      }
+    }
+  }
+  if (!digit) return false;
+
+  if (i + 1 < len && (s[i] == 'e' || s[i] == 'E'))
+  {
+    size_t j = i + 1;
+    bool eneg = false;
+    int32_t x = 0;
+
+    if (j < len && (s[j] == '+' || s[j] == '-')) eneg = (s[j++] == '-');
+    if (j < len && s[j] >= '0' && s[j] <= '9')
+    {
+      for (; j < len && s[j] >= '0' && s[j] <= '9'; j++)
+      {
+        if (x < 100) x = x * 10 + (s[j] - '0');
+      }
+      e += eneg ? -x : x;
+    }
+  }
+
+  q = m << Q16_SHIFT;
+  while (e > 0)
+  {
+    if (q > INT32_MAX) return false;  // overflow, stop before 64 bits limit
+    q *= 10;
+    e--;
+  }
+  while (e < 0 && q)
+  {
+    uint8_t n = (-e > 9) ? 9 : -e;
+    q = (q + pow10_tab[n] / 2) / pow10_tab[n];
+    e += n;
+  }
+  if (q > INT32_MAX) return false;
+
+  *v = neg ? -(q16_t)q : (q16_t)q;
+  return true;
+}
@@ -20,9 +20,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "pico_lib2/src/dev/dev_ds2431/dev_ds2431.h"
+#include "pico_lib2/src/dev/dev_ina219/dev_ina219.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
 #include "include/scpi_user_config.h"
 #include "include/test.h"
 #include "include/scpi_uart.h"
@@ -33,6 +36,14 @@
 #include "include/master.h"
 #include "hardware/resets.h"
 #include "include/functadv.h"
+#include "include/adc_acq.h"
+#include "include/pwr_mon.h"
+#include "include/wave_gen.h"
+#include "include/sweep.h"
+#include "include/health_mon.h"
+#include "include/adc_cal.h"
+#include "include/ee_log.h"
+#include "include/cfg_param.h"
 
 
 #include "userconfig.h"  // contains Major and Minor version
@@ -97,22 +108,8 @@ size_t output_buffer_write(const char* data, size_t len) {
  * @return size_t True if string written with success
  */
 size_t SCPI_write(scpi_t* context, const char* data, size_t len) {
-    char outbuf[SCPI_INPUT_BUFFER_SIZE];  // Global variable output buffer used to test code
-
-    // Ensure the length does not exceed the buffer size
-    if (len >= SCPI_INPUT_BUFFER_SIZE) {
-        len = SCPI_INPUT_BUFFER_SIZE - 1;
-    }
-
-    strncpy(outbuf, data, len);  // Save data string to temporary buffer
-    outbuf[len] = '\0';  // Add string termination
-
-    // Ensure UART is ready to send data before calling uart_puts
-    while (!uart_is_writable(UART_ID)) {
-        // Wait for the UART to be ready to send data
-        tight_loop_contents();  // Use this if you want to prevent the CPU from idling in an infinite loop
-    }
-    uart_puts(UART_ID, outbuf);  // Send answer to serial port
+    // Send answer to serial port, written by length to allow binary block (data could contain 0)
+    uart_write_blocking(UART_ID, (const uint8_t*)data, len);
     output_buffer_write(data, len);  // Used by test to capture output of the command
     return fwrite(data, 1, len, stdout);  // Send answer to USB port for debugging
 }
@@ -289,6 +286,33 @@ const scpi_choice_def_t scpi_special_all_numbers_def[] = {
     SCPI_CHOICE_LIST_END,
 };
 
+/**
+ * @brief List of trigger source of the ADC capture
+ *
+ */
+const scpi_choice_def_t scpi_trigger_source_def[] = {
+    {/* name */ "IMMediate", /* type */ ADC_TRIG_IMM},
+    {/* name */ "RISing", /* type */ ADC_TRIG_RISE},
+    {/* name */ "FALLing", /* type */ ADC_TRIG_FALL},
+    {/* name */ "GRISing", /* type */ ADC_TRIG_GPIO_RISE},
+    {/* name */ "GFALling", /* type */ ADC_TRIG_GPIO_FALL},
+    {/* name */ "RELay", /* type */ ADC_TRIG_RELAY},
+    SCPI_CHOICE_LIST_END,
+};
+
+/**
+ * @brief List of function of the DAC waveform generator
+ *
+ */
+const scpi_choice_def_t scpi_wave_func_def[] = {
+    {/* name */ "OFF", /* type */ WAVE_OFF},
+    {/* name */ "SIN", /* type */ WAVE_SIN},
+    {/* name */ "RAMP", /* type */ WAVE_RAMP},
+    {/* name */ "SQUare", /* type */ WAVE_SQUARE},
+    {/* name */ "ARB", /* type */ WAVE_ARB},
+    SCPI_CHOICE_LIST_END,
+};
+
 /**
  * @brief Reimplement IEEE488.2 *TST?
  *
@@ -302,6 +326,31 @@ static scpi_result_t SCPI_CallbackTstQ(scpi_t* context)
   return SCPI_RES_OK;
 }
 
+/**
+ * @brief Helper structure to store register information
+ */
+struct RegInfo
+{
+  scpi_reg_name_t preg;  // name of primary error register (Error set or clear, mandatory)
+  scpi_reg_name_t sreg;  // name of secondary register (Error set only,if required)
+  scpi_reg_val_t pbit;   // Bit to set or clear in primary register
+  scpi_reg_val_t sbit;   // Bit to set on secondary register (normally event register)
+  uint8_t nbBeep;        // Number of Beep burst for Set error
+  int16_t scpierror;     // SCPI error to push in case of Set Error
+};
+
+// Define an array of ErrorInfo structs for set value in primary register,
+// set value in secondary register (event register), send beep code burst to operator
+// and raise SCPI error message, order of reg_info_index_t
+
+static const struct RegInfo mreg[] = {
+    {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_I2C_COM, OPER_BOOT_FAIL, BEEP_I2C_FAIL, I2C_COMMUNICATION_ERROR},
+    {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_VSYS_OUTLIMIT, OPER_BOOT_FAIL, BEEP_VSYS_OUT, VSYS_OUT_LIMITS},
+    {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_MTEMP_HIGH, OPER_BOOT_FAIL, BEEP_TEMP_HIGH, TEMP_MASTER_HIGH},
+    {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_WATCHDOG, OPER_BOOT_FAIL, BEEP_WATCHDOG, WATCHDOG_TRIG},
+    {SCPI_REG_QUESC, 0, QCR_EEP_READ_ERROR, 0, BEEP_EEP_FAIL, SCPI_ERROR_MEMORY_USE_ERROR},
+};
+
 /**
  * @brief   Set Bit on SCPI register Questionable and Operation
  *          Send Bust of Beep to signal to operator the problem
@@ -313,39 +362,13 @@ static scpi_result_t SCPI_CallbackTstQ(scpi_t* context)
 
 void RegBitHdwrErr(reg_info_index_t index, bool scbit)
 {
-  volatile uint16_t regp, regs;
-  bool tbit;
-
-  // Helper structure to store register information
-  struct RegInfo
-  {
-    scpi_reg_name_t preg;  // name of primary error register (Error set or clear, mandatory)
-    scpi_reg_name_t sreg;  // name of secondary register (Error set only,if required)
-    scpi_reg_val_t pbit;   // Bit to set or clear in primary register
-    scpi_reg_val_t sbit;   // Bit to set on secondary register (normally event register)
-    uint8_t nbBeep;        // Number of Beep burst for Set error
-    int16_t scpierror;     // SCPI error to push in case of Set Error
-  };
-
-  // Define an array of ErrorInfo structs for set value in primary register,
-  // set value in secondary register (event register), send beep code burst to operator
-  // and raise SCPI error message
-
-  struct RegInfo mreg[] = {
-      {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_I2C_COM, OPER_BOOT_FAIL, BEEP_I2C_FAIL, I2C_COMMUNICATION_ERROR},
-      {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_VSYS_OUTLIMIT, OPER_BOOT_FAIL, BEEP_VSYS_OUT, VSYS_OUT_LIMITS},
-      {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_MTEMP_HIGH, OPER_BOOT_FAIL, BEEP_TEMP_HIGH, TEMP_MASTER_HIGH},
-      {SCPI_REG_QUESC, SCPI_REG_OPERC, QCR_WATCHDOG, OPER_BOOT_FAIL, BEEP_WATCHDOG, WATCHDOG_TRIG},
-      {SCPI_REG_QUESC, 0, QCR_EEP_READ_ERROR, 0, BEEP_EEP_FAIL, SCPI_ERROR_MEMORY_USE_ERROR},
-  };
-
   if (!scbit)
   {  // if bits need to be set or clear
     SCPI_RegSetBits(&scpi_context, mreg[index].preg, 1 << mreg[index].pbit);
   }
   else
   {
-    SCPI_RegClearBits(&scpi_context, mreg[index].preg, 0 << mreg[index].pbit);
+    SCPI_RegClearBits(&scpi_context, mreg[index].preg, 1 << mreg[index].pbit);
   }
 
   if (!scbit && mreg[index].sreg > 0)
@@ -360,6 +383,32 @@ void RegBitHdwrErr(reg_info_index_t index, bool scbit)
   }
 }
 
+/**
+ * @brief   Update the bit on SCPI register Questionable from a live monitor.
+ *          Only a change of the condition is reported, the error is pushed without
+ *          the burst of beep to not block the command loop.
+ *
+ * @param index Index to use on the Reginfo
+ * @param scbit Set (false) or Clear (true) the bit on register
+ */
+void RegBitHdwrLive(reg_info_index_t index, bool scbit)
+{
+  scpi_reg_val_t bit = 1 << mreg[index].pbit;
+  bool set = (SCPI_RegGet(&scpi_context, mreg[index].preg) & bit) != 0;
+
+  if (set == !scbit) return;  // no change of condition
+
+  if (!scbit)
+  {
+    SCPI_RegSetBits(&scpi_context, mreg[index].preg, bit);
+    SCPI_ErrorPush(&scpi_context, mreg[index].scpierror);  // push error on  SCPI
+  }
+  else
+  {
+    SCPI_RegClearBits(&scpi_context, mreg[index].preg, bit);
+  }
+}
+
 /**
  * @brief Parses a list of channel numbers and stores them in a 1-dimensional array.
  *
@@ -806,6 +855,21 @@ static scpi_result_t Callback_gpio_scpi(scpi_t* context)
   return SCPI_RES_OK;
 }
 
+/**
+ * @brief Return a Q16 fixed point value as decimal text, no floating point used
+ *
+ * @param context SCPI instance
+ * @param v       Value to return
+ * @return size_t Number of characters written
+ */
+static size_t SCPI_ResultQ16(scpi_t* context, q16_t v)
+{
+  char txt[16];
+  int len = q16_format(txt, sizeof(txt), v, Q16_DEF_DECIMALS);
+
+  return SCPI_ResultCharacters(context, txt, len);
+}
+
 /**
  * @brief Callback function to interpret the system command received from the SCPI port
  *
@@ -947,10 +1011,122 @@ static scpi_result_t Callback_system_scpi(scpi_t* context)
     case STBR:
       fprintf(stdout, "Run Internal Selftest # %d\n", value);
       context->buffer.position = 0;
-      internal_test_sequence(ee.cfg.testboard_num, value);
+      internal_test_sequence(cfg_val.testboard_num, value);
       SCPI_Reset(context);  // reset hardware after selftest
       break;
 
+    case GI2S:  // Read error counters of internal I2C
+    {
+      char stat_str[256];  // container for the list of counters
+      size_t len = 0;
+      sys_i2c_stat_t stat;
+
+      if (value > 0)
+      {  // counters of a single address: nack,timeout,recovery
+        stat = sys_i2c_getstat(i2c0, value);
+        sprintf(stat_str, "%d,%d,%d", stat.nack, stat.timeout, stat.recovery);
+      }
+      else
+      {  // list all addresses having errors  0xaddr:nack,timeout,recovery
+        stat_str[0] = '\0';
+        for (uint8_t addr = 0; addr < SYS_I2C_NB_ADDR; addr++)
+        {
+          stat = sys_i2c_getstat(i2c0, addr);
+          if ((stat.nack || stat.timeout || stat.recovery) && len < sizeof(stat_str) - 32)
+          {
+            len += sprintf(&stat_str[len], "%s0x%02x:%d,%d,%d", len ? "; " : "", addr, stat.nack, stat.timeout, stat.recovery);
+          }
+        }
+      }
+      fprintf(stdout, "Internal I2C error counters: %s\n", stat_str);
+      SCPI_ResultText(context, stat_str);  // sent result
+      break;
+    }
+
+    case GI2F:  // Read speed used for each device of internal I2C
+    {
+      char speed_str[160];  // container for the list of speed
+      i2c_speed_list(speed_str, sizeof(speed_str));
+      fprintf(stdout, "Internal I2C speed: %s\n", speed_str);
+      SCPI_ResultText(context, speed_str);  // sent result
+      break;
+    }
+
+    case GBEN:  // cycles of float and fixed point answer: adc volt, adc temp, pwr current, dac
+    {
+      analog_bench_t bench[ANALOG_BENCH_NB];
+
+      analog_bench(bench);
+      for (uint8_t n = 0; n < ANALOG_BENCH_NB; n++)
+      {
+        fprintf(stdout, "Benchmark %d: float %lu cycles, fixed %lu cycles\n", n, bench[n].fp_cycles, bench[n].fix_cycles);
+        SCPI_ResultUInt32(context, bench[n].fp_cycles);
+        SCPI_ResultUInt32(context, bench[n].fix_cycles);
+      }
+      break;
+    }
+
+    case GHLT:  // last VSYS (V), temperature (C) and faults of the health monitor
+    {
+      health_stat_t hs;
+
+      health_mon_get(&hs);
+      SCPI_ResultQ16(context, hs.vsys);
+      SCPI_ResultQ16(context, hs.temp);
+      SCPI_ResultBool(context, hs.vsys_fault);
+      SCPI_ResultBool(context, hs.temp_fault);
+      break;
+    }
+
+    case GHST:  // count, VSYS min,max and temperature min,max since last clear
+    {
+      health_stat_t hs;
+
+      health_mon_get(&hs);
+      SCPI_ResultUInt32(context, hs.count);
+      SCPI_ResultQ16(context, hs.vsys_min);
+      SCPI_ResultQ16(context, hs.vsys_max);
+      SCPI_ResultQ16(context, hs.temp_min);
+      SCPI_ResultQ16(context, hs.temp_max);
+      fprintf(stdout, "Health monitor: %lu samples, %lu skipped\n", hs.count, hs.skip);
+      break;
+    }
+
+    case CHST:
+      health_mon_clear();
+      break;
+
+    case SHSP:  // 0 stop the monitor
+      if (value == 0)
+      {
+        health_mon_stop();
+      }
+      else if (!health_mon_start(value))
+      {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+      }
+      break;
+
+    case GHSP:
+      SCPI_ResultUInt32(context, health_mon_period());
+      break;
+
+    case GBCT:  // boot counter of the parameter store, 0 if not available
+    {
+      uint32_t boots = 0;
+      uint8_t len;
+
+      ee_log_get(EE_KEY_BOOT_COUNT, &boots, sizeof(boots), &len);
+      SCPI_ResultUInt32(context, boots);
+      break;
+    }
+
+    case CI2S:  // Clear error counters of internal I2C
+      fprintf(stdout, "Clear internal I2C error counters\n");
+      sys_i2c_clearstat(i2c0);
+      break;
+
     default:
       break;
   }
@@ -969,9 +1145,13 @@ static scpi_result_t Callback_analog_scpi(scpi_t* context)
   scpi_parameter_t param1;
   uint16_t answer[1];  // will contains the answer returned by command
   uint8_t tag, ecode;
-  float value = 0;
-  float value2 = 0;
+  q16_t value = 0;  // measure or parameter on fixed point, converted to text only on the answer
+  q16_t value2 = 0;
   bool retv;
+  uint32_t count = adc_acq_get_count();  // number of samples averaged on ADC measure
+  adc_stat_t st;
+  bool stat = false;  // statistic returned instead of single value
+  bool over = false;  // measure saturated
 
   fprintf(stdout, "On analog execute \n");
 
@@ -985,8 +1165,12 @@ static scpi_result_t Callback_analog_scpi(scpi_t* context)
       // Is parameter a number without suffix?
       if (SCPI_ParamIsNumber(&param1, TRUE))
       {
-        // Convert parameter to float. Result is in value.
-        SCPI_ParamToFloat(context, &param1, &value);
+        // Convert parameter to fixed point. Result is in value.
+        if (!q16_parse(param1.ptr, param1.len, &value))
+        {
+          SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);  // outside of Q16 range
+          return SCPI_RES_ERR;
+        }
       }
     }
 
@@ -998,77 +1182,133 @@ static scpi_result_t Callback_analog_scpi(scpi_t* context)
         // Is parameter a number without suffix?
         if (SCPI_ParamIsNumber(&param1, TRUE))
         {
-          // Convert parameter to float. Result is in value.
-          SCPI_ParamToFloat(context, &param1, &value2);
+          // Convert parameter to fixed point. Result is in value2.
+          if (!q16_parse(param1.ptr, param1.len, &value2))
+          {
+            SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);  // outside of Q16 range
+            return SCPI_RES_ERR;
+          }
         }
       }
     }
   }
 
+  if (tag == RADC0 || tag == RADC1 || tag == RADC3 || tag == RADC4 || tag == SAVC)
+  {
+    // optional number of samples, SENSe:AVERage:COUNt value used if absent
+    res = SCPI_Parameter(context, &param1, tag == SAVC);
+    if (res && SCPI_ParamIsNumber(&param1, TRUE))
+    {
+      SCPI_ParamToUInt32(context, &param1, &count);
+    }
+    stat = (count > 1);
+  }
+
   switch (tag)
   {
     case SDAC:
-      ecode = dac_set(value, false);  // set value
+      ecode = dac_set_q(value, false);  // set value
       retv = false;                   // no value returned
       break;
 
     case WDAC:
-      ecode = dac_set(value, true);  // set value and save as default
+      ecode = dac_set_q(value, true);  // set value and save as default
       retv = false;                  // no value returned
       break;
 
     case RADC0:
-      value = read_master_adc(0);
-      ecode = NOERR;
+      if (stat)
+      {
+        ecode = adc_acq_stat(0, count, &st);  // mean,min,max,stddev of samples
+      }
+      else
+      {
+        value = read_master_adc_q(0);
+        ecode = NOERR;
+      }
       retv = true;  //  value returned
       break;
 
     case RADC1:
-      value = read_master_adc(1);
-      ecode = NOERR;
+      if (stat)
+      {
+        ecode = adc_acq_stat(1, count, &st);  // mean,min,max,stddev of samples
+      }
+      else
+      {
+        value = read_master_adc_q(1);
+        ecode = NOERR;
+      }
       retv = true;  //  value returned
       break;
 
     case RADC3:
-      value = read_master_adc(3);
-      ecode = NOERR;
+      if (stat)
+      {
+        ecode = adc_acq_stat(3, count, &st);  // mean,min,max,stddev of samples
+      }
+      else
+      {
+        value = read_master_adc_q(3);
+        ecode = NOERR;
+      }
       retv = true;  //  value returned
       break;
 
     case RADC4:
-      value = read_master_adc(4);
-      ecode = NOERR;
+      if (stat)
+      {
+        ecode = adc_acq_stat(4, count, &st);  // mean,min,max,stddev of samples
+      }
+      else
+      {
+        value = read_master_adc_q(4);
+        ecode = NOERR;
+      }
       retv = true;  //  value returned
       break;
 
     case RPV:
-      value = read_power(0);
+      value = read_power_q(0, NULL);
       ecode = NOERR;
       retv = true;  //  value returned
       break;
 
     case RPI:
-      value = read_power(1);
+      value = read_power_q(1, NULL);
       ecode = NOERR;
       retv = true;  //  value returned
       break;
 
     case RPP:
-      value = read_power(2);
+      value = read_power_q(2, &over);
+      if (over) SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);  // power saturated to the Q16 limit
       ecode = NOERR;
       retv = true;  //  value returned
       break;
 
     case RPS:
-      value = read_power(3);
+      value = read_power_q(3, NULL);
       ecode = NOERR;
       retv = true;  //  value returned
       break;
 
     case CPI:
-      calibrate_power(value, value2);
+      calibrate_power_q(value, value2);
+      retv = false;  //  no value to return
+      break;
+
+    case SAVC:
+      ecode = adc_acq_set_count(count);
+      stat = false;
       retv = false;  //  no value to return
       break;
+
+    case GAVC:
+      SCPI_ResultUInt32(context, adc_acq_get_count());
+      ecode = NOERR;
+      retv = false;  //  value already returned
+      break;
   }
 
   // raise error if is the case
@@ -1088,202 +1328,730 @@ static scpi_result_t Callback_analog_scpi(scpi_t* context)
       break;
   }
 
-  if (retv)
-  {                                    // if returned value is expected
-    SCPI_ResultFloat(context, value);  // return SCPI value
+  if (retv && stat && ecode == NOERR)
+  {  // statistic returned as mean,min,max,stddev
+    SCPI_ResultFloat(context, st.mean);
+    SCPI_ResultFloat(context, st.min);
+    SCPI_ResultFloat(context, st.max);
+    SCPI_ResultFloat(context, st.stddev);
+  }
+  else if (retv)
+  {                                  // if returned value is expected
+    SCPI_ResultQ16(context, value);  // return SCPI value
   }
 
   return SCPI_RES_OK;
 }
 
 /**
- * @brief Callback function to interpret the eeprom command received from the SCPI port
+ * @brief Callback function to interpret the DAC waveform command received from the SCPI port
  *
  * @param context SCPI instance
  */
 
-static scpi_result_t Callback_eeprom_scpi(scpi_t* context)
+static scpi_result_t Callback_source_scpi(scpi_t* context)
 {
-  scpi_bool_t res;
   scpi_parameter_t param1;
-  scpi_parameter_t param2;
-  uint16_t answer;  // will contains the answer returned by command
-  uint8_t tag;
-  char* split;
-  uint8_t status = NOERR;
-  char sfull[64], pstr[96];
-  uint32_t value;  // value of parameter
-  char varname[32], svalue[32];
-  size_t i;
-  char* tnptr;
-  long cnum;
-  char mode = '\0';  // default value
-
-  // Helper structure to store member information
-  struct ParamInfo
-  {
-    const char* name;  // name of parameter
-    size_t offset;     // offset on the structure for the parameter
-    size_t size;       // size of the parameter
-    bool isnum;        // set to TRUE if number is mandatory
-  };
-
-  for (i = 0; i < 32; i++)
-  {
-    svalue[i] = '\0';
-  }  // initialize array
+  uint16_t answer[1];  // will contains the answer returned by command
+  uint8_t tag, ecode = NOERR;
+  int32_t func;
+  q16_t value = 0;
+  const char* name;
+  const char* data;
+  size_t len;
 
-  // Define an array of MemberInfo structs with member names, offsets, and sizes
-  // Each parameter to Read/Write on EEPROM need to be added on this array
-  // The last field (true or false is to validate if the parameter is a number or not
-
-  struct ParamInfo members[] = {
-      {CHECK, offsetof(cfg, check), sizeof(((cfg*)0)->check), FALSE},
-      {PARTNUMBER, offsetof(cfg, partnumber), sizeof(((cfg*)0)->partnumber), FALSE},
-      {SERIALNUMBER, offsetof(cfg, serialnumber), sizeof(((cfg*)0)->serialnumber), FALSE},
-      {MOD_OPTION, offsetof(cfg, mod_option), sizeof(((cfg*)0)->mod_option), FALSE},
-      {COM_SER_SPEED, offsetof(cfg, com_ser_speed), sizeof(((cfg*)0)->com_ser_speed), TRUE},
-      {COM_SER_ECHO, offsetof(cfg, com_ser_echo), sizeof(((cfg*)0)->com_ser_echo), TRUE},
-      {PSLAVE_RUN, offsetof(cfg, slave_force_run), sizeof(((cfg*)0)->slave_force_run), TRUE},
-      {TESTBOARD_NUM, offsetof(cfg, testboard_num), sizeof(((cfg*)0)->testboard_num), FALSE},
-      {PARAMETER1, offsetof(cfg, parameter1), sizeof(((cfg*)0)->parameter1), FALSE},
-      {PARAMETER2, offsetof(cfg, parameter2), sizeof(((cfg*)0)->parameter2), FALSE},
-      {PARAMETER3, offsetof(cfg, parameter3), sizeof(((cfg*)0)->parameter3), FALSE},
-      {PARAMETER4, offsetof(cfg, parameter4), sizeof(((cfg*)0)->parameter4), FALSE},
-      {PARAMETER5, offsetof(cfg, parameter5), sizeof(((cfg*)0)->parameter5), FALSE},
-      {TEST, offsetof(cfg, test), sizeof(((cfg*)0)->test), FALSE}
-
-  };
+  fprintf(stdout, "On source execute \n");
 
-  fprintf(stdout, "\n\nOn eeprom execute \n");
   tag = SCPI_CmdTag(context);  // extract tag from the command
 
-  // calculate the number of members
-  size_t numMembers = sizeof(members) / sizeof(members[0]);
+  if (tag == SWFR || tag == SWAM || tag == SWOF)
+  {
+    if (!SCPI_Parameter(context, &param1, TRUE)) return SCPI_RES_ERR;
+    if (!SCPI_ParamIsNumber(&param1, TRUE) || !q16_parse(param1.ptr, param1.len, &value))
+    {
+      SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+      return SCPI_RES_ERR;
+    }
+  }
 
   switch (tag)
   {
-    case WDEF:
-      status = cfg_eeprom_write_default();
-      break;
-    case RFUL:
-      status = cfg_eeprom_read_full();
-      if (status != NOERR)
-      {
-        break;
-      }  // if error do not execute the eeprom reading
-      fprintf(stdout, "\n\nEEprom full content: \n");
-      for (i = 0; i < numMembers; ++i)
-      {
-        // copy parameter to string
-        strncpy(sfull, &ee.data[members[i].offset], members[i].size);
-        sfull[members[i].size] = '\0';                       // add end of string to temporary buffer
-        sprintf(pstr, "%s = %s  ", members[i].name, sfull);  // build string to return
-        // fprintf(stdout,"Parameter %s\n",pstr);
-        SCPI_ResultCharacters(context, pstr, strlen(pstr));  // return value
-      }
+    case SWFN:
+      if (!SCPI_ParamChoice(context, scpi_wave_func_def, &func, TRUE)) return SCPI_RES_ERR;
+      ecode = wave_set_func(func);
       break;
-    case WEEP:
-      mode = 'w';  // write mode
+
+    case GWFN:
+      SCPI_ChoiceToName(scpi_wave_func_def, wave_get_func(), &name);
+      SCPI_ResultMnemonic(context, name);
       break;
-    case REEP:
-      mode = 'r';  // read mode
+
+    case SWFR:
+      ecode = wave_set_freq(value);
       break;
-  }
 
-  // Run only for read write parameter on eeprom
-  // extract varname and svalue
-  if (tag == WEEP || tag == REEP)
-  {
- 
-    res = SCPI_Parameter(context, &param1, true);  // Read first parameter
-    if (res == false)
-    {
-      return SCPI_RES_ERR;
-    }  // if no parameter read, raise error and exit
+    case GWFR:
+      SCPI_ResultQ16(context, wave_get_freq());
+      break;
 
-  
-    // Split the string to distinguishes between varnames and the svalue
-    split = strtok(param1.ptr, " ', \n");
-    strcpy(varname, split);
-    strupr(varname);
-    fprintf(stdout, "EEprom varname = %s\n", varname);
+    case SWAM:
+      ecode = wave_set_ampl(value);
+      break;
 
-    if (tag == WEEP)
-    {             
-      res = SCPI_Parameter(context, &param2, true);  // Read second parameter
-      if (res == false)
-      {
-        return SCPI_RES_ERR;
-      }  // if no parameter read, raise error and exit
+    case GWAM:
+      SCPI_ResultQ16(context, wave_get_ampl());
+      break;
 
-                            // if tag  = Write command
-      split = strtok(param2.ptr, "\" ',\n");  // Extract second parameter from the command
-      strcpy(svalue, split);            // copy second parameter to svalue
-      strupr(svalue);                   // change lowercase to upper case
-      if (svalue[0] == '\0')
-      {  // if svalue not present, raise error
-        fprintf(stdout, "Error, no svalue to write on eeprom \n");
-        status = EMP;  // Set error flag
-      }
-      else
-      {
-        fprintf(stdout, "EEprom svalue = %s\n", svalue);
-      }
-    }
-  }
-  if (mode == 'w' || mode == 'r')
-  {
-    bool found = false;  // set flag default value
+    case SWOF:
+      ecode = wave_set_offset(value);
+      break;
 
-    if (status == NOERR)
-    {  // if no error found.
-      // Loop through the member info array to find matching member name
-      for (i = 0; i < numMembers; ++i)
-      {
-        if (strcmp(varname, members[i].name) == 0)
-        {
-          fprintf(stdout, "Cfg struct parameter: %s , offset: %u, size: %u\n", varname, members[i].offset, members[i].size);
-          found = true;
-          break;
-        }
-      }
-      if (!found)
-      {
-        status = EIVN;
-      }
+    case GWOF:
+      SCPI_ResultQ16(context, wave_get_offset());
+      break;
 
-      // check if svalue is a number in case we expect number
-      if (found == true && mode == 'w' && members[i].isnum == 1)
-      {
-        long number;
-        int check = stringtonumber(svalue, sizeof(svalue), &number);
-        if (check != 0)
-        {
-          status = ENDE;  // raise error if not a number
-        }
-      }
+    case SWAD:
+    case SWAA:  // DAC codes 16 bits little endian, block limited by the SCPI input buffer
+      if (!SCPI_ParamArbitraryBlock(context, &data, &len, TRUE)) return SCPI_RES_ERR;
+      ecode = wave_arb_load((const uint8_t*)data, len, tag == SWAA);
+      break;
 
-      if (found && status == NOERR)
-      {                                                                                            // if varname found
-        status = cfg_eeprom_rw(mode, members[i].offset, members[i].size, svalue, strlen(svalue));  // write or read data on eeprom
-        if (status == NOERR)
-        {
-          strncpy(&ee.data[members[i].offset], svalue, members[i].size);  // save parameter on eeprom structure
-          if (mode == 'r')
-          {
-            SCPI_ResultCharacters(context, &ee.data[members[i].offset], members[i].size);  // return value
-          }
-        }
-      }
-    }
+    case GWAP:
+      SCPI_ResultUInt32(context, wave_arb_points());
+      break;
   }
 
   // raise error if is the case
-  switch (status)
+  switch (ecode)
   {
     case NOERR:
-    {
+      break;
+
+    case EOOR:
+    case ECE:
+      answer[0] = SCPI_ERROR_ILLEGAL_PARAMETER_VALUE;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+
+    default:
+      answer[0] = SCPI_ERROR_EXECUTION_ERROR;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+  }
+
+  return SCPI_RES_OK;
+}
+
+/**
+ * @brief Callback function to interpret the DAC sweep command received from the SCPI port
+ *
+ * @param context SCPI instance
+ */
+
+static scpi_result_t Callback_sweep_scpi(scpi_t* context)
+{
+  scpi_parameter_t param1;
+  uint16_t answer[1];  // will contains the answer returned by command
+  uint8_t tag, ecode = NOERR;
+  q16_t volt = 0;
+  uint32_t value = 0;
+  scpi_bool_t enable;
+  const sweep_point_t* pt;
+
+  fprintf(stdout, "On sweep execute \n");
+
+  tag = SCPI_CmdTag(context);  // extract tag from the command
+
+  if (tag == SSWS || tag == SSWE)
+  {
+    if (!SCPI_Parameter(context, &param1, TRUE)) return SCPI_RES_ERR;
+    if (!SCPI_ParamIsNumber(&param1, TRUE) || !q16_parse(param1.ptr, param1.len, &volt))
+    {
+      SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+      return SCPI_RES_ERR;
+    }
+  }
+
+  if (tag == SSWP || tag == SSWD)
+  {
+    if (!SCPI_ParamUInt32(context, &value, TRUE)) return SCPI_RES_ERR;
+  }
+
+  switch (tag)
+  {
+    case SSWS:
+      ecode = sweep_set_start(volt);
+      break;
+
+    case GSWS:
+      SCPI_ResultQ16(context, sweep_get_start());
+      break;
+
+    case SSWE:
+      ecode = sweep_set_stop(volt);
+      break;
+
+    case GSWE:
+      SCPI_ResultQ16(context, sweep_get_stop());
+      break;
+
+    case SSWP:
+      ecode = sweep_set_points(value);
+      break;
+
+    case GSWP:
+      SCPI_ResultUInt32(context, sweep_get_points());
+      break;
+
+    case SSWD:
+      ecode = sweep_set_dwell(value);
+      break;
+
+    case GSWD:
+      SCPI_ResultUInt32(context, sweep_get_dwell());
+      break;
+
+    case SSWC:
+      if (!SCPI_ParamBool(context, &enable, TRUE)) return SCPI_RES_ERR;
+      sweep_set_current(enable);
+      break;
+
+    case GSWC:
+      SCPI_ResultBool(context, sweep_get_current());
+      break;
+
+    case RSWD:
+      ecode = sweep_run(&pt, &value);
+      if (ecode == NOERR)
+      {  // DAC code, raw ADC0, raw ADC1 (16 bits) and current (uA, 32 bits) little endian for each point
+        SCPI_ResultArbitraryBlockHeader(context, value * sizeof(sweep_point_t));
+        SCPI_ResultArbitraryBlockData(context, pt, value * sizeof(sweep_point_t));
+      }
+      break;
+  }
+
+  // raise error if is the case
+  switch (ecode)
+  {
+    case NOERR:
+      break;
+
+    case EOOR:
+      answer[0] = SCPI_ERROR_ILLEGAL_PARAMETER_VALUE;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+
+    default:
+      answer[0] = SCPI_ERROR_EXECUTION_ERROR;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+  }
+
+  return SCPI_RES_OK;
+}
+
+/**
+ * @brief Callback function to interpret the ADC calibration command received from the SCPI port
+ *
+ * @param context SCPI instance
+ */
+
+static scpi_result_t Callback_calibration_scpi(scpi_t* context)
+{
+  scpi_parameter_t param1;
+  uint16_t answer[1];        // will contains the answer returned by command
+  int32_t numbers[1] = {0};  // ADC number on the command
+  uint8_t tag, ecode = NOERR;
+  q16_t value = 0;
+  q16_t gain, offset;
+
+  fprintf(stdout, "On calibration execute \n");
+
+  tag = SCPI_CmdTag(context);                   // extract tag from the command
+  SCPI_CommandNumbers(context, numbers, 1, 0);  // ADC number
+
+  if (tag == SCAG || tag == SCAO)
+  {
+    if (!SCPI_Parameter(context, &param1, TRUE)) return SCPI_RES_ERR;
+    if (!SCPI_ParamIsNumber(&param1, TRUE) || !q16_parse(param1.ptr, param1.len, &value))
+    {
+      SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+      return SCPI_RES_ERR;
+    }
+  }
+
+  if (tag != RCAL)
+  {
+    ecode = adc_cal_get(numbers[0], &gain, &offset);  // validate ADC number
+  }
+
+  if (ecode == NOERR)
+  {
+    switch (tag)
+    {
+      case SCAG:
+        ecode = adc_cal_set(numbers[0], value, offset);
+        break;
+
+      case GCAG:
+        SCPI_ResultQ16(context, gain);
+        break;
+
+      case SCAO:
+        ecode = adc_cal_set(numbers[0], gain, value);
+        break;
+
+      case GCAO:
+        SCPI_ResultQ16(context, offset);
+        break;
+
+      case ACAL:  // DAC output connected to the ADC input
+        ecode = adc_cal_auto(numbers[0]);
+        break;
+
+      case RCAL:
+        ecode = adc_cal_reset();
+        break;
+    }
+  }
+
+  // raise error if is the case
+  switch (ecode)
+  {
+    case NOERR:
+      break;
+
+    case EOOR:
+      answer[0] = SCPI_ERROR_ILLEGAL_PARAMETER_VALUE;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+
+    case ECE:
+    case EDE:
+      answer[0] = SCPI_ERROR_MASS_STORAGE_ERROR;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+
+    default:
+      answer[0] = SCPI_ERROR_EXECUTION_ERROR;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+  }
+
+  return SCPI_RES_OK;
+}
+
+/**
+ * @brief Callback function to interpret the power monitor command received from the SCPI port
+ *        The answer is computed from the statistic kept in RAM by the background sampler
+ *
+ * @param context SCPI instance
+ */
+
+static scpi_result_t Callback_power_scpi(scpi_t* context)
+{
+  uint8_t tag;
+  uint32_t value;
+  pwr_stat_t st;
+  float n;
+  float peak, settle;
+  const pwr_cap_point_t* pt;
+  uint32_t samples;
+  uint8_t bits, nsamp;
+
+  fprintf(stdout, "On power execute \n");
+
+  tag = SCPI_CmdTag(context);  // extract tag from the command
+
+  switch (tag)
+  {
+    case GPST:  // count, voltage (V), current (mA) and power (mW): min,max,mean
+      pwr_mon_get(&st);
+      n = (st.count > 0) ? (float)st.count : 1;
+      SCPI_ResultUInt32(context, st.count);
+      SCPI_ResultFloat(context, st.v_min * 1E-3f);
+      SCPI_ResultFloat(context, st.v_max * 1E-3f);
+      SCPI_ResultFloat(context, st.v_sum * 1E-3f / n);
+      SCPI_ResultFloat(context, st.i_min * 1E-3f);
+      SCPI_ResultFloat(context, st.i_max * 1E-3f);
+      SCPI_ResultFloat(context, st.i_sum * 1E-3f / n);
+      SCPI_ResultFloat(context, st.p_min * 1E-3f);
+      SCPI_ResultFloat(context, st.p_max * 1E-3f);
+      SCPI_ResultFloat(context, st.p_sum * 1E-3f / n);
+      fprintf(stdout, "Power monitor: %lu samples, %lu skipped, %lu errors\n", st.count, st.skip, st.error);
+      break;
+
+    case GPEN:  // energy (mWh), charge (mAh) and integration time (s)
+      pwr_mon_get(&st);
+      SCPI_ResultDouble(context, (st.energy_uwh + (double)st.energy_rem / PWR_MON_NWUS_PER_UWH) * 1E-3);
+      SCPI_ResultDouble(context, (st.charge_uah + (double)st.charge_rem / PWR_MON_UAUS_PER_UAH) * 1E-3);
+      SCPI_ResultDouble(context, st.time_us * 1E-6);
+      break;
+
+    case CPST:
+      pwr_mon_clear();
+      break;
+
+    case SPSP:  // 0 stop the monitor
+      if (!SCPI_ParamUInt32(context, &value, TRUE)) return SCPI_RES_ERR;
+      if (value == 0)
+      {
+        pwr_mon_stop();
+      }
+      else if (!pwr_mon_start(value))
+      {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+      }
+      break;
+
+    case GPSP:
+      SCPI_ResultUInt32(context, pwr_mon_period());
+      break;
+
+    case SPAM:  // resolution (bits) and optional number of samples averaged
+      if (!SCPI_ParamUInt32(context, &value, TRUE)) return SCPI_RES_ERR;
+      samples = 1;
+      SCPI_ParamUInt32(context, &samples, FALSE);
+      if (value > 12 || samples > INA219_ADC_MAX_SAMPLES || !ina219SetAdcMode(value, samples))
+      {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+      }
+      break;
+
+    case GPAM:  // resolution, samples averaged and time of one measure (us)
+      ina219GetAdcMode(&bits, &nsamp, &value);
+      SCPI_ResultUInt8(context, bits);
+      SCPI_ResultUInt8(context, nsamp);
+      SCPI_ResultUInt32(context, value);
+      break;
+
+    case APCA:  // number of points is optional
+      value = PWR_CAP_DEF_POINTS;
+      SCPI_ParamUInt32(context, &value, FALSE);
+      if (pwr_cap_arm(value) != NOERR)
+      {
+        SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+        return SCPI_RES_ERR;
+      }
+      break;
+
+    case GPCS:
+      SCPI_ResultUInt8(context, pwr_cap_state());
+      break;
+
+    case GPCR:  // peak current (mA), settle time (ms) and number of points
+      if (!pwr_cap_result(&peak, &settle, &value))
+      {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+      }
+      SCPI_ResultFloat(context, peak);
+      SCPI_ResultFloat(context, settle);
+      SCPI_ResultUInt32(context, value);
+      break;
+
+    case GPCD:
+      pt = pwr_cap_data(&value);
+      if (pt == NULL)
+      {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+      }
+      // time (us, 32 bits) and raw shunt (10uV, 16 bits) little endian for each point
+      SCPI_ResultArbitraryBlockHeader(context, value * sizeof(pwr_cap_point_t));
+      SCPI_ResultArbitraryBlockData(context, pt, value * sizeof(pwr_cap_point_t));
+      break;
+  }
+
+  return SCPI_RES_OK;
+}
+
+/**
+ * @brief Callback function to interpret the ADC capture command received from the SCPI port
+ *
+ * @param context SCPI instance
+ */
+
+static scpi_result_t Callback_acquire_scpi(scpi_t* context)
+{
+  scpi_parameter_t param1;
+  uint16_t answer[1];           // will contains the answer returned by command
+  int32_t numbers[1] = {0};     // ADC number on the command
+  int32_t source = 0;
+  uint32_t value = 0;
+  float level = 0;
+  uint8_t tag, ecode = NOERR;
+  const adc_cap_cfg_t* cfg;
+  const char* name;
+  const uint16_t *p1, *p2;
+  uint32_t n1, n2;
+
+  fprintf(stdout, "On acquire execute \n");
+
+  tag = SCPI_CmdTag(context);                   // extract tag from the command
+  SCPI_CommandNumbers(context, numbers, 1, 0);  // ADC number
+  cfg = adc_cap_get_cfg(numbers[0]);
+
+  if (cfg == NULL)
+  {  // only ADC0 and ADC1 could be captured
+    SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+    return SCPI_RES_ERR;
+  }
+
+  if (tag == SAQR || tag == SAQP || tag == SAQE)
+  {
+    if (!SCPI_ParamUInt32(context, &value, TRUE)) return SCPI_RES_ERR;
+  }
+
+  if (tag == SAQT)
+  {
+    if (!SCPI_ParamChoice(context, scpi_trigger_source_def, &source, TRUE)) return SCPI_RES_ERR;
+    if (source == ADC_TRIG_RISE || source == ADC_TRIG_FALL)
+    {  // level in Volt
+      if (!SCPI_ParamFloat(context, &level, TRUE)) return SCPI_RES_ERR;
+    }
+    if (source == ADC_TRIG_GPIO_RISE || source == ADC_TRIG_GPIO_FALL)
+    {  // GPIO number
+      if (!SCPI_ParamUInt32(context, &value, TRUE)) return SCPI_RES_ERR;
+    }
+  }
+
+  switch (tag)
+  {
+    case SAQR:
+      ecode = adc_cap_set_rate(numbers[0], value);
+      break;
+
+    case GAQR:
+      SCPI_ResultUInt32(context, cfg->rate);
+      break;
+
+    case SAQP:
+      ecode = adc_cap_set_points(numbers[0], value);
+      break;
+
+    case GAQP:
+      SCPI_ResultUInt32(context, cfg->points);
+      break;
+
+    case SAQE:
+      ecode = adc_cap_set_pretrig(numbers[0], value);
+      break;
+
+    case GAQE:
+      SCPI_ResultUInt32(context, cfg->pretrig);
+      break;
+
+    case SAQT:
+      ecode = adc_cap_set_trigger(numbers[0], source, level, (value > 255) ? 255 : value);
+      break;
+
+    case GAQT:
+      SCPI_ChoiceToName(scpi_trigger_source_def, cfg->source, &name);
+      SCPI_ResultMnemonic(context, name);
+      if (cfg->source == ADC_TRIG_RISE || cfg->source == ADC_TRIG_FALL) SCPI_ResultFloat(context, cfg->level);
+      if (cfg->source == ADC_TRIG_GPIO_RISE || cfg->source == ADC_TRIG_GPIO_FALL) SCPI_ResultUInt8(context, cfg->pin);
+      break;
+
+    case IAQ:
+      ecode = adc_cap_init(numbers[0]);
+      break;
+
+    case AAQ:
+      adc_cap_abort();
+      break;
+
+    case GAQS:
+      SCPI_ResultUInt8(context, adc_cap_state());
+      break;
+
+    case FAQ:
+      ecode = adc_cap_data(numbers[0], &p1, &n1, &p2, &n2);
+      if (ecode == NOERR)
+      {  // raw 12 bits ADC count, 16 bits little endian, send as one block without copy
+        SCPI_ResultArbitraryBlockHeader(context, (n1 + n2) * sizeof(uint16_t));
+        SCPI_ResultArbitraryBlockData(context, p1, n1 * sizeof(uint16_t));
+        if (n2) SCPI_ResultArbitraryBlockData(context, p2, n2 * sizeof(uint16_t));
+      }
+      break;
+  }
+
+  // raise error if is the case
+  switch (ecode)
+  {
+    case NOERR:
+      break;
+
+    case EOOR:
+      answer[0] = SCPI_ERROR_ILLEGAL_PARAMETER_VALUE;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+
+    default:
+      answer[0] = SCPI_ERROR_EXECUTION_ERROR;
+      SCPI_ErrorPush(context, answer[0]);
+      return SCPI_RES_ERR;
+  }
+
+  return SCPI_RES_OK;
+}
+
+/**
+ * @brief Callback function to interpret the eeprom command received from the SCPI port
+ *
+ * @param context SCPI instance
+ */
+
+static scpi_result_t Callback_eeprom_scpi(scpi_t* context)
+{
+  scpi_bool_t res;
+  scpi_parameter_t param1;
+  scpi_parameter_t param2;
+  uint16_t answer;  // will contains the answer returned by command
+  uint8_t tag;
+  char* split;
+  uint8_t status = NOERR;
+  char sfull[CFG_TEXT_SIZE], pstr[64];
+  char varname[32], svalue[32];
+  size_t i;
+  int id = -1;       // parameter of the schema
+  char mode = '\0';  // default value
+
+  for (i = 0; i < 32; i++)
+  {
+    svalue[i] = '\0';
+  }  // initialize array
+
+  fprintf(stdout, "\n\nOn eeprom execute \n");
+  tag = SCPI_CmdTag(context);  // extract tag from the command
+
+  switch (tag)
+  {
+    case WDEF:
+      status = cfg_param_default();
+      break;
+    case RFUL:
+      status = cfg_param_state();  // content is on RAM since boot
+      if (status != NOERR)
+      {
+        break;
+      }  // if error do not execute the eeprom reading
+      fprintf(stdout, "\n\nEEprom full content: \n");
+      for (i = 0; i < CFG_NB_PARAM; ++i)
+      {
+        cfg_param_get_text(i, sfull, sizeof(sfull));           // text of the value
+        sprintf(pstr, "%s = %s  ", cfg_param_name(i), sfull);  // build string to return
+        SCPI_ResultCharacters(context, pstr, strlen(pstr));    // return value
+      }
+      break;
+    case WEEP:
+      mode = 'w';  // write mode
+      break;
+    case REEP:
+      mode = 'r';  // read mode
+      break;
+    case CSAV:
+      status = cfg_eeprom_flush(true);  // modified parameters written and verified
+      break;
+    case QSAV:
+      SCPI_ResultUInt32(context, cfg_eeprom_dirty());
+      break;
+    case GLOG:
+    {
+      ee_log_status_t st;
+
+      ee_log_status(&st);
+      SCPI_ResultUInt8(context, st.bank);
+      SCPI_ResultUInt32(context, st.gen);
+      SCPI_ResultUInt32(context, st.used);
+      SCPI_ResultUInt32(context, EE_LOG_BANK_SIZE);
+      SCPI_ResultUInt32(context, st.keys);
+      SCPI_ResultUInt32(context, st.compactions);
+      SCPI_ResultUInt32(context, st.errors);
+      break;
+    }
+    case CLOG:
+      status = ee_log_compact();
+      break;
+  }
+
+  // Run only for read write parameter on eeprom
+  // extract varname and svalue
+  if (tag == WEEP || tag == REEP)
+  {
+ 
+    res = SCPI_Parameter(context, &param1, true);  // Read first parameter
+    if (res == false)
+    {
+      return SCPI_RES_ERR;
+    }  // if no parameter read, raise error and exit
+
+  
+    // Split the string to distinguishes between varnames and the svalue
+    split = strtok(param1.ptr, " ', \n");
+    strcpy(varname, split);
+    strupr(varname);
+    fprintf(stdout, "EEprom varname = %s\n", varname);
+
+    if (tag == WEEP)
+    {             
+      res = SCPI_Parameter(context, &param2, true);  // Read second parameter
+      if (res == false)
+      {
+        return SCPI_RES_ERR;
+      }  // if no parameter read, raise error and exit
+
+                            // if tag  = Write command
+      split = strtok(param2.ptr, "\" ',\n");  // Extract second parameter from the command
+      strcpy(svalue, split);            // copy second parameter to svalue
+      strupr(svalue);                   // change lowercase to upper case
+      if (svalue[0] == '\0')
+      {  // if svalue not present, raise error
+        fprintf(stdout, "Error, no svalue to write on eeprom \n");
+        status = EMP;  // Set error flag
+      }
+      else
+      {
+        fprintf(stdout, "EEprom svalue = %s\n", svalue);
+      }
+    }
+  }
+  if (mode == 'w' || mode == 'r')
+  {
+    if (status == NOERR)
+    {  // if no error found.
+      status = cfg_param_state();  // configuration must be loaded from the parameter store
+    }
+    if (status == NOERR)
+    {
+      id = cfg_param_find(varname);  // perfect hash on the names of the schema
+      if (id < 0)
+      {
+        status = EIVN;
+      }
+    }
+    if (status == NOERR)
+    {
+      fprintf(stdout, "Cfg parameter: %s\n", cfg_param_name(id));
+      if (mode == 'w')
+      {
+        status = cfg_param_set_text(id, svalue);  // converted and checked, written in background
+      }
+      else
+      {
+        cfg_param_get_text(id, sfull, sizeof(sfull));
+        SCPI_ResultCharacters(context, sfull, strlen(sfull));  // return value
+      }
+    }
+  }
+
+  // raise error if is the case
+  switch (status)
+  {
+    case NOERR:
+    {
       break;
     }
     case ENDE:
@@ -1354,8 +2122,9 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
   bool retv = false;
   bool bval;
   const char* dpr;
+  const char* steps[USER_EXP_STEPS];  // steps of the expect script
+  uint8_t match, done;
 
-  char* sdata = NULL;
   char winfo[SCPI_INPUT_BUFFER_SIZE];  // big string to contents filtered data
   char ustr[SCPI_INPUT_BUFFER_SIZE];   // big string to get temporary data
 
@@ -1368,7 +2137,7 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
 
   fprintf(stdout, "Tag = %d \n", tag);
 
-  if (tag == CSWH)
+  if (tag == CSWH || tag == CSCA)
   {
     // if ON or OFF, transform to value 0 or 1
     res = SCPI_Parameter(context, &param1, true);  // Read first parameter
@@ -1398,7 +2167,7 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
     }
   }
 
-  if (tag == W1W || tag == CSWP)
+  if (tag == W1W || tag == CSWP || tag == CSWE)
   {
     res = SCPI_Parameter(context, &param1, true);  // Read first parameter
     if (res)
@@ -1415,6 +2184,7 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
           winfo[j++] = str[i];
         }
       }
+      winfo[j] = '\0';
     }
   }
 
@@ -1449,6 +2219,30 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
     }
   }
 
+  if (tag == CSEX)
+  {  // pattern mandatory, timeout not mandatory
+    val = scpi_uart_get_timeout();
+    res = SCPI_ParamCopyText(context, winfo, sizeof(winfo), &lgt, true);
+    if (res)
+    {
+      SCPI_ParamUInt32(context, &val, false);
+    }
+  }
+
+  if (tag == CSSC)
+  {  // timeout, then patterns and strings to send alternated, kept one after the other on winfo
+    res = SCPI_ParamUInt32(context, &val, true);
+    eid = 0;  // number of steps
+    lgt = 0;
+    size_t pos = 0;
+    while (res && eid < USER_EXP_STEPS && pos < sizeof(winfo) &&
+           SCPI_ParamCopyText(context, winfo + pos, sizeof(winfo) - pos, &lgt, false))
+    {
+      steps[eid++] = winfo + pos;
+      pos += lgt + 1;
+    }
+  }
+
   if (tag == CIE || tag == CID || tag == CRI)
   {
     // extract special word as parameter
@@ -1522,19 +2316,24 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
   switch (tag)
   {
     case C1W:
-      ecode = onewire_check_devices(&sdata, eid);  // check presence of one wire
-      SCPI_ResultText(context, sdata);
+      ecode = onewire_check_devices(ustr, sizeof(ustr), eid);  // check presence of one wire
+      SCPI_ResultText(context, ustr);
       break;
 
     case R1W:
-      ecode = onewire_read_info(&sdata, ADDR_INFO, NB_INFO, eid);
-      SCPI_ResultText(context, sdata);
+      ecode = onewire_read_info(ustr, sizeof(ustr), ADDR_INFO, NB_INFO, eid);
+      SCPI_ResultText(context, ustr);
       break;
 
     case W1W:
       ecode = onewire_write_info(winfo, ADDR_INFO);
       break;
 
+    case Q1W:
+      ecode = onewire_read_roms(ustr, sizeof(ustr));
+      SCPI_ResultText(context, ustr);
+      break;
+
     case CSWB:
       fprintf(stdout, "Serial set Baudrate to %d\n", val);
       scpi_uart_set_baudrate(val);
@@ -1604,6 +2403,65 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
         SCPI_ResultText(context, ustr);  // return string with or without error
       }
       break;
+
+    case CSWE:
+      ecode = scpi_uart_set_terminator(winfo);
+      if (ecode != NOCERR)
+      {
+        fprintf(stdout, "Serial terminator error with value: %s\n", winfo);
+      }
+      break;
+
+    case CSRE:
+      dpr = scpi_uart_get_terminator();
+      fprintf(stdout, "Serial readback terminator: %s\n", dpr);
+      SCPI_ResultText(context, dpr);
+      break;
+
+    case CSCA:
+      ecode = scpi_uart_capture(val);
+      break;
+
+    case CSCS:
+      SCPI_ResultBool(context, scpi_uart_capture_state());
+      break;
+
+    case CSCD:
+    {
+      const uint8_t *p1, *p2;
+      size_t n1, n2;
+      uint32_t lost = scpi_uart_capture_data(&p1, &n1, &p2, &n2);
+      fprintf(stdout, "Serial capture read %lu bytes, %" PRIu32 " bytes lost\n", (unsigned long)(n1 + n2), lost);
+      SCPI_ResultArbitraryBlockHeader(context, n1 + n2);  // send as one block without copy
+      SCPI_ResultArbitraryBlockData(context, p1, n1);
+      if (n2) SCPI_ResultArbitraryBlockData(context, p2, n2);
+      break;
+    }
+
+    case CSCC:
+      SCPI_ResultUInt32(context, scpi_uart_capture_count());
+      break;
+
+    case CSEX:
+      if (!res) break;
+      ecode = scpi_uart_expect(winfo, val, &match, ustr, SCPI_INPUT_BUFFER_SIZE);
+      if (ecode == NOCERR)
+      {
+        SCPI_ResultUInt8(context, match);  // 0 if timeout
+        SCPI_ResultText(context, ustr);
+      }
+      break;
+
+    case CSSC:
+      if (!res) break;
+      ecode = scpi_uart_expect_script(steps, eid, val, &done, &match, ustr, SCPI_INPUT_BUFFER_SIZE);
+      if (ecode == NOCERR)
+      {
+        SCPI_ResultUInt8(context, done);   // pairs done, all if success
+        SCPI_ResultUInt8(context, match);  // pattern found on the last wait, 0 if timeout
+        SCPI_ResultText(context, ustr);
+      }
+      break;
   }
 
   // raise error if is the case
@@ -1678,6 +2536,21 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
       answer = UART_ENABLE_ERROR;
       break;
     }
+    case UART_TX_TIMEOUT:
+    {
+      answer = UART_TX_ERROR;
+      break;
+    }
+    case UART_TERM_NOTVALID:
+    {
+      answer = UART_TERM_ERROR;
+      break;
+    }
+    case UART_PATTERN_NOTVALID:
+    {
+      answer = UART_PATTERN_ERROR;
+      break;
+    }
   }
 
   if (ecode != NOERR)
@@ -1689,7 +2562,6 @@ static scpi_result_t Callback_com_scpi(scpi_t* context)
   {
     return SCPI_RES_OK;
   }
-  free(sdata);
 }
 
 /**
@@ -2157,9 +3029,41 @@ scpi_command_t scpi_commands[] = {
     {.pattern = "SYSTem:SLAves?", .callback = Callback_system_scpi, GRUN},
     {.pattern = "SYSTem:SLAves:STAtus?", .callback = Callback_system_scpi, GSTA},
     {.pattern = "SYSTem:TESTboard", .callback = Callback_system_scpi, STBR},
+    {.pattern = "SYSTem:I2C:STATistics?", .callback = Callback_system_scpi, GI2S},
+    {.pattern = "SYSTem:I2C:STATistics:CLEar", .callback = Callback_system_scpi, CI2S},
+    {.pattern = "SYSTem:I2C:SPEed?", .callback = Callback_system_scpi, GI2F},
+    {.pattern = "SYSTem:BENCHmark:ANAlog?", .callback = Callback_system_scpi, GBEN},
+    {.pattern = "SYSTem:HEALth?", .callback = Callback_system_scpi, GHLT},
+    {.pattern = "SYSTem:HEALth:STATistics?", .callback = Callback_system_scpi, GHST},
+    {.pattern = "SYSTem:HEALth:STATistics:CLEar", .callback = Callback_system_scpi, CHST},
+    {.pattern = "SYSTem:HEALth:PERiod", .callback = Callback_system_scpi, SHSP},
+    {.pattern = "SYSTem:HEALth:PERiod?", .callback = Callback_system_scpi, GHSP},
+    {.pattern = "SYSTem:BOOT:COUNt?", .callback = Callback_system_scpi, GBCT},
 
     {.pattern = "ANAlog:DAC:Volt", .callback = Callback_analog_scpi, SDAC},
     {.pattern = "ANAlog:DAC:Save", .callback = Callback_analog_scpi, WDAC},
+    {.pattern = "SOURce:DAC:FUNCtion", .callback = Callback_source_scpi, SWFN},
+    {.pattern = "SOURce:DAC:FUNCtion?", .callback = Callback_source_scpi, GWFN},
+    {.pattern = "SOURce:DAC:FREQuency", .callback = Callback_source_scpi, SWFR},
+    {.pattern = "SOURce:DAC:FREQuency?", .callback = Callback_source_scpi, GWFR},
+    {.pattern = "SOURce:DAC:AMPLitude", .callback = Callback_source_scpi, SWAM},
+    {.pattern = "SOURce:DAC:AMPLitude?", .callback = Callback_source_scpi, GWAM},
+    {.pattern = "SOURce:DAC:OFFSet", .callback = Callback_source_scpi, SWOF},
+    {.pattern = "SOURce:DAC:OFFSet?", .callback = Callback_source_scpi, GWOF},
+    {.pattern = "SOURce:DAC:ARB:DATA", .callback = Callback_source_scpi, SWAD},
+    {.pattern = "SOURce:DAC:ARB:DATA:APPend", .callback = Callback_source_scpi, SWAA},
+    {.pattern = "SOURce:DAC:ARB:POINts?", .callback = Callback_source_scpi, GWAP},
+    {.pattern = "SWEep:DAC:STARt", .callback = Callback_sweep_scpi, SSWS},
+    {.pattern = "SWEep:DAC:STARt?", .callback = Callback_sweep_scpi, GSWS},
+    {.pattern = "SWEep:DAC:STOP", .callback = Callback_sweep_scpi, SSWE},
+    {.pattern = "SWEep:DAC:STOP?", .callback = Callback_sweep_scpi, GSWE},
+    {.pattern = "SWEep:DAC:POINts", .callback = Callback_sweep_scpi, SSWP},
+    {.pattern = "SWEep:DAC:POINts?", .callback = Callback_sweep_scpi, GSWP},
+    {.pattern = "SWEep:DAC:DWELl", .callback = Callback_sweep_scpi, SSWD},
+    {.pattern = "SWEep:DAC:DWELl?", .callback = Callback_sweep_scpi, GSWD},
+    {.pattern = "SWEep:DAC:CURRent", .callback = Callback_sweep_scpi, SSWC},
+    {.pattern = "SWEep:DAC:CURRent?", .callback = Callback_sweep_scpi, GSWC},
+    {.pattern = "SWEep:DAC:DATA?", .callback = Callback_sweep_scpi, RSWD},
     {.pattern = "ANAlog:ADC0:Volt?", .callback = Callback_analog_scpi, RADC0},
     {.pattern = "ANAlog:ADC1:Volt?", .callback = Callback_analog_scpi, RADC1},
     {.pattern = "ANAlog:ADC:Vsys?", .callback = Callback_analog_scpi, RADC3},
@@ -2169,15 +3073,52 @@ scpi_command_t scpi_commands[] = {
     {.pattern = "ANAlog:PWR:Ima?", .callback = Callback_analog_scpi, RPI},
     {.pattern = "ANAlog:PWR:Pmw?", .callback = Callback_analog_scpi, RPP},
     {.pattern = "ANAlog:PWR:Cal", .callback = Callback_analog_scpi, CPI},
+    {.pattern = "ANAlog:PWR:STATistics?", .callback = Callback_power_scpi, GPST},
+    {.pattern = "ANAlog:PWR:ENERgy?", .callback = Callback_power_scpi, GPEN},
+    {.pattern = "ANAlog:PWR:STATistics:CLEar", .callback = Callback_power_scpi, CPST},
+    {.pattern = "ANAlog:PWR:STATistics:PERiod", .callback = Callback_power_scpi, SPSP},
+    {.pattern = "ANAlog:PWR:STATistics:PERiod?", .callback = Callback_power_scpi, GPSP},
+    {.pattern = "SENSe:PWR:ADC:MODE", .callback = Callback_power_scpi, SPAM},
+    {.pattern = "SENSe:PWR:ADC:MODE?", .callback = Callback_power_scpi, GPAM},
+    {.pattern = "ANAlog:PWR:CAPTure:ARM", .callback = Callback_power_scpi, APCA},
+    {.pattern = "ANAlog:PWR:CAPTure:STATe?", .callback = Callback_power_scpi, GPCS},
+    {.pattern = "ANAlog:PWR:CAPTure:RESult?", .callback = Callback_power_scpi, GPCR},
+    {.pattern = "ANAlog:PWR:CAPTure:DATA?", .callback = Callback_power_scpi, GPCD},
+    {.pattern = "SENSe:AVERage:COUNt", .callback = Callback_analog_scpi, SAVC},
+    {.pattern = "SENSe:AVERage:COUNt?", .callback = Callback_analog_scpi, GAVC},
+    {.pattern = "CALibration:ADC#:GAIN", .callback = Callback_calibration_scpi, SCAG},
+    {.pattern = "CALibration:ADC#:GAIN?", .callback = Callback_calibration_scpi, GCAG},
+    {.pattern = "CALibration:ADC#:OFFSet", .callback = Callback_calibration_scpi, SCAO},
+    {.pattern = "CALibration:ADC#:OFFSet?", .callback = Callback_calibration_scpi, GCAO},
+    {.pattern = "CALibration:ADC#:AUTO", .callback = Callback_calibration_scpi, ACAL},
+    {.pattern = "CALibration:ADC:RESet", .callback = Callback_calibration_scpi, RCAL},
+
+    {.pattern = "ACQuire:ADC#:RATE", .callback = Callback_acquire_scpi, SAQR},
+    {.pattern = "ACQuire:ADC#:RATE?", .callback = Callback_acquire_scpi, GAQR},
+    {.pattern = "ACQuire:ADC#:POINts", .callback = Callback_acquire_scpi, SAQP},
+    {.pattern = "ACQuire:ADC#:POINts?", .callback = Callback_acquire_scpi, GAQP},
+    {.pattern = "ACQuire:ADC#:PRETrigger", .callback = Callback_acquire_scpi, SAQE},
+    {.pattern = "ACQuire:ADC#:PRETrigger?", .callback = Callback_acquire_scpi, GAQE},
+    {.pattern = "ACQuire:ADC#:TRIGger", .callback = Callback_acquire_scpi, SAQT},
+    {.pattern = "ACQuire:ADC#:TRIGger?", .callback = Callback_acquire_scpi, GAQT},
+    {.pattern = "ACQuire:ADC#:INITiate", .callback = Callback_acquire_scpi, IAQ},
+    {.pattern = "ACQuire:ADC#:ABORt", .callback = Callback_acquire_scpi, AAQ},
+    {.pattern = "ACQuire:ADC#:STATe?", .callback = Callback_acquire_scpi, GAQS},
+    {.pattern = "FETCh:ADC#?", .callback = Callback_acquire_scpi, FAQ},
 
     {.pattern = "CFG:Write:Eeprom:STRing", .callback = Callback_eeprom_scpi, WEEP},
     {.pattern = "CFG:Read:Eeprom:STRing?", .callback = Callback_eeprom_scpi, REEP},
     {.pattern = "CFG:Write:Eeprom:Default", .callback = Callback_eeprom_scpi, WDEF},
     {.pattern = "CFG:Read:Eeprom:Full?", .callback = Callback_eeprom_scpi, RFUL},
+    {.pattern = "CFG:SAVE", .callback = Callback_eeprom_scpi, CSAV},
+    {.pattern = "CFG:SAVE?", .callback = Callback_eeprom_scpi, QSAV},
+    {.pattern = "CFG:LOG:STATus?", .callback = Callback_eeprom_scpi, GLOG},
+    {.pattern = "CFG:LOG:COMPact", .callback = Callback_eeprom_scpi, CLOG},
 
     {.pattern = "COM:OWire:Write", .callback = Callback_com_scpi, W1W},
     {.pattern = "COM:OWire:Read?", .callback = Callback_com_scpi, R1W},
     {.pattern = "COM:OWire:Check?", .callback = Callback_com_scpi, C1W},
+    {.pattern = "COM:OWire:ROMs?", .callback = Callback_com_scpi, Q1W},
 
     {.pattern = "COM:INITialize:ENAble", .callback = Callback_com_scpi, CIE},
     {.pattern = "COM:INITialize:DISable", .callback = Callback_com_scpi, CID},
@@ -2193,6 +3134,14 @@ scpi_command_t scpi_commands[] = {
     {.pattern = "COM:SERIAL:Handshake?", .callback = Callback_com_scpi, CSRH},
     {.pattern = "COM:SERIAL:Timeout", .callback = Callback_com_scpi, CSWT},
     {.pattern = "COM:SERIAL:Timeout?", .callback = Callback_com_scpi, CSRT},
+    {.pattern = "COM:SERIAL:TERMinator", .callback = Callback_com_scpi, CSWE},
+    {.pattern = "COM:SERIAL:TERMinator?", .callback = Callback_com_scpi, CSRE},
+    {.pattern = "COM:SERIAL:CAPTure", .callback = Callback_com_scpi, CSCA},
+    {.pattern = "COM:SERIAL:CAPTure?", .callback = Callback_com_scpi, CSCS},
+    {.pattern = "COM:SERIAL:CAPTure:DATA?", .callback = Callback_com_scpi, CSCD},
+    {.pattern = "COM:SERIAL:CAPTure:COUNt?", .callback = Callback_com_scpi, CSCC},
+    {.pattern = "COM:SERIAL:EXPect?", .callback = Callback_com_scpi, CSEX},
+    {.pattern = "COM:SERIAL:SCRipt?", .callback = Callback_com_scpi, CSSC},
 
     {.pattern = "COM:SPI:WRIte", .callback = Callback_sync_com_scpi, SPWD},
     {.pattern = "COM:SPI:REAd:LENgth#?", .callback = Callback_sync_com_scpi, SPRD},
@@ -32,9 +32,16 @@
 #include "hardware/adc.h"
 #include "hardware/i2c.h"
 #include "include/i2c_com.h"
+#include "include/adc_acq.h"
+#include "include/fixq.h"
+#include "include/wave_gen.h"
+#include "include/adc_cal.h"
+#include "include/cfg_param.h"
+#include "hardware/structs/systick.h"
 #include "pico_lib2/src/dev/dev_ina219/dev_ina219.h"
 #include "pico_lib2/src/dev/dev_mcp4725/dev_mcp4725.h"
 #include "pico_lib2/src/dev/dev_24lc32/dev_24lc32.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
 #include "hardware/i2c.h"
 
 // Initialize ADC function  if enable=1, else pin will be GPIO
@@ -62,154 +69,214 @@ void setup_ADC(bool enable)
   }
 }
 
-// function read ADC. Float value is returned
-// Command used by SCPI
 /**
- * @brief   Function to read ADC value and return the result. Function called by a
+ * @brief   Convert a raw ADC value to Q16 on the unit of the channel (Volt or Celsius).
+ *          Only integer operations are used, the calibration of the input is applied.
+ *
+ * @param channel  ADC channel of the raw value
+ * @param raw      12 bits ADC value
+ * @return q16_t   Value in Volt (channel 0,1,3) or Celsius (channel 4)
+ */
+q16_t adc_raw_to_q16(uint8_t channel, uint16_t raw)
+{
+  return adc_cal_convert(channel, raw);  // calibration folded in the conversion
+}
+
+/**
+ * @brief   Function to read ADC value and return the result on Q16 fixed point. Function called by a
  *          SCPI command
  *
  * @param channel  ADC channel to read
- * @return float   Float value read from ADC channel
+ * @return q16_t   Value read from ADC channel (Volt or Celsius)
  */
-
-float read_master_adc(uint8_t channel)
+q16_t read_master_adc_q(uint8_t channel)
 {
-  const float cfactor = ADC_REF / (1 << 12);  // 12 Bits conversion
   uint16_t value;
-  float adc_val;
+  q16_t adc_val;
+  char txt[16];
 
-  adc_select_input(channel);
-  value = adc_read();  // read ADC
-  adc_val = value * cfactor;
+  if (adc_acq_running() && channel != 2)
+  {
+    value = adc_acq_last(channel);  // last sample of the free running acquisition
+  }
+  else
+  {
+    adc_select_input(channel);
+    value = adc_read();  // read ADC
+  }
+  adc_val = adc_raw_to_q16(channel, value);
+  q16_format(txt, sizeof(txt), adc_val, Q16_DEF_DECIMALS);
 
   switch (channel)
   {
     case 0:  // ADC channel 0
-      fprintf(stdout, "ADC0: Raw value: 0x%03x, voltage: %f V\n", value, adc_val);
+      fprintf(stdout, "ADC0: Raw value: 0x%03x, voltage: %s V\n", value, txt);
       break;
     case 1:  // ADC channel 1
-      fprintf(stdout, "ADC1: Raw value: 0x%03x, voltage: %f V\n", value, adc_val);
+      fprintf(stdout, "ADC1: Raw value: 0x%03x, voltage: %s V\n", value, txt);
       break;
     case 2:  // Not used as analog channel (only ADC0 and 1)
-      adc_val = 0;
       fprintf(stdout, "ADC2: is not allowed \n");
       break;
-    case 3:                   // Vsys value
-      adc_val = adc_val * 3;  // Pico has voltage divider as input
-      fprintf(stdout, "Raw value 3: 0x%03x, Vsys  voltage: %f V\n", value, adc_val);
+    case 3:  // Vsys value
+      fprintf(stdout, "Raw value 3: 0x%03x, Vsys  voltage: %s V\n", value, txt);
       break;
-    case 4:                                         // Master internal temperature
-      adc_val = 27 - (adc_val - 0.706) / 0.001721;  // from RP2040 Datasheet
-      fprintf(stdout, "Raw value 0: 0x%03x, Temperature: %f C\n", value, adc_val);
+    case 4:  // Master internal temperature
+      fprintf(stdout, "Raw value 0: 0x%03x, Temperature: %s C\n", value, txt);
       break;
   }
   return adc_val;
 }
 
+/**
+ * @brief   Function to read ADC value and return the result as float, used by the boot check and the selftest
+ *
+ * @param channel  ADC channel to read
+ * @return float   Float value read from ADC channel
+ */
+float read_master_adc(uint8_t channel)
+{
+  return q16_to_float(read_master_adc_q(channel));
+}
+
 // SCPI function to control the power device IN219
 /**
  * @brief  function to read value from the I2C devices INA219 (current/power monitor). Function called by a
- *         SCPI command
+ *         SCPI command. The value is taken from a new conversion (ADC mode selected by SENSe:PWR:ADC:MODE),
+ *         the integer value of the device is converted to Q16 without floating point.
  *
  * @param mode      Number to select which register value to read
- * @return float    Float value read from the device
+ * @param over      Set to true if the value exceed the Q16 range and is saturated, NULL if not used
+ * @return q16_t    Value read from the device (V, mA, mW or mV)
  */
-float read_power(uint8_t mode)
+q16_t read_power_q(uint8_t mode, bool* over)
 {
-  int16_t readv;
+  q16_t readv = 0;
   char meas[3] = {0, 0, 0};
   char rmd[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  char txt[16];
+  ina219_meas_t m;
+
+  if (!ina219ReadMeas(&m, true))
+  {
+    fprintf(stdout, "INA219, conversion not ready, last values used\n");
+    ina219ReadMeas(&m, false);
+  }
+  if (m.overflow) fprintf(stdout, "INA219, math overflow on current or power\n");
+  if (over) *over = false;
 
   switch (mode)
   {
     case 0:
-      readv = ina219GetBusVoltage() * 0.001;  // read bus voltage
+      readv = q16_from_milli(m.bus_mv);  // read bus voltage, mV to V
       strcpy(meas, "V");
       strcpy(rmd, "BUS V");
       break;
 
     case 1:
-      readv = ina219GetCurrent_mA();  // read bus current.
+      readv = q16_from_milli(m.current_ua);  // read bus current, uA to mA
       strcpy(meas, "mA");
       strcpy(rmd, "CURRENT");
       break;
 
     case 2:
-      readv = ina219GetPower_mW();
+      readv = q16_from_milli_sat(m.power_uw, over);  // uW to mW, above 32.767 W with the 32 V calibrations
       strcpy(meas, "mW");
       strcpy(rmd, "POWER");
       break;
     case 3:
 
-      readv = ina219GetShuntVoltage() * 10E-3;
+      readv = q16_from_milli(m.shunt_uv);  // uV to mV
       strcpy(meas, "mV");
       strcpy(rmd, "SHUNT");
       break;
   }
 
-  fprintf(stdout, "INA219,read: %s ,  value: %d %s \n", rmd, readv, meas);
+  q16_format(txt, sizeof(txt), readv, 3);
+  fprintf(stdout, "INA219,read: %s ,  value: %s %s \n", rmd, txt, meas);
   return readv;
 }
 
 /**
  * @brief SCPI function to calibrate the current on the power device INA219
  *
- * @param actual    Current value read with the hardware
- * @param expected  Expected value according to calculation
+ * @param actual    Current value read with the hardware (mA)
+ * @param expected  Expected value according to calculation (mA)
  */
-void calibrate_power(float actual, float expected)
+void calibrate_power_q(q16_t actual, q16_t expected)
 {
   bool flg;
+  char atxt[16], etxt[16];
 
-  flg = ina219CalibrateCurrent_mA(actual, expected);
+  flg = ina219CalibrateCurrent_uA(q16_to_milli(actual), q16_to_milli(expected));
+  q16_format(atxt, sizeof(atxt), actual, 2);
+  q16_format(etxt, sizeof(etxt), expected, 2);
   if (flg)
   {
-    fprintf(stdout, "INA219,calibration current, actual value: %.2f, expected value: %.2f \n", actual, expected);
+    fprintf(stdout, "INA219,calibration current, actual value: %s, expected value: %s \n", atxt, etxt);
   }
   else
   {
-    fprintf(stdout, "INA219,calibration not performed, cal factor identical, actual value: %.2f, expected value: %.2f \n", actual, expected);
+    fprintf(stdout, "INA219,calibration not performed, cal factor identical, actual value: %s, expected value: %s \n", atxt, etxt);
   }
 }
 
+/**
+ * @brief Convert a voltage to MCP4725 code without floating point
+ *
+ * @param value     Voltage in Volt
+ * @return uint16_t 12 bits DAC code, limited to 0..4095
+ */
+uint16_t dac_volt_to_code(q16_t value)
+{
+  int64_t code;
+
+  // code = V x 4096 / VDD, reciprocal of VDD on Q16
+  code = ((int64_t)value * Q16(4096 / VDD) + (1LL << 31)) >> 32;
+  if (code < 0) return 0;
+  if (code > 4095) return 4095;  // 12 bits DAC
+  return (uint16_t)code;
+}
+
 /**
  * @brief Function used by SCPI command to set DAC voltage
- *        The voltage value is validated to be in the range of DAC before set the DAC
+ *        The voltage value is validated to be in the range of DAC before set the DAC.
+ *        The DAC code is computed from the Q16 value without floating point.
  *
  * @param value Value in volt to set the DAC
  * @param save  Flag to save voltage value as default at power ON
  * @return      Number to indicate success or error in the execution
  */
-
-uint8_t dac_set(float value, bool save)
+uint8_t dac_set_q(q16_t value, bool save)
 {
   uint16_t error;
-  float ovalue;
+  uint16_t code;
   bool flag;
+  char txt[16];
 
-  ovalue = value;
   error = NOERR;
 
-  // float value;
-
-  if (value > MAXDACVOLT)
+  if (value > Q16(MAXDACVOLT))
   {
-    value = MAXDACVOLT;
+    value = Q16(MAXDACVOLT);
     error = EOOR;  // raise error due to value outside maximum limit
   }
-  if (value < MINDACVOLT)
+  if (value < Q16(MINDACVOLT))
   {
-    value = MINDACVOLT;
+    value = Q16(MINDACVOLT);
     error = EOOR;
   }
 
+  wave_stop();  // static value replace the waveform
+  code = dac_volt_to_code(value);
+
   if (save)
   {
-    flag = dev_mcp4725_save(i2c0, MCP4725_ADDR0, value);
+    flag = dev_mcp4725_save_raw(i2c0, MCP4725_ADDR0, code);
   }
   else
   {
-    flag = dev_mcp4725_set(i2c0, MCP4725_ADDR0, value);
+    flag = dev_mcp4725_set_raw(i2c0, MCP4725_ADDR0, code);
   }
 
   if (!flag)
@@ -219,23 +286,115 @@ uint8_t dac_set(float value, bool save)
   }
   else
   {
-    fprintf(stdout, "DAC voltage set to: %2.3f V\n", value);
+    q16_format(txt, sizeof(txt), value, 3);
+    fprintf(stdout, "DAC voltage set to: %s V (code %d)\n", txt, code);
   }
   return error;
 }
 
+/**
+ * @brief Start the SysTick as cycle counter (24 bits, processor clock)
+ */
+static void analog_bench_start(void)
+{
+  systick_hw->csr = 0;
+  systick_hw->rvr = 0x00FFFFFF;
+  systick_hw->cvr = 0;
+  systick_hw->csr = M0PLUS_SYST_CSR_CLKSOURCE_BITS | M0PLUS_SYST_CSR_ENABLE_BITS;
+}
+
+/**
+ * @brief Cycles elapsed since a SysTick value, counter is decrementing
+ */
+static inline uint32_t analog_bench_cycles(uint32_t start)
+{
+  return (start - systick_hw->cvr) & 0x00FFFFFF;
+}
+
+/**
+ * @brief Measure the cycles used to convert and format the answer of ANAlog commands, with the float
+ *        version used before and the Q16 version. The I2C and ADC transfer time is not included.
+ *        Order of result: ADC volt, ADC temperature, INA219 current, DAC code from parameter.
+ *
+ * @param res  Array of ANALOG_BENCH_NB results, cycles per command
+ */
+void analog_bench(analog_bench_t* res)
+{
+  volatile uint16_t raw = 0x6A5;         // ADC sample
+  volatile int16_t cur = 20000;          // INA219 current register
+  volatile int32_t div = 40;             // current divider of the 16V 500mA calibration
+  volatile uint32_t sink = 0;            // keep the result
+  const char* param = "2.5173";          // DAC parameter
+  char txt[24];
+  uint32_t t;
+  float f;
+
+  analog_bench_start();
+  for (uint8_t n = 0; n < ANALOG_BENCH_NB; n++)
+  {
+    // float version
+    t = systick_hw->cvr;
+    for (uint32_t i = 0; i < ANALOG_BENCH_LOOP; i++)
+    {
+      switch (n)
+      {
+        case 0:
+          f = raw * (ADC_REF / (1 << 12));
+          break;
+        case 1:
+          f = 27 - (raw * (ADC_REF / (1 << 12)) - 0.706) / 0.001721;
+          break;
+        case 2:
+          f = (float)cur / div;
+          break;
+        default:
+          f = (uint16_t)(strtof(param, NULL) / (VDD / 4096));
+          break;
+      }
+      sink += snprintf(txt, sizeof(txt), "%f", f);
+    }
+    res[n].fp_cycles = analog_bench_cycles(t) / ANALOG_BENCH_LOOP;
+
+    // fixed point version
+    t = systick_hw->cvr;
+    for (uint32_t i = 0; i < ANALOG_BENCH_LOOP; i++)
+    {
+      q16_t q = 0;
+
+      switch (n)
+      {
+        case 0:
+          q = adc_raw_to_q16(0, raw);
+          break;
+        case 1:
+          q = adc_raw_to_q16(4, raw);
+          break;
+        case 2:
+          q = q16_from_milli((int32_t)cur * 1000 / div);
+          break;
+        default:
+          q16_parse(param, 6, &q);
+          q = (q16_t)(((int64_t)q * Q16(4096 / VDD) + (1LL << 31)) >> 32);
+          q <<= Q16_SHIFT;  // code formatted as number
+          break;
+      }
+      sink += q16_format(txt, sizeof(txt), q, Q16_DEF_DECIMALS);
+    }
+    res[n].fix_cycles = analog_bench_cycles(t) / ANALOG_BENCH_LOOP;
+  }
+  (void)sink;
+}
+
 /**
  * @brief This function check if the eeprom is detected and if the data is valid
  *
- * @param check_data Flag to indicate if the check number need to be validated
+ * @param check_data Flag to indicate if the configuration loaded from the parameter store need to be validated
  * @param eeprom     Pointer to eeprom structure
  * @return uint8_t  Number to indicate success or error in the execution
  */
 
 uint8_t eeprom_data_valid(bool check_data, at24cx_dev_t* eeprom)
 {
-  at24cx_writedata_t dt;
-
   // register eeprom 24lc32
   at24cx_i2c_device_register(eeprom, EEMODEL, I2C_ADDRESS_AT24CX);
 
@@ -245,213 +404,112 @@ uint8_t eeprom_data_valid(bool check_data, at24cx_dev_t* eeprom)
 
   if (check_data)
   {  // if required to check data
-    dt.address = ADD_EEPROM_BASE;
-    if (at24cx_i2c_byte_read(*eeprom, &dt) == AT24CX_OK)
-    {
-      if (dt.data != EE_CHECK_CHAR)
-      {  // Error Check byte not written
-        fprintf(stdout, "Error Check Character do not match, expect: 0x%02X read: 0x%02X \n", EE_CHECK_CHAR, dt.data);
-        return ECE;
-      }
-      else
-      {
-        fprintf(stdout, "EEprom check byte valid: 0x%02X \n", dt.data);
-      }
-    }
-    else
-    {
-      fprintf(stdout, "Device byte read error!\n");
-      return EBE;
+    if (cfg_param_state() != NOERR)
+    {  // configuration not loaded from the parameter store
+      fprintf(stdout, "Configuration not valid on parameter store\n");
+      return ECE;
     }
+    fprintf(stdout, "EEprom configuration valid, schema %u\n", CFG_SCHEMA_VERSION);
   }
   return NOERR;
 }
 
-// Write parameter to eeprom
 /**
- * @brief  Function to read and write data on the I2C configuration eeprom
- *
- * @param mode      Character to define if we read (r) or write (w) data
- * @param eeaddr    Eeprom address to define the beginning of data string
- * @param eedatalen Number of character reserved for the data field on eeprom
- * @param data      Pointer to the data to read or write
- * @param datalen   Length of the data to read or write
- * @return uint8_t
+ * @brief State of the background writer. The RAM copy is the reference, the modified items
+ *        are written on eeprom in background or by CFG:SAVE.
  */
-
-uint8_t cfg_eeprom_rw(char mode, uint32_t eeaddr, uint8_t eedatalen, char* data, uint8_t datalen)
+static struct
 {
-  at24cx_dev_t eeprom_1;
-  at24cx_writedata_t dt;
-  uint8_t status;
-
-  // EEprom check access and validity
-  status = eeprom_data_valid(true, &eeprom_1);
-  if (status != NOERR)
-  {
-    return status;
-  }  // if error do not execute read or write on eeprom
-
-  if (mode == 'w')
-  {
-    fprintf(stdout, "\nWrite Eeprom parameter\n");
-    if (datalen > eedatalen)
-    {  // if data is longer than reserved field
-      fprintf(stdout, "Error, data to write is too long, field length 0x%02X : Data length 0x%02X \n", eedatalen, datalen);
-      return EOOR;  // raise error due to value outside maximum limit
-    }
-    for (int i = 0; i < eedatalen; i++)
-    {
-      dt.address = ADD_EEPROM_BASE + eeaddr + i;  // physical address on eeprom
-      dt.data = data[i];
-      dt.data_multi[i] = data[i];  // save value on array to be compare after eeprom
+  cfg_eeprom_store_t store;  // write of one item, NULL while the RAM copy is not loaded
+  uint32_t dirty;            // items modified on RAM (bit = unit)
+  uint32_t changed_us;       // time of the last modification
+  uint32_t flush_err;        // number of item write or verify failed
+} eec;
 
-      if (at24cx_i2c_byte_write(eeprom_1, dt) == AT24CX_OK)
-      {
-        fprintf(stdout, "Writing at address 0x%02X: 0x%02X , %c \n", dt.address, dt.data, dt.data);
-      }
-      else
-      {
-        fprintf(stdout, "EEprom device write byte error! \n");
-        return EDE;
-      }
-    }
-  }
-  fprintf(stdout, "\nRead eeprom byte test\n");
-  for (int i = 0; i < eedatalen; i++)
-  {
-    dt.address = ADD_EEPROM_BASE + eeaddr + i;
-    if (at24cx_i2c_byte_read(eeprom_1, &dt) == AT24CX_OK)
-    {
-      fprintf(stdout, "Reading at address 0x%02X: 0x%02X , %c \n", dt.address, dt.data, dt.data);
-      data[i] = dt.data;  // save value on array
-    }
-    else
-    {
-      fprintf(stdout, "EEprom device byte read error!\n");
-      return EDE;
-    }
-  }
+/**
+ * @brief Set the function writing one item of the RAM copy. The background writer is stopped
+ *        with NULL, the modified items are forgotten.
+ *
+ * @param store     Write of one item, NULL if the RAM copy is not valid
+ */
+void cfg_eeprom_attach(cfg_eeprom_store_t store)
+{
+  eec.store = store;
+  if (store == NULL) eec.dirty = 0;
+}
 
-  if (mode == 'w')
-  {  // if data written on eeprom, compare value.
-    fprintf(stdout, "\nCompare EEprom Write and read\n");
-    for (int i = 0; i < eedatalen; i++)
-    {
-      dt.address = ADD_EEPROM_BASE + eeaddr + i;
-      if (data[i] != dt.data_multi[i])
-      {
-        fprintf(stdout, "Error byte Write-read at address 0x%02X: write value 0x%02X: read value: 0x%02X\n", dt.address, dt.data_multi[i], data[i]);
-        return ECE;
-      }
-    }
-    fprintf(stdout, "Eeprom data match\n");
-  }
+/**
+ * @brief Mark an item modified on RAM, written after EE_FLUSH_DELAY_MS without change
+ *
+ * @param unit      Index of the item
+ */
+void cfg_eeprom_touch(uint32_t unit)
+{
+  eec.dirty |= 1u << unit;
+  eec.changed_us = time_us_32();
+}
 
-  return NOERR;
+/**
+ * @brief Mark the first nb items modified on RAM
+ *
+ * @param nb        Number of items
+ */
+void cfg_eeprom_touch_all(uint32_t nb)
+{
+  eec.dirty |= (nb >= EE_MAX_UNIT) ? UINT32_MAX : (1u << nb) - 1;
+  eec.changed_us = time_us_32();
 }
 
 /**
- * @brief Read the entire contents of the configuration eeprom and store data on eeprom config structure
- *        EEprom structure is global (defined on master.h)
+ * @brief Write the modified items on eeprom, each item is read back and compared by the store function
  *
- * @return uint8_t Number to define success or failure
+ * @param all       True to write all items (CFG:SAVE), false to write only one item (background writer)
+ * @return uint8_t  NOERR or error of the first item failed, the item stay modified
  */
-uint8_t cfg_eeprom_read_full()
+uint8_t cfg_eeprom_flush(bool all)
 {
-  at24cx_dev_t eeprom_1;
-  at24cx_writedata_t dt;
-  uint32_t datalen;
+  uint32_t unit;
   uint8_t status;
 
-  // EEprom check access and validity of the check byte
-  status = eeprom_data_valid(true, &eeprom_1);
-  if (status != NOERR)
-  {
-    return status;
-  }  // if error do not execute read or write on eeprom
-
-  datalen = sizeof(ee.cfg);  // read size of eeprom global structure
+  if (eec.store == NULL) return eec.dirty ? EDE : NOERR;
 
-  fprintf(stdout, "\n--> Read full eeprom\n");
-  for (int i = 0; i < datalen; i++)
+  while (eec.dirty)
   {
-    dt.address = ADD_EEPROM_BASE + i;  // calculate physical address
-    if (at24cx_i2c_byte_read(eeprom_1, &dt) == AT24CX_OK)
-    {
-      fprintf(stdout, "Full Eeprom reading byte #%d at address 0x%02X: 0x%02X,", i, dt.address, dt.data);
-      if (dt.data == 0x00)
-      {
-        fprintf(stdout, "\n");
-      }
-      else
-      {
-        fprintf(stdout, "%c\n", dt.data);
-      }
-      ee.data[i] = dt.data;  // save value on eeprom structure
-    }
-    else
+    unit = __builtin_ctz(eec.dirty);
+    status = eec.store(unit);
+    if (status != NOERR)
     {
-      fprintf(stdout, "EEprom read full device byte read error!\n");
-      return EDE;
+      eec.flush_err++;
+      eec.changed_us = time_us_32();  // retry after the quiet time
+      return status;
     }
+    eec.dirty &= ~(1u << unit);
+    if (!all) break;
   }
-  fprintf(stdout, "\n--> Completed read of full eeprom\n");
   return NOERR;
 }
 
 /**
- * @brief Write the default values on EEprom. EEprom is written by page
- *        EEprom structure is global (defined on master.h)
- *
- * @return uint8_t Number to define success or failure
+ * @brief Background writer, called by the main loop. One modified item is written
+ *        when nothing changed since EE_FLUSH_DELAY_MS and the bus is free.
  */
-
-uint8_t cfg_eeprom_write_default()
+void cfg_eeprom_event(void)
 {
-  at24cx_dev_t eeprom_1;
-  at24cx_writedata_t dt;
-  uint32_t datalen;
-  uint32_t addr;
-  int i;
-  uint8_t status;
-
-  eep eed = DEF_EEPROM;  // Assign default value to structure eeprom
-
-  // EEprom check access
-  status = eeprom_data_valid(false, &eeprom_1);
-  if (status != NOERR)
-  {
-    return status;
-  }  // if error do not execute read or write on eeprom
-
-  datalen = sizeof(ee.cfg);  // read size of eeprom global structure
+  if (!eec.dirty || eec.store == NULL) return;
+  if (time_us_32() - eec.changed_us < EE_FLUSH_DELAY_MS * 1000) return;
+  if (sys_i2c_busy(i2c0)) return;
 
-  fprintf(stdout, "\n--> Write Default value on eeprom\n");
-  dt.address = ADD_EEPROM_BASE;  // Set base address
-  i = 0;                         // index for the location of data
-
-  while (0 < datalen)  // loop to write eeprom data by page
-  {
-    uint32_t pagelen = (dt.address | (EE_PAGESIZE - 1)) - dt.address + 1;
-    uint32_t writelen = min(datalen, pagelen);
-
-    memcpy(&dt.data_multi[0], &eed.data[i], writelen);  // copy data in Eeprom array to write
-
-    if (at24cx_i2c_page_write(eeprom_1, dt) == AT24CX_OK)
-      fprintf(stdout, "Page Writing at address 0x%02X\n", dt.address);
-    else
-    {
-      fprintf(stdout, "Device page write error!\n");
-      return EDE;
-    }
+  if (cfg_eeprom_flush(false) != NOERR) RegBitHdwrLive(EEPROM_ERROR, false);
+}
 
-    dt.address += writelen;
-    i += writelen;
-    datalen -= writelen;
-  }
-  fprintf(stdout, "EEprom Writing Completed\n");
-  return NOERR;
+/**
+ * @brief Return the number of items not yet written on eeprom
+ *
+ * @return uint32_t  Number of items
+ */
+uint32_t cfg_eeprom_dirty(void)
+{
+  return __builtin_popcount(eec.dirty);
 }
 
 /**
@@ -505,14 +563,15 @@ bool Boot_check()
 
   gpio_put(GPIO_RUN, 1);  // Start PICO Slave (if required)
 
-  scan_i2c_bus(i2c0);  // send devices detected on the debug port (USB)
+  scan_i2c_bus(i2c0);      // send devices detected on the debug port (USB)
+  i2c_speed_negotiate();  // set the fastest speed supported by each device
   ret = 0;
-  ret += i2c_read_blocking(i2c0, I2C_ADDRESS_AT24CX, &rxdata, 1, false);   // check I2C com with eeprom
-  ret += i2c_read_blocking(i2c0, PICO_PORT_ADDRESS, &rxdata, 1, false);    // check I2C com with Pico  Slave_1
-  ret += i2c_read_blocking(i2c0, PICO_RELAY1_ADDRESS, &rxdata, 1, false);  // check I2C com with Pico  Slave_2
-  ret += i2c_read_blocking(i2c0, PICO_RELAY2_ADDRESS, &rxdata, 1, false);  // check I2C com with Pico  Slave_3
-  ret += i2c_read_blocking(i2c0, INA219_ADDRESS, &rxdata, 1, false);       // check I2C com with PWR device
-  ret += i2c_read_blocking(i2c0, MCP4725_ADDR0, &rxdata, 1, false);        // check I2C com with DAC device
+  ret += sys_i2c_rbyte(i2c0, I2C_ADDRESS_AT24CX, &rxdata);   // check I2C com with eeprom
+  ret += sys_i2c_rbyte(i2c0, PICO_PORT_ADDRESS, &rxdata);    // check I2C com with Pico  Slave_1
+  ret += sys_i2c_rbyte(i2c0, PICO_RELAY1_ADDRESS, &rxdata);  // check I2C com with Pico  Slave_2
+  ret += sys_i2c_rbyte(i2c0, PICO_RELAY2_ADDRESS, &rxdata);  // check I2C com with Pico  Slave_3
+  ret += sys_i2c_rbyte(i2c0, INA219_ADDRESS, &rxdata);       // check I2C com with PWR device
+  ret += sys_i2c_rbyte(i2c0, MCP4725_ADDR0, &rxdata);        // check I2C com with DAC device
 
   if (ret == 6)
   {  // if all I2C device detected, return true, else return false
@@ -596,21 +655,21 @@ bool IOBoard_Selftest()
   else
   {  // if fail to communicate, check i2c comm
 
-    datar = i2c_read_blocking(i2c0, PICO_PORT_ADDRESS, &dataw, 1, false);  // check I2C com with Pico  Slave_1
+    datar = sys_i2c_rbyte(i2c0, PICO_PORT_ADDRESS, &dataw);  // check I2C com with Pico  Slave_1
     if (datar < 0)
     {
       sprintf(pv, "Pico Slave1 communication I2C error");
       err[i++] = strdup(pv);
     }
 
-    datar = i2c_read_blocking(i2c0, PICO_RELAY1_ADDRESS, &dataw, 1, false);  // check I2C com with Pico  Slave_1
+    datar = sys_i2c_rbyte(i2c0, PICO_RELAY1_ADDRESS, &dataw);  // check I2C com with Pico  Slave_1
     if (datar < 0)
     {
       sprintf(pv, "Pico Slave2 communication I2C error");
       err[i++] = strdup(pv);
     }
 
-    datar = i2c_read_blocking(i2c0, PICO_RELAY2_ADDRESS, &dataw, 1, false);  // check I2C com with Pico  Slave_1
+    datar = sys_i2c_rbyte(i2c0, PICO_RELAY2_ADDRESS, &dataw);  // check I2C com with Pico  Slave_1
     if (datar < 0)
     {
       sprintf(pv, "Pico Slave3 communication I2C error");
@@ -673,7 +732,7 @@ bool IOBoard_Selftest()
   /*******************************************************************************/
   // Selftest PWR (INA219)
   /*******************************************************************************/
-  datar = i2c_read_blocking(i2c0, INA219_ADDRESS, &dataw, 1, false);  // check I2C com with Pico  Slave_1
+  datar = sys_i2c_rbyte(i2c0, INA219_ADDRESS, &dataw);  // check I2C com with Pico  Slave_1
   if (datar < 0)
   {
     sprintf(pv, "I2C com error with CURRENT MONITOR module (INA219)");
@@ -695,7 +754,7 @@ bool IOBoard_Selftest()
   float valuew = 3.25;  // Dac value to use to program DAC for selftest
   float valuer;         // value read back
 
-  datar = i2c_read_blocking(i2c0, MCP4725_ADDR0, &dataw, 1, false);  // check I2C com with Pico  Slave_1
+  datar = sys_i2c_rbyte(i2c0, MCP4725_ADDR0, &dataw);  // check I2C com with Pico  Slave_1
   if (datar < 0)
   {
     sprintf(pv, "I2C com error with DAC module (MCP4725)");
@@ -820,7 +879,7 @@ void scan_i2c_bus(i2c_inst_t* i2c)
     if (reserved_addr(addr))
       ret = PICO_ERROR_GENERIC;
     else
-      ret = i2c_read_blocking(i2c, addr, &rxdata, 1, false);
+      ret = i2c_read_timeout_us(i2c, addr, &rxdata, 1, false, I2C_TIMEOUT_CHAR);  // no retry, absent device is expected
 
     printf(ret < 0 ? "." : "*");
     printf(addr % 16 == 15 ? "\n" : "  ");
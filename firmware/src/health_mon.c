@@ -0,0 +1,188 @@
+/**
+ * @file    health_mon.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Background monitor of VSYS and temperature of the Master Pico
+ *
+ * @details A timer takes the last VSYS and temperature samples of the free running ADC acquisition
+ *          (round robin, no conversion started by the monitor). The limits of the boot check are
+ *          applied with hysteresis, min and max are kept since the last clear.
+ *          The Questionable register is updated by the main loop when a fault change,
+ *          the command path is not delayed.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "include/functadv.h"
+#include "include/master.h"
+#include "include/scpi_user_config.h"
+#include "include/fts_scpi.h"
+#include "include/adc_acq.h"
+#include "include/health_mon.h"
+
+/**
+ * @brief State of the health monitor.
+ */
+static struct
+{
+  repeating_timer_t timer;     // sampling timer
+  bool running;                // timer active
+  uint32_t period_ms;          // sampling period
+  volatile bool vsys_fault;    // VSYS out of limits
+  volatile bool temp_fault;    // temperature too high
+  volatile bool changed;       // fault changed, register to update by the main loop
+  health_stat_t st;            // statistic since last clear
+} hm = {.period_ms = HEALTH_MON_DEF_PERIOD_MS};
+
+/**
+ * @brief Timer callback, check the last samples of VSYS and temperature
+ *
+ * @param rt      Repeating timer
+ * @return true   Timer continue
+ */
+static bool health_mon_timer(repeating_timer_t* rt)
+{
+  health_stat_t* st = &hm.st;
+  q16_t vsys, temp;
+  bool fault;
+
+  if (!adc_acq_running() || adc_cap_state() == ADC_CAP_ARMED || adc_cap_state() == ADC_CAP_TRIGGERED)
+  {
+    st->skip++;  // ADC used by a capture or stopped
+    return true;
+  }
+
+  vsys = adc_raw_to_q16(3, adc_acq_last(3));
+  temp = adc_raw_to_q16(4, adc_acq_last(4));
+
+  if (st->count == 0)
+  {
+    st->vsys_min = st->vsys_max = vsys;
+    st->temp_min = st->temp_max = temp;
+  }
+  if (vsys < st->vsys_min) st->vsys_min = vsys;
+  if (vsys > st->vsys_max) st->vsys_max = vsys;
+  if (temp < st->temp_min) st->temp_min = temp;
+  if (temp > st->temp_max) st->temp_max = temp;
+  st->vsys = vsys;
+  st->temp = temp;
+  st->count++;
+
+  // fault set outside of the limit, cleared inside of the limit minus the hysteresis
+  if (hm.vsys_fault)
+  {
+    fault = (vsys > Q16(MAX_VSYS_VOLT) - HEALTH_VSYS_HYST || vsys < Q16(MIN_VSYS_VOLT) + HEALTH_VSYS_HYST);
+  }
+  else
+  {
+    fault = (vsys > Q16(MAX_VSYS_VOLT) || vsys < Q16(MIN_VSYS_VOLT));
+  }
+  if (fault != hm.vsys_fault)
+  {
+    hm.vsys_fault = fault;
+    hm.changed = true;
+  }
+
+  fault = hm.temp_fault ? (temp > Q16(MAX_PICO_TEMP) - HEALTH_TEMP_HYST) : (temp > Q16(MAX_PICO_TEMP));
+  if (fault != hm.temp_fault)
+  {
+    hm.temp_fault = fault;
+    hm.changed = true;
+  }
+  return true;
+}
+
+/**
+ * @brief Start or restart the health monitor. The fault state start from the
+ *        Questionable register set by the boot check.
+ *
+ * @param period_ms  Sampling period in ms (HEALTH_MON_MIN_PERIOD_MS to HEALTH_MON_MAX_PERIOD_MS)
+ * @return true      Monitor is running
+ * @return false     Period out of range or no timer available
+ */
+bool health_mon_start(uint32_t period_ms)
+{
+  scpi_reg_val_t ques;
+
+  if (period_ms < HEALTH_MON_MIN_PERIOD_MS || period_ms > HEALTH_MON_MAX_PERIOD_MS) return false;
+
+  health_mon_stop();
+  ques = SCPI_RegGet(&scpi_context, SCPI_REG_QUESC);
+  hm.vsys_fault = (ques & (1 << QCR_VSYS_OUTLIMIT)) != 0;
+  hm.temp_fault = (ques & (1 << QCR_MTEMP_HIGH)) != 0;
+  hm.changed = false;
+  hm.period_ms = period_ms;
+  hm.running = add_repeating_timer_ms(-(int32_t)period_ms, health_mon_timer, NULL, &hm.timer);
+
+  fprintf(stdout, "Health monitor sampling every %lu ms\n", period_ms);
+  return hm.running;
+}
+
+/**
+ * @brief Stop the health monitor
+ */
+void health_mon_stop(void)
+{
+  if (!hm.running) return;
+
+  cancel_repeating_timer(&hm.timer);
+  hm.running = false;
+}
+
+/**
+ * @brief Return the sampling period
+ *
+ * @return uint32_t  Period in ms, 0 if the monitor is stopped
+ */
+uint32_t health_mon_period(void)
+{
+  return hm.running ? hm.period_ms : 0;
+}
+
+/**
+ * @brief Clear min, max and counters, the fault state is kept
+ */
+void health_mon_clear(void)
+{
+  uint32_t save = save_and_disable_interrupts();
+
+  memset(&hm.st, 0, sizeof(hm.st));
+  restore_interrupts(save);
+}
+
+/**
+ * @brief Return a copy of the statistic, taken without update by the sampler
+ *
+ * @param st  Statistic returned
+ */
+void health_mon_get(health_stat_t* st)
+{
+  uint32_t save = save_and_disable_interrupts();
+
+  *st = hm.st;
+  st->vsys_fault = hm.vsys_fault;
+  st->temp_fault = hm.temp_fault;
+  restore_interrupts(save);
+}
+
+/**
+ * @brief Update the Questionable register when a fault changed. Called by the main loop.
+ */
+void health_mon_event(void)
+{
+  if (!hm.changed) return;
+
+  hm.changed = false;
+  fprintf(stdout, "Health monitor: VSYS %s, temperature %s\n", hm.vsys_fault ? "out of limits" : "ok",
+          hm.temp_fault ? "too high" : "ok");
+  RegBitHdwrLive(VSYS_OUT, !hm.vsys_fault);
+  RegBitHdwrLive(MTEMP_HIGH, !hm.temp_fault);
+}
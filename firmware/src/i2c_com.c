@@ -16,6 +16,7 @@
  */
 
 #include <stdio.h>
+#include <inttypes.h>
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "hardware/structs/io_bank0.h"
@@ -23,25 +24,79 @@
 #include "hardware/i2c.h"
 #include "include/i2c_com.h"
 #include "include/fts_scpi.h"
+#include "include/adc_acq.h"
+#include "include/pwr_mon.h"
 #include "userconfig.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
+#include "pico_lib2/src/sys/include/sys_i2c_async.h"
+#include "pico_lib2/src/dev/dev_ina219/dev_ina219.h"
+#include "pico_lib2/src/dev/dev_mcp4725/dev_mcp4725.h"
+#include "pico_lib2/src/dev/dev_24lc32/dev_24lc32.h"
 
 /**
- * @brief Configuration of the internal I2C port
+ * @brief Configuration of the internal I2C port.
+ *        Pins are registered on sys_i2c to allow bus recovery when a device hold SDA low.
+ *        Commands to Pico slaves are sent by DMA (sys_i2c_async).
  *
  */
 
 void setup_master()
 {
   gpio_init(I2C_MASTER_SDA_PIN);
-  gpio_set_function(I2C_MASTER_SDA_PIN, GPIO_FUNC_I2C);
+  gpio_init(I2C_MASTER_SCL_PIN);
+
   // pull-ups are already active on slave side, this is just a fail-safe in case the wiring is faulty
-  gpio_pull_up(I2C_MASTER_SDA_PIN);
+  sys_i2c_init(i2c0, I2C_MASTER_SDA_PIN, I2C_MASTER_SCL_PIN, I2C_BAUDRATE, true);
+  sys_i2c_setretry(i2c0, I2C_MAX_RETRY);  // bounded retry on internal bus
+  if (!sys_i2c_async_init(i2c0))
+  {
+    fprintf(stdout, "Internal I2C DMA not available, blocking transfer used\r\n");
+  }
+}
 
-  gpio_init(I2C_MASTER_SCL_PIN);
-  gpio_set_function(I2C_MASTER_SCL_PIN, GPIO_FUNC_I2C);
-  gpio_pull_up(I2C_MASTER_SCL_PIN);
+// relay command posted on the bus, result collected by the next command or by i2c_com_event
+static struct
+{
+  uint8_t ird[1];          // read back value of the posted frame
+  uint8_t cmd;             // command of the posted frame, for the debug message
+  volatile bool pending;   // frame posted, result not collected
+  volatile bool done;      // frame completed by interrupt
+  volatile int32_t status; // result of the frame
+} post;
+
+// Completion of the posted frame, from interrupt
+static void send_master_done(i2c_inst_t* i2c, uint8_t addr, int32_t status, void* user)
+{
+  post.status = status;
+  post.done = true;
+}
+
+/**
+ * @brief Wait the completion of the posted relay command and get its result
+ *
+ * @param rback     Error number when the posted command failed
+ * @return true     No command posted or command completed without error
+ * @return false    Posted command has error (error number on rback)
+ */
 
-  i2c_init(i2c0, I2C_BAUDRATE);
+static bool send_master_collect(uint16_t* rback)
+{
+  if (!post.pending) return true;
+
+  while (!post.done)
+  {
+    sys_i2c_async_wait(i2c0);  // timeout and recovery done out of interrupt
+  }
+  post.pending = false;
+
+  if (post.status < 0)
+  {
+    fprintf(stdout, "MAS: ERROR on posted command %02d\n", post.cmd);
+    *rback = I2C_COMMUNICATION_ERROR;
+    return false;
+  }
+  fprintf(stdout, "MAS:Read Register %d = %d \r\n", post.cmd, post.ird[0]);
+  return true;
 }
 
 /**
@@ -61,14 +116,34 @@ bool send_master(i2c_inst_t* i2c, uint8_t i2c_add, uint8_t cmd, uint16_t wdata,
   // Writing to A register
   int count;
   uint8_t buf[3];
+  uint8_t ird[2];
   int buflgth;  // contains size of the buffer
 
+  if (!send_master_collect(rback)) return false;  // error of the posted relay command
+
   buflgth = 2;
   buf[0] = cmd;    // command
   buf[1] = wdata;  // gpio
 
-  fprintf(stdout, "on sendmaster cmd: 0x%02x: add 0x%02x\r\n", cmd, i2c_add);
-  count = i2c_write_blocking(i2c, i2c_add, buf, buflgth, false);
+  // complete frame: write register, write register number then read back register value
+  sys_i2c_async_begin(i2c, i2c_add);
+  sys_i2c_async_write(i2c, buf, buflgth, true);
+  sys_i2c_async_write(i2c, buf, 1, true);
+  sys_i2c_async_read(i2c, ird, buflgth - 1);
+  if (sys_i2c_async_start(i2c, NULL, NULL) == PICO_OK)
+  {
+    // frame is on the bus, debug message are sent during the transfer
+    fprintf(stdout, "on sendmaster cmd: 0x%02x: add 0x%02x\r\n", cmd, i2c_add);
+    count = sys_i2c_async_wait(i2c);  // timeout, retry and recovery handled by sys_i2c
+  }
+  else
+  {  // DMA not available, use blocking transfer
+    fprintf(stdout, "on sendmaster cmd: 0x%02x: add 0x%02x\r\n", cmd, i2c_add);
+    count = sys_i2c_wbuf(i2c, i2c_add, buf, buflgth);
+    if (count > 0) count = sys_i2c_wbuf(i2c, i2c_add, buf, 1);
+    if (count > 0) count = sys_i2c_rbuf(i2c, i2c_add, ird, buflgth - 1);
+  }
+
   if (count < 0)
   {
     // puts("Couldn't write Register to slave");
@@ -80,15 +155,72 @@ bool send_master(i2c_inst_t* i2c, uint8_t i2c_add, uint8_t cmd, uint16_t wdata,
   fprintf(stdout, "MAS: Write at register %d: %02d\n", buf[0], buf[1]);
 
   // read register value and return to caller on pointer rback
-  uint8_t ird[2];
-  i2c_write_blocking(i2c, i2c_add, buf, 1, false);
-  i2c_read_blocking(i2c, i2c_add, ird, buflgth - 1, false);
-
   fprintf(stdout, "MAS:Read Register %d = %d \r\n", cmd, ird[0]);
   *rback = (uint8_t)ird[0];  // save read back value
   return true;
 }
 
+/**
+ * @brief Send a relay command on internal I2C port without waiting its completion.
+ *        The frame is transferred by DMA while the next SCPI command is parsed.
+ *        The result is checked by the next command sent to the slaves, or by i2c_com_event
+ *        which push the error on the SCPI error queue.
+ *
+ * @param i2c       The I2C port used by internal communication
+ * @param i2c_add   The address of the device to communicate with
+ * @param cmd       The byte command number to send to device
+ * @param wdata     The byte data to send to device
+ * @param rback     Set to 0, or error number of the previous posted command
+ * @return true     Command posted on the bus
+ * @return false    Previous posted command has error (error number on rback)
+ */
+
+bool send_master_post(i2c_inst_t* i2c, uint8_t i2c_add, uint8_t cmd, uint16_t wdata, uint16_t* rback)
+{
+  uint8_t buf[2];
+
+  if (!send_master_collect(rback)) return false;  // one command posted at a time
+
+  buf[0] = cmd;    // command
+  buf[1] = wdata;  // gpio
+
+  // same frame as send_master: write register, write register number then read back register value
+  sys_i2c_async_begin(i2c, i2c_add);
+  sys_i2c_async_write(i2c, buf, 2, true);
+  sys_i2c_async_write(i2c, buf, 1, true);
+  sys_i2c_async_read(i2c, post.ird, 1);
+
+  post.cmd = cmd;
+  post.done = false;
+  post.pending = true;
+  if (sys_i2c_async_start(i2c, send_master_done, NULL) != PICO_OK)
+  {
+    post.pending = false;
+    return send_master(i2c, i2c_add, cmd, wdata, rback);  // DMA not available, blocking transfer
+  }
+  fprintf(stdout, "on sendmaster post cmd: 0x%02x: add 0x%02x\r\n", cmd, i2c_add);
+  *rback = 0;
+  return true;
+}
+
+/**
+ * @brief Report the error of a posted relay command not collected by a following command.
+ *        Called by the main loop.
+ *
+ */
+
+void i2c_com_event(void)
+{
+  uint16_t rback;
+
+  if (!post.pending || !post.done) return;
+
+  if (!send_master_collect(&rback))
+  {
+    SCPI_ErrorPush(&scpi_context, I2C_COMMUNICATION_ERROR);
+  }
+}
+
 /**
  * @brief From a list of relay (list) and the action to perform
  *        the sub will perform the action (close, open or read) for each relay on the list
@@ -110,6 +242,10 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
   uint16_t rdata;
 
   fprintf(stdout, "On relay execute begin \r\n");
+  if (action != RSTATE && action != BSTATE && action != SESTATE && action != PWSTATE && action != OCSTATE)
+  {
+    adc_acq_event();  // relay switching could trigger the ADC capture
+  }
 
   do
   {
@@ -221,14 +357,14 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
         case RCLOSE:
           if (action == RCLEX)
           {  // Open relay bank on exclusive command
-            smf = send_master(i2c0, i2c_add, OPEN_RELAY_BANK, gpio, &rdata);
+            smf = send_master_post(i2c0, i2c_add, OPEN_RELAY_BANK, gpio, &rdata);
             if (!smf)
             {
               answer[0] = rdata;  // save error on answer
               return false;       // return
             }
           }
-          smf = send_master(i2c0, i2c_add, CLOSE_RELAY, gpio, &rdata);  // close required relay
+          smf = send_master_post(i2c0, i2c_add, CLOSE_RELAY, gpio, &rdata);  // close required relay
           if (!smf)
           {
             answer[0] = rdata;
@@ -238,7 +374,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
           {  // if valid SE number
             if (se)
             {  // close or open the SE relay
-              smf = send_master(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
+              smf = send_master_post(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
               if (!smf)
               {
                 answer[0] = rdata;
@@ -247,7 +383,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
             }
             else
             {
-              smf = send_master(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
+              smf = send_master_post(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
               if (!smf)
               {
                 answer[0] = rdata;
@@ -259,7 +395,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
           break;
 
         case ROPEN:
-          smf = send_master(i2c0, i2c_add, OPEN_RELAY, gpio, &rdata);  // open relay bank
+          smf = send_master_post(i2c0, i2c_add, OPEN_RELAY, gpio, &rdata);  // open relay bank
           if (!smf)
           {
             answer[0] = rdata;
@@ -269,7 +405,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
           {  // if valid SE number
             if (se)
             {  // close or open the SE relay
-              smf = send_master(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
+              smf = send_master_post(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
               if (!smf)
               {
                 answer[0] = rdata;
@@ -278,7 +414,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
             }
             else
             {
-              smf = send_master(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
+              smf = send_master_post(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
               if (!smf)
               {
                 answer[0] = rdata;
@@ -290,7 +426,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
           break;
 
         case ROPALL:
-          smf = send_master(i2c0, i2c_add, OPEN_RELAY_BANK, gpio, &rdata);  // open relay bank
+          smf = send_master_post(i2c0, i2c_add, OPEN_RELAY_BANK, gpio, &rdata);  // open relay bank
           if (!smf)
           {
             answer[0] = rdata;
@@ -300,7 +436,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
           {  // if valid SE number
             if (se)
             {  // close or open the SE relay
-              smf = send_master(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
+              smf = send_master_post(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
               if (!smf)
               {
                 answer[0] = rdata;
@@ -309,7 +445,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
             }
             else
             {
-              smf = send_master(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
+              smf = send_master_post(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
               if (!smf)
               {
                 answer[0] = rdata;
@@ -350,7 +486,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
           break;
 
         case SECLOSE:
-          smf = send_master(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
+          smf = send_master_post(i2c0, i2c_add, CLOSE_RELAY, ser, &rdata);
           if (!smf)
           {
             answer[0] = rdata;
@@ -361,17 +497,18 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
 
         case PWCLOSE:
         case OCCLOSE:
-          smf = send_master(i2c0, i2c_add, CLOSE_RELAY, gpio, &rdata);  // read required relay
+          smf = send_master_post(i2c0, i2c_add, CLOSE_RELAY, gpio, &rdata);  // read required relay
           if (!smf)
           {
             answer[0] = rdata;
             return false;
           }  // Save error and return
           fprintf(stdout, "MAS: CLOSE Device on slave 0x%02x using gpio: %02d\n", i2c_add, gpio);
+          if (action == PWCLOSE) pwr_cap_event();  // inrush capture if armed
           break;
 
         case SEOPEN:
-          smf = send_master(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
+          smf = send_master_post(i2c0, i2c_add, OPEN_RELAY, ser, &rdata);
           if (!smf)
           {
             answer[0] = rdata;
@@ -382,7 +519,7 @@ bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer)
 
         case PWOPEN:
         case OCOPEN:
-          smf = send_master(i2c0, i2c_add, OPEN_RELAY, gpio, &rdata);  // open relay bank
+          smf = send_master_post(i2c0, i2c_add, OPEN_RELAY, gpio, &rdata);  // open relay bank
           if (!smf)
           {
             answer[0] = rdata;
@@ -789,3 +926,89 @@ bool system_execute(uint8_t action, uint16_t* answer)
   }
   return true;
 }
+
+/**
+ * @brief  Read the I2C capability of a Pico slave at the default speed. A slave without the
+ *         capability register does not return the signature, fast mode is used.
+ *
+ * @param addr      Address of the slave
+ * @return uint32_t Maximum baudrate supported by the slave
+ */
+
+static uint32_t i2c_slave_maxspeed(uint8_t addr)
+{
+  uint16_t caps;
+
+  sys_i2c_setspeed(i2c0, addr, I2C_BAUDRATE);  // all slaves answer at the default speed
+  if (!send_master(i2c0, addr, SL_I2C_CAPS, 0, &caps) || (caps & 0xF0) != I2C_CAPS_SIGN)
+  {
+    return I2C_FAST_BAUDRATE;
+  }
+  return (caps & I2C_CAPS_FMPLUS) ? I2C_FMPLUS_BAUDRATE : I2C_FAST_BAUDRATE;
+}
+
+/**
+ * @brief  Find the speed supported by each device of the internal I2C. Each device start at
+ *         the maximum speed of his profile, limited by the capability register of the Pico slaves.
+ *         The speed is reduced until the probe read pass. The probe read has no retry and does
+ *         not update the error counters and the speed fallback.
+ *
+ * @return true   All devices communicate at the maximum speed of their profile
+ * @return false  At least one device has been moved to a lower speed
+ */
+
+bool i2c_speed_negotiate(void)
+{
+  const uint32_t profile[][3] = I2C_SPEED_PROFILE;  // address, maximum baudrate, capability register
+  bool all_max = true;
+
+  for (size_t i = 0; i < count_of(profile); i++)
+  {
+    uint8_t addr = profile[i][0];
+    uint32_t baud = profile[i][1];
+
+    if (profile[i][2])
+    {
+      uint32_t caps = i2c_slave_maxspeed(addr);
+      if (caps < baud) baud = caps;  // slave firmware without fast mode plus
+    }
+
+    while (1)
+    {
+      bool pass = true;
+      sys_i2c_setspeed(i2c0, addr, baud);
+      for (uint8_t j = 0; j < I2C_SPEED_PROBE && pass; j++)
+      {
+        pass = sys_i2c_test(i2c0, addr);  // probe device at this speed
+      }
+
+      if (pass || baud <= I2C_BAUDRATE)
+      {
+        break;  // speed validated or already at the lowest speed
+      }
+      baud = (baud > I2C_FAST_BAUDRATE) ? I2C_FAST_BAUDRATE : I2C_BAUDRATE;  // step down
+      all_max = false;
+    }
+    fprintf(stdout, "I2C device 0x%02x speed: %lu Hz\r\n", addr, sys_i2c_getspeed(i2c0, addr));
+  }
+  return all_max;
+}
+
+/**
+ * @brief  Build the list of speed used by each device of the internal I2C
+ *
+ * @param str   String to receive the list, format: 0xaddr:baudrate; ...
+ * @param size  Size of the string
+ */
+
+void i2c_speed_list(char* str, size_t size)
+{
+  const uint32_t profile[][3] = I2C_SPEED_PROFILE;  // address, maximum baudrate, capability register
+  size_t len = 0;
+
+  str[0] = '\0';
+  for (size_t i = 0; i < count_of(profile) && len < size; i++)
+  {
+    len += snprintf(&str[len], size - len, "%s0x%02" PRIx32 ":%" PRIu32, i ? "; " : "", profile[i][0], sys_i2c_getspeed(i2c0, profile[i][0]));
+  }
+}
@@ -0,0 +1,131 @@
+/**
+ * @file    adc_acq.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the ADC acquisition engine.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _ADC_ACQ_H_
+#define _ADC_ACQ_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Free running acquisition settings.
+ *
+ * The ADC converts ADC0, ADC1, VSYS and TEMP in round robin, DMA moves the
+ * samples on a ring buffer. The size of the ring must be a power of 2 for the DMA ring wrap.
+ */
+#define ADC_ACQ_RR_MASK 0x1B                      //!< Round robin inputs: ADC0, ADC1, VSYS (3), TEMP (4)
+#define ADC_ACQ_NB_CH 4                           //!< Number of inputs on round robin
+#define ADC_ACQ_RATE 40000                        //!< Total conversion rate in sample/s (10 kS/s per input)
+#define ADC_ACQ_RING_BITS 12                      //!< Ring size in bytes, 1 << 12 = 4096 bytes
+#define ADC_ACQ_RING ((1 << ADC_ACQ_RING_BITS) / 2)  //!< Number of 16 bits samples on the ring
+#define ADC_ACQ_DMA_COUNT 0x10000000              //!< Transfer count reloaded by DMA interrupt, multiple of ring
+#define ADC_ACQ_MAX_COUNT 10000                   //!< Maximum samples used for one statistic (1 s per input)
+#define ADC_ACQ_DEF_COUNT 1                       //!< Default number of samples to average
+#define ADC_CLOCK 48000000.0f                     //!< ADC clock, one conversion take 96 clock cycles
+
+/**
+ * @brief Acquisition mode of the ADC.
+ */
+#define ADC_MODE_OFF 0      //!< ADC free for single conversion
+#define ADC_MODE_FREE 1     //!< Free running acquisition of all inputs
+#define ADC_MODE_CAPTURE 2  //!< Triggered capture of ADC0 or ADC1
+
+/**
+ * @brief Triggered capture settings.
+ *
+ * The capture buffer is a DMA ring, the maximum number of points keep a margin on the ring
+ * for the delay between the end of capture and the stop of the DMA.
+ */
+#define ADC_CAP_RING_BITS 15                         //!< Ring size in bytes, 1 << 15 = 32768 bytes (DMA maximum)
+#define ADC_CAP_RING ((1 << ADC_CAP_RING_BITS) / 2)  //!< Number of 16 bits samples on the capture ring
+#define ADC_CAP_MAX_POINTS 12288                     //!< Maximum number of points of a capture
+#define ADC_CAP_MIN_RATE 1000                        //!< Minimum capture rate in sample/s
+#define ADC_CAP_MAX_RATE 500000                      //!< Maximum capture rate in sample/s
+#define ADC_CAP_DEF_RATE 100000                      //!< Default capture rate in sample/s
+#define ADC_CAP_DEF_POINTS 1000                      //!< Default number of points of a capture
+#define ADC_CAP_POLL_US 1000                         //!< Period of trigger and end of capture check
+
+/**
+ * @brief State of the triggered capture.
+ */
+#define ADC_CAP_IDLE 0       //!< No capture
+#define ADC_CAP_ARMED 1      //!< Capture running, wait trigger
+#define ADC_CAP_TRIGGERED 2  //!< Trigger found, acquisition of post-trigger points
+#define ADC_CAP_DONE 3       //!< Capture completed, data available
+
+/**
+ * @brief Trigger source of the capture.
+ */
+#define ADC_TRIG_IMM 0        //!< Immediate, no trigger
+#define ADC_TRIG_RISE 1       //!< Signal cross the level on rising slope
+#define ADC_TRIG_FALL 2       //!< Signal cross the level on falling slope
+#define ADC_TRIG_GPIO_RISE 3  //!< Rising edge on a GPIO of the master
+#define ADC_TRIG_GPIO_FALL 4  //!< Falling edge on a GPIO of the master
+#define ADC_TRIG_RELAY 5      //!< Relay command executed
+
+/**
+ * @brief Statistic computed on consecutive samples of one input.
+ *
+ * Values are converted on unit of the input (Volt or Celsius).
+ */
+typedef struct
+{
+  float mean;    //!< Average of samples
+  float min;     //!< Minimum value
+  float max;     //!< Maximum value
+  float stddev;  //!< Sample standard deviation (0 if only one sample)
+} adc_stat_t;
+
+/**
+ * @brief Configuration of the triggered capture of one ADC input.
+ */
+typedef struct
+{
+  uint32_t rate;     //!< Sample rate in sample/s
+  uint32_t points;   //!< Number of points of the capture
+  uint32_t pretrig;  //!< Number of points before the trigger
+  uint8_t source;    //!< Trigger source (ADC_TRIG_xxx)
+  float level;       //!< Level in Volt for ADC_TRIG_RISE and ADC_TRIG_FALL
+  uint8_t pin;       //!< GPIO for ADC_TRIG_GPIO_RISE and ADC_TRIG_GPIO_FALL
+} adc_cap_cfg_t;
+
+bool adc_acq_start(void);
+void adc_acq_stop(void);
+bool adc_acq_running(void);
+uint16_t adc_acq_last(uint8_t channel);
+float adc_acq_convert(uint8_t channel, float raw);
+uint8_t adc_acq_stat(uint8_t channel, uint32_t count, adc_stat_t* st);
+uint8_t adc_acq_set_count(uint32_t count);
+uint32_t adc_acq_get_count(void);
+void adc_acq_event(void);
+uint8_t adc_cap_set_rate(uint8_t channel, uint32_t rate);
+uint8_t adc_cap_set_points(uint8_t channel, uint32_t points);
+uint8_t adc_cap_set_pretrig(uint8_t channel, uint32_t pretrig);
+uint8_t adc_cap_set_trigger(uint8_t channel, uint8_t source, float level, uint8_t pin);
+const adc_cap_cfg_t* adc_cap_get_cfg(uint8_t channel);
+uint8_t adc_cap_init(uint8_t channel);
+void adc_cap_abort(void);
+uint8_t adc_cap_state(void);
+uint8_t adc_cap_data(uint8_t channel, const uint16_t** p1, uint32_t* n1, const uint16_t** p2, uint32_t* n2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _ADC_ACQ_H_
@@ -0,0 +1,73 @@
+/**
+ * @file    adc_cal.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the ADC calibration.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _ADC_CAL_H_
+#define _ADC_CAL_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/fixq.h"
+
+/**
+ * @brief Calibration of the ADC inputs.
+ *
+ * The value of an input is corrected as: value = gain x nominal value + offset.
+ * Gain and offset are folded at load in one scale and one base by input, the conversion
+ * of a calibrated sample use one multiplication as the nominal conversion.
+ */
+#define ADC_CAL_NB_CH 5              //!< ADC inputs 0 to 4 (input 2 not used)
+#define ADC_CAL_MIN_GAIN Q16(0.5)    //!< Minimum gain
+#define ADC_CAL_MAX_GAIN Q16(1.5)    //!< Maximum gain
+#define ADC_CAL_MAX_OFFSET Q16(10)   //!< Maximum offset (V or Celsius)
+#define ADC_CAL_AUTO_LOW Q16(0.5)    //!< Low DAC voltage of the auto-calibration
+#define ADC_CAL_AUTO_HIGH Q16(2.5)   //!< High DAC voltage of the auto-calibration
+#define ADC_CAL_AUTO_SAMPLES 64      //!< Samples averaged on each point of the auto-calibration
+#define ADC_CAL_SETTLE_MS 10         //!< Settle time of the DAC before the measure
+
+/**
+ * @brief Calibration record, kept on the parameter store (EE_KEY_ADC_CAL).
+ */
+#define ADD_EEPROM_CAL 0x100  //!< EEPROM address of the record before the parameter store, moved at load
+#define ADC_CAL_MAGIC 0xCA    //!< First byte of a calibration record
+#define ADC_CAL_VERSION 1     //!< Version of the record layout
+
+typedef struct __attribute__((packed))
+{
+  uint8_t magic;                  //!< ADC_CAL_MAGIC
+  uint8_t version;                //!< ADC_CAL_VERSION
+  q16_t gain[ADC_CAL_NB_CH];      //!< Gain by input
+  q16_t offset[ADC_CAL_NB_CH];    //!< Offset by input, V (input 0,1,3) or Celsius (input 4)
+  uint16_t crc;                   //!< CRC-16 CCITT of the previous bytes
+} adc_cal_rec_t;
+
+uint8_t adc_cal_load(void);
+uint8_t adc_cal_save(void);
+uint8_t adc_cal_set(uint8_t channel, q16_t gain, q16_t offset);
+uint8_t adc_cal_get(uint8_t channel, q16_t* gain, q16_t* offset);
+uint8_t adc_cal_auto(uint8_t channel);
+uint8_t adc_cal_reset(void);
+q16_t adc_cal_convert(uint8_t channel, uint16_t raw);
+float adc_cal_convert_float(uint8_t channel, float raw);
+uint16_t adc_cal_to_raw(uint8_t channel, float value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _ADC_CAL_H_
@@ -0,0 +1,103 @@
+/**
+ * @file    cfg_param.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining the schema of the configuration parameters.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _CFG_PARAM_H_
+#define _CFG_PARAM_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Type of a parameter, the value is kept in binary on the parameter store.
+ */
+typedef enum
+{
+  CFG_T_STR,   //!< String of maximum size characters
+  CFG_T_U32,   //!< Unsigned number, limited to min and max
+  CFG_T_BOOL   //!< 0 or 1
+} cfg_type_t;
+
+/**
+ * @brief Schema of the configuration, one line by parameter:
+ *        X(id, field, name, type, size, string default, number default, min, max)
+ *
+ * A parameter is added by a new line at the end of the table, the parameter take its default
+ * value until it is written. CFG_SCHEMA_VERSION is incremented only if a stored value need a
+ * conversion (migration step on cfg_param.c).
+ */
+#define CFG_SCHEMA_VERSION 1  //!< Version of the schema, written on the parameter store
+
+#define CFG_PARAM_TABLE(X)                                                                      \
+  X(CFG_CHECK, check, "CHECK", CFG_T_STR, 1, "#", 0, 0, 0)                                      \
+  X(CFG_PARTNUMBER, partnumber, "PARTNUMBER", CFG_T_STR, 13, "500-1000-010", 0, 0, 0)           \
+  X(CFG_SERIALNUMBER, serialnumber, "SERIALNUMBER", CFG_T_STR, 6, "00001", 0, 0, 0)             \
+  X(CFG_MOD_OPTION, mod_option, "MOD_OPTION", CFG_T_STR, 15, "DAC,PWR", 0, 0, 0)                \
+  X(CFG_COM_SER_SPEED, com_ser_speed, "COM_SER_SPEED", CFG_T_U32, 0, "", 115200, 300, 921600)   \
+  X(CFG_COM_SER_ECHO, com_ser_echo, "COM_SER_ECHO", CFG_T_BOOL, 0, "", 0, 0, 1)                 \
+  X(CFG_SLAVE_FORCE_RUN, slave_force_run, "PICO_SLAVES_RUN", CFG_T_BOOL, 0, "", 0, 0, 1)        \
+  X(CFG_TESTBOARD_NUM, testboard_num, "TESTBOARD_NUM", CFG_T_STR, 13, "500-1010-020", 0, 0, 0)  \
+  X(CFG_PARAMETER1, parameter1, "PARAMETER1", CFG_T_STR, 15, "NOT_DEFINED1", 0, 0, 0)           \
+  X(CFG_PARAMETER2, parameter2, "PARAMETER2", CFG_T_STR, 15, "NOT_DEFINED2", 0, 0, 0)           \
+  X(CFG_PARAMETER3, parameter3, "PARAMETER3", CFG_T_STR, 15, "NOT_DEFINED3", 0, 0, 0)           \
+  X(CFG_PARAMETER4, parameter4, "PARAMETER4", CFG_T_STR, 15, "NOT_DEFINED4", 0, 0, 0)           \
+  X(CFG_PARAMETER5, parameter5, "PARAMETER5", CFG_T_STR, 15, "NOT_DEFINED5", 0, 0, 0)           \
+  X(CFG_TEST, test, "TEST", CFG_T_STR, 10, "TEST", 0, 0, 0)
+
+#define CFG_ID(id, field, name, type, size, sdef, ndef, min, max) id,
+#define CFG_FIELD_CFG_T_STR(field, size) char field[(size) + 1];
+#define CFG_FIELD_CFG_T_U32(field, size) uint32_t field;
+#define CFG_FIELD_CFG_T_BOOL(field, size) bool field;
+#define CFG_FIELD(id, field, name, type, size, sdef, ndef, min, max) CFG_FIELD_##type(field, size)
+
+/**
+ * @brief Index of the parameters.
+ */
+typedef enum
+{
+  CFG_PARAM_TABLE(CFG_ID)
+  CFG_NB_PARAM  //!< Number of parameters
+} cfg_id_t;
+
+/**
+ * @brief Values of the parameters on RAM, default values until the load.
+ */
+typedef struct
+{
+  CFG_PARAM_TABLE(CFG_FIELD)
+} cfg_values_t;
+
+extern cfg_values_t cfg_val;  //!< Configuration used by the firmware
+
+#define CFG_HASH_SLOTS 32        //!< Slots of the name lookup table (power of 2)
+#define CFG_TEXT_SIZE 24         //!< Buffer size for the text of a value
+
+uint8_t cfg_param_load(void);
+uint8_t cfg_param_state(void);
+int cfg_param_find(const char* name);
+const char* cfg_param_name(cfg_id_t id);
+uint8_t cfg_param_set_text(cfg_id_t id, const char* text);
+uint32_t cfg_param_get_text(cfg_id_t id, char* text, size_t size);
+uint8_t cfg_param_default(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _CFG_PARAM_H_
@@ -0,0 +1,100 @@
+/**
+ * @file    ee_log.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the journaled parameter store on the
+ *          configuration eeprom.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _EE_LOG_H_
+#define _EE_LOG_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Journaled key/value store.
+ *
+ * The area after the fixed records is split in two banks. Each value written is appended on the
+ * active bank as a new record (key, length, sequence, value, CRC), the last record of a key is the
+ * valid one. When the bank is filled at EE_LOG_COMPACT_LEVEL, the valid records are copied on the
+ * other bank in background and the other bank become active when its header is written.
+ * A write interrupted by a power loss leave a record with a bad CRC, ignored at boot.
+ */
+#define EE_LOG_BASE 0x200                                 //!< EEPROM address of the first bank (page aligned)
+#define EE_LOG_BANK_SIZE ((EESIZE - EE_LOG_BASE) / 2)     //!< Size of a bank (1792 bytes)
+#define EE_LOG_MAGIC 0x4B56                               //!< Bank header signature ("VK")
+#define EE_LOG_MAX_KEY 31                                 //!< Keys 1 to EE_LOG_MAX_KEY
+#define EE_LOG_MAX_VALUE 64                               //!< Maximum length of a value
+#define EE_LOG_COMPACT_LEVEL (EE_LOG_BANK_SIZE * 3 / 4)   //!< Bank use starting the background compaction
+
+/**
+ * @brief Keys of the values kept on the store.
+ */
+#define EE_KEY_BOOT_COUNT 1  //!< Number of boot (uint32_t)
+#define EE_KEY_ADC_CAL 2     //!< ADC calibration record (adc_cal_rec_t)
+#define EE_KEY_CFG_VERSION 3 //!< Schema version of the configuration (uint16_t)
+#define EE_KEY_CFG_BASE 8    //!< First configuration parameter, one key by parameter (cfg_param.h)
+
+/**
+ * @brief Header at the beginning of a bank.
+ */
+typedef struct __attribute__((packed))
+{
+  uint16_t magic;  //!< EE_LOG_MAGIC
+  uint16_t gen;    //!< Generation, the valid bank with the newest generation is active
+  uint16_t crc;    //!< CRC-16 CCITT of the previous bytes
+} ee_log_bank_t;
+
+/**
+ * @brief Header of a record, followed by the value and the CRC-16 of header and value.
+ *        The CRC is initialized with the generation of the bank, a record left by
+ *        a previous use of the bank is not valid.
+ */
+typedef struct __attribute__((packed))
+{
+  uint8_t key;   //!< Key (1 to EE_LOG_MAX_KEY)
+  uint8_t len;   //!< Length of the value, 0 for an erased key
+  uint16_t seq;  //!< Sequence of the record on the bank, start at 0
+} ee_log_rec_t;
+
+/**
+ * @brief State of the store returned by ee_log_status.
+ */
+typedef struct
+{
+  uint8_t bank;          //!< Active bank (0 or 1)
+  uint16_t gen;          //!< Generation of the active bank
+  uint32_t used;         //!< Bytes used on the active bank
+  uint32_t keys;         //!< Number of keys with a value
+  uint32_t compactions;  //!< Compactions since boot
+  uint32_t errors;       //!< Write or verify errors since boot
+} ee_log_status_t;
+
+uint16_t ee_log_crc16(const uint8_t* data, size_t len, uint16_t crc);
+uint8_t ee_log_init(void);
+uint8_t ee_log_get(uint8_t key, void* data, uint8_t size, uint8_t* len);
+uint8_t ee_log_put(uint8_t key, const void* data, uint8_t len);
+uint8_t ee_log_erase(uint8_t key);
+uint8_t ee_log_compact(void);
+void ee_log_event(void);
+void ee_log_status(ee_log_status_t* st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _EE_LOG_H_
@@ -0,0 +1,121 @@
+/**
+ * @file    fixq.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining the Q16.16 fixed point type used by the measurement functions.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _FIXQ_H_
+#define _FIXQ_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Q16.16 fixed point value, 16 bits integer and 16 bits fraction (resolution 15.3 uV on Volt).
+ *
+ * The RP2040 has no floating point unit, measures are computed on integer and converted
+ * to decimal text only when the answer is sent.
+ */
+typedef int32_t q16_t;
+
+#define Q16_SHIFT 16                 //!< Number of bits of the fraction
+#define Q16_ONE (1L << Q16_SHIFT)    //!< Value 1.0
+#define Q16_MAX_DECIMALS 6           //!< Maximum number of decimals on text conversion
+#define Q16_DEF_DECIMALS 4           //!< Decimals used on measure answer
+#define Q16_MAX INT32_MAX            //!< Largest value (32767.99998)
+#define Q16_MIN INT32_MIN            //!< Smallest value (-32768.0)
+#define Q16_MILLI_LIMIT 32767999L    //!< Largest milli unit converted without overflow
+
+/**
+ * @brief Constant converted at compile time, x must be a constant expression.
+ */
+#define Q16(x) ((q16_t)((x) * 65536.0 + (((x) >= 0) ? 0.5 : -0.5)))
+
+/**
+ * @brief Integer in milli or micro unit to Q16, multiplication by 2^40 / 10^n reciprocal (no division).
+ */
+#define Q16_RECIP_MILLI 1099511628LL  //!< 2^40 / 1000
+#define Q16_RECIP_MICRO 1099512LL     //!< 2^40 / 1000000
+
+/**
+ * @brief Multiply two Q16 values with rounding
+ */
+static inline q16_t q16_mul(q16_t a, q16_t b)
+{
+  return (q16_t)(((int64_t)a * b + (1 << (Q16_SHIFT - 1))) >> Q16_SHIFT);
+}
+
+/**
+ * @brief Convert a value in milli unit (mV, mA, mW) to Q16 of the unit
+ */
+static inline q16_t q16_from_milli(int32_t m)
+{
+  return (q16_t)(((int64_t)m * Q16_RECIP_MILLI + (1LL << 23)) >> 24);
+}
+
+/**
+ * @brief Convert a value in milli unit to Q16 of the unit, saturated to the Q16 range
+ *
+ * @param m     Value in milli unit
+ * @param over  Set to true if the value is saturated, NULL if not used
+ */
+static inline q16_t q16_from_milli_sat(int32_t m, bool* over)
+{
+  bool sat = (m > Q16_MILLI_LIMIT || m < -Q16_MILLI_LIMIT - 1);
+
+  if (over) *over = sat;
+  if (sat) return (m > 0) ? Q16_MAX : Q16_MIN;
+  return q16_from_milli(m);
+}
+
+/**
+ * @brief Convert a value in micro unit (uV, uA, uW) to Q16 of the unit
+ */
+static inline q16_t q16_from_micro(int32_t u)
+{
+  return (q16_t)(((int64_t)u * Q16_RECIP_MICRO + (1LL << 23)) >> 24);
+}
+
+/**
+ * @brief Convert a Q16 value to milli unit with rounding
+ */
+static inline int32_t q16_to_milli(q16_t q)
+{
+  return (int32_t)(((int64_t)q * 1000 + ((q >= 0) ? (1 << 15) : -(1 << 15))) >> Q16_SHIFT);
+}
+
+/**
+ * @brief Conversion with float, used only by functions keeping a float interface
+ */
+static inline float q16_to_float(q16_t q)
+{
+  return (float)q * (1.0f / 65536.0f);
+}
+
+static inline q16_t q16_from_float(float f)
+{
+  return (q16_t)(f * 65536.0f + ((f >= 0) ? 0.5f : -0.5f));
+}
+
+int q16_format(char* buf, size_t size, q16_t v, uint8_t decimals);
+bool q16_parse(const char* s, size_t len, q16_t* v);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _FIXQ_H_
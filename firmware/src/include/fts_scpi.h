@@ -87,6 +87,19 @@ extern "C"
 #define OCOPEN 28   //!< deactivate Open Collector
 #define OCSTATE 29  //!< Read state of Open Collector
 
+#define SAQR 30   //!< Set ADC capture sample rate
+#define GAQR 31   //!< Read ADC capture sample rate
+#define SAQP 32   //!< Set ADC capture number of points
+#define GAQP 33   //!< Read ADC capture number of points
+#define SAQE 34   //!< Set ADC capture number of pre-trigger points
+#define GAQE 35   //!< Read ADC capture number of pre-trigger points
+#define SAQT 36   //!< Set ADC capture trigger
+#define GAQT 37   //!< Read ADC capture trigger
+#define IAQ 38    //!< Start ADC capture
+#define AAQ 39    //!< Abort ADC capture
+#define GAQS 40   //!< Read ADC capture state
+#define FAQ 41    //!< Fetch ADC capture points as binary block
+
 #define SBEEP 50  //!< Send Beep pulse
 #define SVER 51   //!< Read version of Pico Master and slave
 #define SLERR 52  //!< Control of error led
@@ -97,6 +110,9 @@ extern "C"
 #define GOE 57    //!< Read status Output Enable ON/OFF
 #define GSTA 58   //!< Read Slave Device status byte
 #define STBR 59   //!< Run complete test with selftest board connected
+#define GI2S 60   //!< Read internal I2C error counters
+#define CI2S 61   //!< Clear internal I2C error counters
+#define GI2F 62   //!< Read internal I2C speed of each device
 
 #define SDAC 63   //!< Set DAC Voltage
 #define WDAC 64   //!< Set DAC Voltage and save as default value
@@ -110,20 +126,39 @@ extern "C"
 #define RPI 72  //!< Read Power current in milliAmpere
 #define RPP 73  //!< Read Power in milliWatt
 #define CPI 74  //!< Calibrate current on power device
+#define SAVC 75  //!< Set number of samples averaged on ADC measure
+#define GAVC 76  //!< Read number of samples averaged on ADC measure
+
+#define SPAM 42  //!< Set INA219 ADC resolution and averaging
+#define GPAM 43  //!< Read INA219 ADC resolution, averaging and measure time
+#define GBEN 44  //!< Read cycles used by float and fixed point analog answer
 
 #define WEEP 78  //!< Write to eeprom
 #define REEP 79  //!< Read from eeprom
 #define WDEF 80  //!< Write default value to EEprom
 #define RFUL 81  //!< Read complete data on Eeprom
+#define CSAV 172 //!< Write modified configuration on EEprom
+#define QSAV 173 //!< Read number of configuration parameters not yet written on EEprom
 
 #define W1W 84  //!< Write on 1-Wire devices
 #define R1W 85  //!< Read on 1-Wire devices
 #define C1W 86  //!< Check on 1-Wire devices
+#define Q1W 87  //!< Read ID of 1-Wire devices found on link
 
 #define CIE 88  //!< Enable communication protocol
 #define CID 89  //!< Disable communication protocol, set pin as GPIO
 #define CRI 90  //!< Read status communication protocol
 
+#define GPST 91  //!< Read power monitor statistic
+#define GPEN 92  //!< Read power monitor energy and charge
+#define CPST 93  //!< Clear power monitor statistic and energy
+#define SPSP 94  //!< Set power monitor sampling period
+#define GPSP 95  //!< Read power monitor sampling period
+#define APCA 96  //!< Arm inrush current capture on next power relay close
+#define GPCS 97  //!< Read inrush capture state
+#define GPCR 98  //!< Read inrush capture peak current and settle time
+#define GPCD 99  //!< Read inrush capture points as binary block
+
 #define CSWD 100  //!< Write Data on user serial port, no answer
 #define CSRD 101  //!< Write Data on user serial port and wait for the answer
 #define CSWB 102  //!< Write user serial baudrate
@@ -134,6 +169,14 @@ extern "C"
 #define CSRH 107  //!< Read user serial Handshake
 #define CSWT 108  //!< Write user serial Timeout
 #define CSRT 109  //!< Read user serial Timeout
+#define CSWE 121  //!< Write user serial terminator characters
+#define CSRE 122  //!< Read user serial terminator characters
+#define CSCA 123  //!< Start or stop the capture of user serial received characters
+#define CSCS 124  //!< Read user serial capture state
+#define CSCD 125  //!< Read user serial captured characters as binary block
+#define CSCC 126  //!< Read number of user serial characters captured
+#define CSEX 127  //!< Wait for a pattern on user serial port
+#define CSSC 128  //!< Run an expect and send script on user serial port
 
 #define SPWD 111   //!< Write Data on SPI port, read data
 #define SPRD 112   //!< Read Data  on SPI port
@@ -155,6 +198,47 @@ extern "C"
 #define ICWDB 137  //!< Write user I2C databits
 #define ICRDB 138  //!< Read user I2C databits
 
+#define SWFN 139  //!< Set DAC waveform function
+#define GWFN 140  //!< Read DAC waveform function
+#define SWFR 141  //!< Set DAC waveform frequency
+#define GWFR 142  //!< Read DAC waveform frequency
+#define SWAM 143  //!< Set DAC waveform amplitude
+#define GWAM 144  //!< Read DAC waveform amplitude
+#define SWOF 145  //!< Set DAC waveform offset
+#define GWOF 146  //!< Read DAC waveform offset
+#define SWAD 147  //!< Load DAC arbitrary waveform codes
+#define SWAA 148  //!< Append DAC arbitrary waveform codes
+#define GWAP 149  //!< Read number of DAC arbitrary waveform codes
+
+#define SSWS 150  //!< Set DAC sweep start voltage
+#define GSWS 151  //!< Read DAC sweep start voltage
+#define SSWE 152  //!< Set DAC sweep stop voltage
+#define GSWE 153  //!< Read DAC sweep stop voltage
+#define SSWP 154  //!< Set DAC sweep number of points
+#define GSWP 155  //!< Read DAC sweep number of points
+#define SSWD 156  //!< Set DAC sweep dwell time
+#define GSWD 157  //!< Read DAC sweep dwell time
+#define SSWC 158  //!< Set INA219 current measure on DAC sweep
+#define GSWC 159  //!< Read INA219 current measure on DAC sweep
+#define RSWD 160  //!< Execute DAC sweep and read points as binary block
+
+#define GHLT 161  //!< Read VSYS, temperature and faults of the health monitor
+#define GHST 162  //!< Read statistic of the health monitor
+#define CHST 163  //!< Clear statistic of the health monitor
+#define SHSP 164  //!< Set sampling period of the health monitor
+#define GHSP 165  //!< Read sampling period of the health monitor
+
+#define SCAG 166  //!< Set ADC calibration gain
+#define GCAG 167  //!< Read ADC calibration gain
+#define SCAO 168  //!< Set ADC calibration offset
+#define GCAO 169  //!< Read ADC calibration offset
+#define ACAL 170  //!< Auto-calibration of ADC with the DAC
+#define RCAL 171  //!< Restore nominal ADC calibration
+
+#define GLOG 174  //!< Read state of the parameter store
+#define CLOG 175  //!< Compact the parameter store
+#define GBCT 176  //!< Read number of boot
+
 #define SCPI_BANK1 1     //!< Open BK1 relay tag
 #define SCPI_BANK2 2     //!< Open BK2 relay tag
 #define SCPI_BANK3 3     //!< Open BK3 relay tag
@@ -258,6 +342,7 @@ extern "C"
   void init_scpi();
   void ErrorBeep(uint8_t nbeep);
   void RegBitHdwrErr(reg_info_index_t index, bool scbit);
+  void RegBitHdwrLive(reg_info_index_t index, bool scbit);
   static size_t output_buffer_write(const char* data, size_t len);
 
 #endif  //!<
\ No newline at end of file
@@ -16,6 +16,7 @@
 #define _FUNCTADV_H_
 
 #include "hardware/i2c.h"
+#include "include/fixq.h"
 
 /** ADC resource definitions */
 #define ADC0 26       //!< ADC channel 0
@@ -28,6 +29,18 @@
 #define MINDACVOLT 0    //!< Minimum voltage for the MCP4725 DAC
 #define MAXDACVOLT 3.3  //!< Maximum voltage for the MCP4725 DAC
 
+/**
+ * @brief Cycles used by the float and the fixed point version of one ANAlog answer.
+ */
+typedef struct
+{
+  uint32_t fp_cycles;   //!< Float computation and printf("%f") formatting
+  uint32_t fix_cycles;  //!< Q16 computation and integer formatting
+} analog_bench_t;
+
+#define ANALOG_BENCH_NB 4     //!< Benchmarks: ADC volt, ADC temperature, INA219 current, DAC code
+#define ANALOG_BENCH_LOOP 64  //!< Number of executions averaged by the benchmark
+
 /** Error Flags used on EEPROM */
 #define NOERR 0  //!< No error
 #define EOOR 1   //!< Flag for error due to data out of range
@@ -40,11 +53,21 @@
 #define EBE 8    //!< Read Byte Error
 
 /** EEPROM address definitions */
-#define ADD_EEPROM_BASE 0x40  //!< EEPROM base address to start
+#define ADD_EEPROM_BASE 0x40  //!< EEPROM address of the configuration before the parameter store (schema 0)
 #define TEST_EEPROM_ADD 0x0   //!< EEPROM address used during self-test
 #define EE_PAGESIZE 32        //!< Page size
 #define EEMODEL 32            //!< 24LC32 EEPROM model
 #define EESIZE 4096           //!< 24LC32 EEPROM size
+#define EE_FLUSH_DELAY_MS 1000  //!< Time without change before a modified item is written on EEPROM
+#define EE_MAX_UNIT 32          //!< Maximum number of items tracked by the background writer
+
+/**
+ * @brief Write one item of the RAM copy on EEPROM, with read back verification
+ *
+ * @param unit      Index of the item (0 to EE_MAX_UNIT - 1)
+ * @return uint8_t  NOERR or error of the write
+ */
+typedef uint8_t (*cfg_eeprom_store_t)(uint32_t unit);
 
 /** GPIO configuration */
 #define GPIO_CTRL_REG (IO_BANK0_BASE + 0x04)  ///< Add (pin * 8)
@@ -96,14 +119,22 @@
  */
 #define min(a, b) ((a) < (b) ? (a) : (b))
 
-uint8_t dac_set(float value, bool save);
+void setup_ADC(bool enable);
+uint8_t dac_set_q(q16_t value, bool save);
+uint16_t dac_volt_to_code(q16_t value);
+q16_t adc_raw_to_q16(uint8_t channel, uint16_t raw);
+q16_t read_master_adc_q(uint8_t channel);
 float read_master_adc(uint8_t channel);
-float read_power(uint8_t mode);
-void calibrate_power(float actual, float expected);
-uint8_t cfg_eeprom_rw(char mode, uint32_t eeaddr, uint8_t eedatalen, char* data, uint8_t datalen);
+q16_t read_power_q(uint8_t mode, bool* over);
+void calibrate_power_q(q16_t actual, q16_t expected);
+void analog_bench(analog_bench_t* res);
 void scan_i2c_bus(i2c_inst_t* i2c);
-uint8_t cfg_eeprom_read_full();
-uint8_t cfg_eeprom_write_default();
+void cfg_eeprom_attach(cfg_eeprom_store_t store);
+void cfg_eeprom_touch(uint32_t unit);
+void cfg_eeprom_touch_all(uint32_t nb);
+uint8_t cfg_eeprom_flush(bool all);
+void cfg_eeprom_event(void);
+uint32_t cfg_eeprom_dirty(void);
 uint8_t stringtonumber(const char* str, size_t lgs, long* result);
 bool Boot_check(void);
 bool IOBoard_Selftest();
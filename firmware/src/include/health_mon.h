@@ -0,0 +1,72 @@
+/**
+ * @file    health_mon.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the VSYS and temperature monitor.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _HEALTH_MON_H_
+#define _HEALTH_MON_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/fixq.h"
+
+/**
+ * @brief Sampling period of the health monitor.
+ *
+ * A timer takes the last VSYS and temperature samples of the free running ADC acquisition,
+ * the Questionable register is updated by the main loop.
+ */
+#define HEALTH_MON_DEF_PERIOD_MS 500    //!< Default sampling period in ms
+#define HEALTH_MON_MIN_PERIOD_MS 10     //!< Minimum sampling period in ms
+#define HEALTH_MON_MAX_PERIOD_MS 60000  //!< Maximum sampling period in ms
+
+/**
+ * @brief Hysteresis of the limits, the fault is cleared when the value is back inside the limit
+ *        minus the hysteresis.
+ */
+#define HEALTH_VSYS_HYST Q16(0.1)  //!< Hysteresis of VSYS limits in V
+#define HEALTH_TEMP_HYST Q16(3)    //!< Hysteresis of temperature limit in Celsius
+
+/**
+ * @brief Statistic of the health monitor since the last clear.
+ */
+typedef struct
+{
+  uint32_t count;    //!< Number of samples
+  uint32_t skip;     //!< Samples not taken, ADC not in free running acquisition
+  q16_t vsys;        //!< Last VSYS in V
+  q16_t vsys_min;    //!< Minimum VSYS in V
+  q16_t vsys_max;    //!< Maximum VSYS in V
+  q16_t temp;        //!< Last temperature in Celsius
+  q16_t temp_min;    //!< Minimum temperature in Celsius
+  q16_t temp_max;    //!< Maximum temperature in Celsius
+  bool vsys_fault;   //!< VSYS out of limits
+  bool temp_fault;   //!< Temperature too high
+} health_stat_t;
+
+bool health_mon_start(uint32_t period_ms);
+void health_mon_stop(void);
+uint32_t health_mon_period(void);
+void health_mon_clear(void);
+void health_mon_get(health_stat_t* st);
+void health_mon_event(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _HEALTH_MON_H_
@@ -36,6 +36,31 @@ extern "C"
 #define I2C_BAUDRATE 100000   /**< I2C baud rate (100 kHz). */
 #define I2C_MASTER_SDA_PIN 20 /**< GPIO used for I2C SDA. */
 #define I2C_MASTER_SCL_PIN 21 /**< GPIO used for I2C SCL. */
+#define I2C_MAX_RETRY 2       /**< Number of retry after a failed transfer on internal I2C. */
+#define I2C_FAST_BAUDRATE 400000 /**< I2C fast mode baud rate (400 kHz). */
+#define I2C_FMPLUS_BAUDRATE 1000000 /**< I2C fast mode plus baud rate (1 MHz). */
+#define I2C_CAPS_SIGN 0xC0       /**< Signature on the high nibble of the slave capability answer. */
+#define I2C_CAPS_FMPLUS 0x01     /**< Capability bit: slave support fast mode plus. */
+#define I2C_SPEED_PROBE 3        /**< Number of probe read to validate the speed of a device. */
+
+/**
+ * @def I2C_SPEED_PROFILE
+ * @brief Maximum speed supported by each device of the internal I2C {address, baudrate, capability}.
+ *
+ * If capability is 1, the device is a Pico slave and fast mode plus is used only if the slave
+ * report it on the capability register (SL_I2C_CAPS), fast mode otherwise.
+ * The speed is validated at boot, a device who fail is moved to a lower speed.
+ * The MCP4725 high speed mode (3.4 MHz) need a master code not supported by the RP2040 controller.
+ */
+#define I2C_SPEED_PROFILE                              \
+  {                                                    \
+    {I2C_ADDRESS_AT24CX, I2C_FAST_BAUDRATE, 0},        \
+    {PICO_PORT_ADDRESS, I2C_FMPLUS_BAUDRATE, 1},       \
+    {PICO_RELAY1_ADDRESS, I2C_FMPLUS_BAUDRATE, 1},     \
+    {PICO_RELAY2_ADDRESS, I2C_FMPLUS_BAUDRATE, 1},     \
+    {INA219_ADDRESS, I2C_FAST_BAUDRATE, 0},            \
+    {MCP4725_ADDR0, I2C_FAST_BAUDRATE, 0},             \
+  }
 
 /**
  * @brief GPIO configuration for relay actuation and digital ports.
@@ -93,6 +118,7 @@ extern "C"
 #define GP_PAD_READ 65       //!< Command to read GPIO pad configuration
 #define GP_FUNCTION 75       //!< Command to set or get GPIO function
 #define SL_DEV_STATUS 100    //!< Command to get the status of the slave device
+#define SL_I2C_CAPS 120      //!< Command to get the I2C capability of the slave (I2C_CAPS_SIGN | flags)
 #define ENABLE_UART 101      //!< Command to enable UART communication
 #define DISABLE_UART 102     //!< Command to disable UART communication
 #define SET_UART_PROT 103    //!< Command to set UART protocol configuration
@@ -105,9 +131,13 @@ extern "C"
 
   void setup_master();
   bool send_master(i2c_inst_t* i2c, uint8_t i2c_add, uint8_t cmd, uint16_t wdata, uint16_t* rback);
+  bool send_master_post(i2c_inst_t* i2c, uint8_t i2c_add, uint8_t cmd, uint16_t wdata, uint16_t* rback);
+  void i2c_com_event(void);
   bool relay_execute(uint16_t* list, uint8_t action, uint16_t* answer);
   bool digital_execute(uint8_t action, uint8_t port, uint8_t bit, uint8_t value, uint16_t* answer);
   bool gpio_execute(uint8_t action, uint8_t device, uint8_t gpio, uint8_t value, uint16_t* answer);
   bool system_execute(uint8_t action, uint16_t* answer);
+  bool i2c_speed_negotiate(void);
+  void i2c_speed_list(char* str, size_t size);
 
 #endif  //
\ No newline at end of file
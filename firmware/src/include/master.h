@@ -59,119 +59,6 @@ extern "C"
 #undef PICO_DEFAULT_UART_BAUD_RATE
 #define PICO_DEFAULT_UART_BAUD_RATE 115200 /**< Default baud rate for UART on PICO. */
 
-/**
- * @brief EEPROM parameters supported by SCPI commands.
- *
- * These parameters can be accessed and modified via SCPI commands.
- */
-#define CHECK "CHECK"                 /**< EEPROM Check character. */
-#define PARTNUMBER "PARTNUMBER"       /**< EEPROM Part number. */
-#define SERIALNUMBER "SERIALNUMBER"   /**< EEPROM Serial number. */
-#define MOD_OPTION "MOD_OPTION"       /**< EEPROM Module options. */
-#define COM_SER_SPEED "COM_SER_SPEED" /**< EEPROM Communication serial speed. */
-#define COM_SER_ECHO "COM_SER_ECHO"   /**< EEPROM Serial Echo Flag. */
-#define PSLAVE_RUN "PICO_SLAVES_RUN"  /**< EEPROM Pico slaves run status. */
-#define TESTBOARD_NUM "TESTBOARD_NUM" /**< EEPROM Test board part number. */
-#define PARAMETER1 "PARAMETER1"       /**< EEPROM user defined field. */
-#define PARAMETER2 "PARAMETER2"        /**< EEPROM user defined field. */
-#define PARAMETER3 "PARAMETER3"       /**< EEPROM user defined field. */
-#define PARAMETER4 "PARAMETER4"       /**< EEPROM user defined field. */
-#define PARAMETER5 "PARAMETER5"       /**< EEPROM user defined field. */
-#define TEST "TEST"                   /**< EEPROM test field. */
-
-  /**
-   * @brief EEPROM configuration structure.
-   *
-   * This structure contains the default values and settings that are stored in EEPROM.
-   * New parameters should be added with proper size allocation, and always include
-   * a null terminator (`+1`) for strings.
-   */
-  typedef struct eecfg_t
-  {
-    char check[1];           /**< Proof character to validate EEPROM read. */
-    char partnumber[13];     /**< Part number stored in EEPROM. */
-    char serialnumber[6];    /**< Serial number stored in EEPROM. */
-    char mod_option[15];     /**< Module options stored in EEPROM. */
-    char com_ser_speed[7];   /**< Communication serial speed. */
-    char com_ser_echo[2];    /**< Serial echo flag for SCPI port. */
-    char slave_force_run[2]; /**< Force master RUN_EN = 1, useful for debugging slave Pico devices. */
-    char testboard_num[13];  /**< Part number of the self-test board. */
-    char parameter1[15];     /**< not defined parameter. */
-    char parameter2[15];     /**< not defined parameter. */
-    char parameter3[15];     /**< not defined parameter. */
-    char parameter4[15];     /**< not defined parameter. */
-    char parameter5[15];     /**< not defined parameter. */
-    char test[10];            /**< reserved to test eeprom */
-  
-  } cfg;
-
-  /**
-   * @brief Union that combines the EEPROM configuration structure with a raw data array.
-   */
-  typedef union eef
-  {
-    struct eecfg_t cfg;     /**< EEPROM configuration structure. */
-    char data[sizeof(cfg)]; /**< Raw data representation of the configuration. */
-  } eep;                    /**< Instance of the eef union used for EEPROM operations. */
-
-  /**
-   * @var ee
-   * @brief Instance of the EEPROM configuration union.
-   *
-   * This is a global instance of the `eep` union, providing access to the EEPROM configuration.
-   * It can be used to read or write EEPROM data either by individual fields (via `cfg`) or as
-   * a raw byte array (via `data[]`).
-   */
-  extern eep ee; /**< External declaration of EEPROM union for global use. */
-
-/**
- * @brief Default value for EEPROM structure.
- *
- * This section defines the default values assigned to the EEPROM structure. Each parameter has a specific role in the system configuration.
- */
-#define EE_CHECK_CHAR '#'               /**< EEPROM check character */
-#define EE_PARTNUMBER "500-1000-010"    /**< Part number of the device */
-#define EE_SERIALNUMBER "00001"         /**< Serial number of the device */
-#define EE_MOD_OPTION "DAC,PWR"         /**< Module options (e.g., DAC, Power) */
-#define EE_CSER_SPEED "115200"          /**< Communication serial speed (e.g., baud rate) */
-#define EE_CSER_ECHO "0"                /**< Communication flag, Echo ON: 1,  Echo OFF: 0 */
-#define EE_SLAVE_RUN "0"                /**< Slave run status (0 = Disable, 1 = Enable) */
-#define EE_TESTBOARD_NUM "500-1010-020" /**< Part number of the self-test board */
-#define EE_PARAMETER1 "NOT_DEFINED1"     /**< User available parameter */
-#define EE_PARAMETER2 "NOT_DEFINED2"     /**< User available parameter */
-#define EE_PARAMETER3 "NOT_DEFINED3"     /**< User available parameter */
-#define EE_PARAMETER4 "NOT_DEFINED4"     /**< User available parameter */
-#define EE_PARAMETER5 "NOT_DEFINED5"     /**< User available parameter */
-#define EE_TEST       "TEST"            /**< User to test read write of EEprom */
-
-
-/**
- * @brief Default values for the EEPROM structure.
- *
- * This macro assigns default values to the EEPROM structure.
- * New parameters can be added at the end of the list as needed.
- */
-#define DEF_EEPROM                                                              \
-{                                                                               \
-    EE_CHECK_CHAR,       /**< EEPROM Check Character */                         \
-    EE_PARTNUMBER,       /**< EEPROM Part Number */                             \
-    EE_SERIALNUMBER,     /**< EEPROM Serial Number */                           \
-    EE_MOD_OPTION,       /**< Module Option */                                  \
-    EE_CSER_SPEED,       /**< Communication Serial Speed */                     \
-    EE_CSER_ECHO,        /**< Communication serial echo as integer */           \
-    EE_SLAVE_RUN,        /**< Slave Run Flag */                                 \
-    EE_TESTBOARD_NUM,     /**< Test Board Number */                             \
-    EE_PARAMETER1,        /**< not defined paramater*/                          \
-    EE_PARAMETER2,        /**< not defined paramater*/                          \
-    EE_PARAMETER3,        /**< not defined paramater*/                          \
-    EE_PARAMETER4,        /**< not defined paramater*/                          \
-    EE_PARAMETER5,        /**< not defined paramater*/                          \
-    EE_TEST               /**< used to test eeprom r/w*/                        \
-                                                                                \
-}
-
-  //!< Add parameter on struct ParamInfo  file fts_scpi.c  around line 990
-
 #define BEEP_I2C_FAIL 3   //!< Define burst of Beep
 #define BEEP_EEP_FAIL 4   //!< Define burst of Beep
 #define BEEP_VSYS_OUT 2   //!< Define burst of Beep
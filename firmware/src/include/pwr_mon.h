@@ -0,0 +1,112 @@
+/**
+ * @file    pwr_mon.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the background power monitor.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _PWR_MON_H_
+#define _PWR_MON_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Sampling period of the power monitor.
+ *
+ * The INA219 shunt and bus registers are read by asynchronous I2C frames started by a timer.
+ */
+#define PWR_MON_DEF_PERIOD_MS 10     //!< Default sampling period in ms
+#define PWR_MON_MIN_PERIOD_MS 2      //!< Minimum period, time to convert shunt and bus at 12 bits
+#define PWR_MON_MAX_PERIOD_MS 10000  //!< Maximum sampling period in ms
+
+/**
+ * @brief Units used for energy and charge integration without loss.
+ *
+ * Power is integrated in nW x us and current in uA x us, the complete uWh and uAh
+ * are moved to the total, the remainder is kept for the next sample.
+ */
+#define PWR_MON_NWUS_PER_UWH 3600000000000LL  //!< nW x us on 1 uWh
+#define PWR_MON_UAUS_PER_UAH 3600000000LL     //!< uA x us on 1 uAh
+
+/**
+ * @brief Inrush current capture.
+ *
+ * Armed by command, executed after the close of a power relay. The INA219 is set
+ * to the fastest conversion (9 bits, 84 us) on shunt only and the shunt register is read
+ * at the conversion rate. The configuration and the monitor are restored after the capture.
+ */
+#define PWR_CAP_MAX_POINTS 2048      //!< Maximum number of points of a capture
+#define PWR_CAP_DEF_POINTS 1000      //!< Default number of points
+#define PWR_CAP_PERIOD_US 84         //!< Sampling period, conversion time of 9 bits shunt ADC
+#define PWR_CAP_SETTLE_PCT 10        //!< Current is settled inside +/- 10% of final value
+#define PWR_CAP_SETTLE_MIN_UA 5000   //!< Minimum settle band in uA (resolution of 9 bits conversion)
+
+/**
+ * @brief State of the inrush capture.
+ */
+#define PWR_CAP_IDLE 0   //!< No capture
+#define PWR_CAP_ARMED 1  //!< Capture executed on next power relay close
+#define PWR_CAP_DONE 2   //!< Capture completed, data available
+
+/**
+ * @brief Point of the inrush capture, sent as binary block (little endian, 6 bytes).
+ */
+typedef struct __attribute__((packed))
+{
+  uint32_t time_us;  //!< Time of the point since the start of capture in us
+  int16_t shunt;     //!< Raw shunt register, LSB = 10uV
+} pwr_cap_point_t;
+
+/**
+ * @brief Statistic of the power monitor since the last clear.
+ */
+typedef struct
+{
+  uint32_t count;       //!< Number of samples
+  uint32_t skip;        //!< Samples not taken, I2C bus used by another transfer
+  uint32_t error;       //!< Samples lost on I2C error
+  int32_t v_min;        //!< Minimum bus voltage in mV
+  int32_t v_max;        //!< Maximum bus voltage in mV
+  int64_t v_sum;        //!< Sum of bus voltage in mV
+  int32_t i_min;        //!< Minimum current in uA
+  int32_t i_max;        //!< Maximum current in uA
+  int64_t i_sum;        //!< Sum of current in uA
+  int32_t p_min;        //!< Minimum power in uW
+  int32_t p_max;        //!< Maximum power in uW
+  int64_t p_sum;        //!< Sum of power in uW
+  int64_t energy_uwh;   //!< Energy in uWh
+  int64_t energy_rem;   //!< Energy remainder in nW x us
+  int64_t charge_uah;   //!< Charge in uAh
+  int64_t charge_rem;   //!< Charge remainder in uA x us
+  uint64_t time_us;     //!< Integration time in us
+} pwr_stat_t;
+
+bool pwr_mon_start(uint32_t period_ms);
+void pwr_mon_stop(void);
+uint32_t pwr_mon_period(void);
+void pwr_mon_clear(void);
+void pwr_mon_get(pwr_stat_t* st);
+uint8_t pwr_cap_arm(uint32_t points);
+uint8_t pwr_cap_state(void);
+void pwr_cap_event(void);
+bool pwr_cap_result(float* peak_ma, float* settle_ms, uint32_t* points);
+const pwr_cap_point_t* pwr_cap_data(uint32_t* points);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _PWR_MON_H_
@@ -47,6 +47,27 @@ extern "C"
 #define DEF_TIMEOUT_MS 1000               //!< Default timeout duration in milliseconds
 #define DEF_LASTCHAR '\n'                 //!< Default last character for received strings
 
+/**
+ * @brief Receive ring and terminator of the user UART.
+ *
+ * The received characters are written by DMA on a ring, the transmit is done by DMA.
+ */
+#define USER_RX_RING_BITS 12                    //!< Size of the receive ring, power of 2 (4096 bytes)
+#define USER_RX_RING (1u << USER_RX_RING_BITS)  //!< Size of the receive ring in bytes
+#define USER_RX_DMA_COUNT (1u << 24)            //!< Transfer count of the receive DMA, reloaded by interrupt
+#define USER_TERM_MAX 8                         //!< Maximum number of terminator characters
+#define USER_CAP_SIZE (1u << 15)                //!< Size of the capture ring in bytes (power of 2)
+#define USER_CAP_DRAIN_MS 10                    //!< Period of the capture timer, receive ring hold 44 ms at 921600 baud
+
+/**
+ * @brief Limits of the expect engine.
+ */
+#define USER_EXP_MAX 8     //!< Maximum number of alternative patterns
+#define USER_EXP_LEN 32    //!< Maximum length of a pattern
+#define USER_EXP_TEXT 63   //!< Last characters received returned with the pattern found
+#define USER_EXP_STEPS 16  //!< Maximum number of steps (pattern and string to send) of a script
+#define USER_SEND_MAX 128  //!< Maximum length of a string to send on a script
+
 /**
  * @brief Error codes for UART communication.
  *
@@ -60,6 +81,9 @@ extern "C"
 #define UART_LASTCHAR_TIMEOUT_MS 35  //!< Error code indicating a timeout waiting for the last character
 #define UART_BUFFER_FULL 36          //!< Error code indicating the UART buffer is full
 #define UART_NOT_ENABLED 37          //!< Error code indicating that UART is not enabled
+#define UART_TX_TIMEOUT 38           //!< Error code indicating a timeout during TX (CTS not active)
+#define UART_TERM_NOTVALID 39        //!< Error code indicating an invalid terminator string
+#define UART_PATTERN_NOTVALID 40     //!< Error code indicating an invalid expect pattern or script string
 
   void scpi_uart_enable(void);
   void scpi_uart_disable(void);
@@ -74,6 +98,16 @@ extern "C"
   const char* scpi_uart_get_protocol(void);
   uint8_t scpi_uart_write_data(char* dwrt);
   uint8_t scpi_uart_write_read_data(char* strd, char* dpr, size_t rsize);  // write data, expect answer
+  uint8_t scpi_uart_set_terminator(const char* str);
+  const char* scpi_uart_get_terminator(void);
+  uint8_t scpi_uart_capture(bool on);
+  bool scpi_uart_capture_state(void);
+  uint32_t scpi_uart_capture_count(void);
+  uint32_t scpi_uart_capture_data(const uint8_t** p1, size_t* n1, const uint8_t** p2, size_t* n2);
+  void scpi_uart_event(void);
+  uint8_t scpi_uart_expect(const char* patterns, uint32_t timeout_ms, uint8_t* match, char* text, size_t size);
+  uint8_t scpi_uart_expect_script(const char* const steps[], size_t nsteps, uint32_t timeout_ms, uint8_t* done,
+                                  uint8_t* match, char* text, size_t size);
 
 #ifdef __cplusplus
 }
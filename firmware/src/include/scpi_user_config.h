@@ -63,7 +63,7 @@ extern "C" {
     X(UART_LETTER_ERROR,        -379,  "Uart protocol letter is invalid, check letter used to define parity (expected: O,N,E)") \
     X(UART_PROTOCOL_ERROR,      -380,  "Uart protocol value is invalid, expect 3 characters on any orders ex: 8N1,7O1") \
     X(UART_RX_ERROR,            -381,  "Uart serial communication error, Timeout occur on waiting to receive char") \
-    X(UART_LASTCHAR_ERROR,      -382,  "Uart Timeout occur on waiting to receive last character of string (last char is the same of Tx)") \
+    X(UART_LASTCHAR_ERROR,      -382,  "Uart Timeout occur on waiting to receive last character of string (terminator, or last char of Tx if not set)") \
     X(UART_RXBUFFER_ERROR,      -383,  "Uart Receiver buffer overrun. String received too long") \
     X(UART_ENABLE_ERROR,        -384,  "Uart Serial communication not enabled, send command to enable SERIAL" ) \
     X(SPI_MODE_ERROR,           -385,  "SPI mode number is invalid, expect Mode value between 0 and 7") \
@@ -78,6 +78,9 @@ extern "C" {
     X(I2C_DATA_NACK_ERROR,      -394,  "I2C No acknowledgment after sending data.(Data NACK)" ) \
     X(I2C_BUS_ERROR,            -395,  "An error occurred on the I2C bus.(Bus Error)" ) \
     X(I2C_ENABLE_ERROR,         -396,  "I2C master not enabled, send command to enable I2C" ) \
+    X(UART_TX_ERROR,            -397,  "Uart Timeout occur on transmit, check CTS signal if handshake is enabled" ) \
+    X(UART_TERM_ERROR,          -398,  "Uart terminator is invalid, expect up to 8 characters (escape: \\r \\n \\t \\\\ \\xHH)" ) \
+    X(UART_PATTERN_ERROR,       -399,  "Uart expect pattern or script string is invalid (empty, too long or bad escape sequence)" ) \
 
 
 // Definition of each bit of the Operation Condition Event Register (QER) 
@@ -0,0 +1,68 @@
+/**
+ * @file    sweep.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the DAC sweep (curve tracer).
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _SWEEP_H_
+#define _SWEEP_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "include/fixq.h"
+
+/**
+ * @brief Sweep settings.
+ *
+ * The DAC is stepped from start to stop voltage, ADC0 and ADC1 (and optionally the INA219
+ * current) are measured after the dwell time of each step.
+ */
+#define SWEEP_MAX_POINTS 1024         //!< Maximum number of steps
+#define SWEEP_MIN_POINTS 2            //!< Minimum number of steps
+#define SWEEP_DEF_POINTS 256          //!< Default number of steps
+#define SWEEP_MAX_DWELL_US 1000000    //!< Maximum dwell time in us
+#define SWEEP_DEF_DWELL_US 1000       //!< Default dwell time in us
+#define SWEEP_DEF_START Q16(0)        //!< Default start voltage
+#define SWEEP_DEF_STOP Q16(3.0)       //!< Default stop voltage
+
+/**
+ * @brief Point of the sweep, sent as binary block (little endian, 10 bytes).
+ */
+typedef struct __attribute__((packed))
+{
+  uint16_t dac;        //!< DAC code (12 bits)
+  uint16_t adc0;       //!< Raw ADC0 (12 bits)
+  uint16_t adc1;       //!< Raw ADC1 (12 bits)
+  int32_t current_ua;  //!< INA219 current in uA, 0 if the current is not measured
+} sweep_point_t;
+
+uint8_t sweep_set_start(q16_t volt);
+q16_t sweep_get_start(void);
+uint8_t sweep_set_stop(q16_t volt);
+q16_t sweep_get_stop(void);
+uint8_t sweep_set_points(uint32_t points);
+uint32_t sweep_get_points(void);
+uint8_t sweep_set_dwell(uint32_t dwell_us);
+uint32_t sweep_get_dwell(void);
+void sweep_set_current(bool enable);
+bool sweep_get_current(void);
+uint8_t sweep_run(const sweep_point_t** data, uint32_t* points);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _SWEEP_H_
@@ -0,0 +1,70 @@
+/**
+ * @file    wave_gen.h
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Header file defining constants and macros for the DAC waveform generator.
+ *
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _WAVE_GEN_H_
+#define _WAVE_GEN_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "include/fixq.h"
+
+/**
+ * @brief Sampling of the waveform.
+ *
+ * A timer writes one sample every period with a 2 bytes fast mode frame of the MCP4725.
+ * The sample is skipped if the internal I2C bus is used by another transfer, the phase
+ * continues with the time.
+ */
+#define WAVE_SAMPLE_US 100                     //!< Sampling period in us
+#define WAVE_RATE (1000000 / WAVE_SAMPLE_US)   //!< Sample rate in sample/s
+#define WAVE_STD_POINTS 256                    //!< Points of SIN and RAMP table
+#define WAVE_MAX_POINTS 1024                   //!< Maximum number of points of arbitrary waveform
+#define WAVE_MIN_FREQ Q16(0.01)                //!< Minimum frequency in Hz
+#define WAVE_MAX_FREQ Q16(1000)                //!< Maximum frequency in Hz (10 samples per period)
+#define WAVE_DEF_FREQ Q16(100)                 //!< Default frequency in Hz
+#define WAVE_DEF_AMPL Q16(1.0)                 //!< Default amplitude in Vpp
+#define WAVE_DEF_OFFSET Q16(1.5)               //!< Default offset in V
+
+/**
+ * @brief Waveform function.
+ */
+#define WAVE_OFF 0     //!< Generator stopped, DAC is static
+#define WAVE_SIN 1     //!< Sine
+#define WAVE_RAMP 2    //!< Ramp from low to high level
+#define WAVE_SQUARE 3  //!< Square, duty cycle 50%
+#define WAVE_ARB 4     //!< Arbitrary, DAC codes loaded by command
+
+uint8_t wave_set_func(uint8_t func);
+uint8_t wave_get_func(void);
+uint8_t wave_set_freq(q16_t freq);
+q16_t wave_get_freq(void);
+uint8_t wave_set_ampl(q16_t ampl);
+q16_t wave_get_ampl(void);
+uint8_t wave_set_offset(q16_t offset);
+q16_t wave_get_offset(void);
+uint8_t wave_arb_load(const uint8_t* data, size_t len, bool append);
+uint32_t wave_arb_points(void);
+void wave_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _WAVE_GEN_H_
@@ -29,6 +29,13 @@
 #include "include/functadv.h"
 #include "include/i2c_com.h"
 #include "include/test.h"
+#include "include/adc_acq.h"
+#include "include/pwr_mon.h"
+#include "include/health_mon.h"
+#include "include/adc_cal.h"
+#include "include/ee_log.h"
+#include "include/cfg_param.h"
+#include "include/scpi_uart.h"
 #include "lib/scpi-parser/libscpi/src/error.c"  // added to force X-macro to add on list the case (scpi_user.config.h)
 #include "pico/binary_info.h"
 #include "pico/stdlib.h"
@@ -37,6 +44,7 @@
 #include "pico_lib2/src/dev/dev_ina219/dev_ina219.h"
 #include "pico_lib2/src/dev/dev_mcp4725/dev_mcp4725.h"
 #include "pico_lib2/src/sys/include/sys_adc.h"
+#include "pico_lib2/src/sys/include/sys_i2c_async.h"
 #include "userconfig.h"  // contains Major and Minor version
 
 // Major an Minor version are located on Cmakelist.txt with command
@@ -179,8 +187,6 @@ static struct
   bool echo;   ///< Flag to enable or disable echoing of received characters.
 } rxser;       ///< Global instance for handling received serial data
 
-eep ee;  ///< Global variable representing the EEPROM data
-
 /**
  * @brief RX Main communication interrupt handler
  *
@@ -231,21 +237,9 @@ int init_main_com()
 {
   // Communication UART initialization. The UART is used to receive SCPI
   // command Set up our UART with a basic baud rate.
-  long numval,echoval;
-
-  uint8_t valid;
-
-  valid = stringtonumber(ee.cfg.com_ser_speed, sizeof(ee.cfg.com_ser_speed),&numval);  // read communication speed on EEprom
-  if (valid != 0)
-  {
-    numval = 115200;
-  }  // if value is not valid use default speed
-
-  valid = stringtonumber(ee.cfg.com_ser_echo, sizeof(ee.cfg.com_ser_echo),&echoval);  // read communication echo flag on EEprom
-  if (valid == 0) {  // if parameter read correctly
-    rxser.echo = (echoval == 1) ? true : false;   // set echo flag
-  }
+  uint32_t numval = cfg_val.com_ser_speed;  // communication speed, default value if eeprom not valid
 
+  rxser.echo = cfg_val.com_ser_echo;  // set echo flag
 
   uart_init(UART_ID, numval);
 
@@ -326,21 +320,32 @@ void Hardware_Default_Setting()
   gpio_set_dir(ADC3, GPIO_IN);  // set has input
   gpio_disable_pulls(ADC3);     // remove pullup and down for accurate reading of VSYS
 
+  adc_acq_start();  // free running acquisition of ADC0, ADC1, VSYS and temperature
+
   gpio_put(GPIO_LED, 0);  // Turn OFF led Error
 
   valid = Boot_check();  // basic check of internal I2C  and power
+  pwr_mon_start(PWR_MON_DEF_PERIOD_MS);  // background sampling of INA219
   RegBitHdwrErr(BOOT_I2C,
                 valid);  // Set or clear Questionable register based on results
 
   if (valid == true)
   {  // if no error on boot Check, validate eeprom
     // Read EEprom  configuration
-   //  cfg_eeprom_write_default();  // if new parameter added, write on
-    // eeprom
-    int result = cfg_eeprom_read_full();  // read configuration eeprom
+    int result = ee_log_init();  // parameter store, index built from one read of the active bank
+    if (result == NOERR)
+    {
+      uint32_t boots = 0;
+      uint8_t len;
+      ee_log_get(EE_KEY_BOOT_COUNT, &boots, sizeof(boots), &len);
+      boots++;
+      ee_log_put(EE_KEY_BOOT_COUNT, &boots, sizeof(boots));  // boot counter
+      result = cfg_param_load();  // read configuration, converted if written by a previous schema
+    }
     status = (result == 0) ? TRUE : FALSE;
     RegBitHdwrErr(EEPROM_ERROR,
                   status);  // Set or clear Questionable register based on results
+    adc_cal_load();  // ADC calibration, nominal values if no record
   }
 
   // Check master VSYS voltage. Raise error if value is too high or too low
@@ -353,6 +358,8 @@ void Hardware_Default_Setting()
   status = (value > MAX_PICO_TEMP) ? FALSE : TRUE;
   RegBitHdwrErr(MTEMP_HIGH, status);  // Set or clear Questionable register based on results
 
+  health_mon_start(HEALTH_MON_DEF_PERIOD_MS);  // VSYS and temperature checked in background
+
   // RUN_EN setup
   // We setup the output before the direction for being sure of the RUN_EN= 1
   // when we change the pin from input to output. Run_EN =0 disconnect the USB
@@ -361,13 +368,9 @@ void Hardware_Default_Setting()
   gpio_put(GPIO_RUN, 1);             // Set RUN_EN =1, pico slaves are actives
   gpio_set_dir(GPIO_RUN, GPIO_OUT);  // Set pin at output
 
-  long v_num;
-
-  valid = stringtonumber(ee.cfg.slave_force_run, sizeof(ee.cfg.slave_force_run),
-                         &v_num);  // read if toggle RUN_EN is enabled
-  if (valid == 0)
-  {  // if value is valid
-    if (v_num == 0)
+  if (cfg_param_state() == NOERR)
+  {  // if configuration is valid
+    if (!cfg_val.slave_force_run)
     {                         // if permit, toggle RUN_EN to Reset the PIco Slaves
       gpio_put(GPIO_RUN, 0);  // Reset PICO Slave
       fprintf(stdout, "PICO Slave in Reset\r\n");
@@ -398,8 +401,7 @@ int main(void)
   uint16_t pulse;  // limit for flashing led frequency
   bool valid;
 
-  eep eed = DEF_EEPROM;  // Assign default value to structure eeprom
-  pulse = 200;           // slow led flashing frequency
+  pulse = 200;  // slow led flashing frequency
 
  
 
@@ -443,9 +445,25 @@ int main(void)
   {  // infinite loop, waiting for SCPI command from serial port
 
     watchdog_update(); /** refresh watchdog */
-    sleep_ms(10);
-    ctr++; /** counter for the heartbeat led */
-    mess++;
+
+    // wait 10 ms, wake up before if a SCPI command is received by interrupt
+    absolute_time_t tick = make_timeout_time_ms(10);
+    while (queue.current_load == 0 && !best_effort_wfe_or_timeout(tick))
+    {
+      tight_loop_contents();
+    }
+    if (time_reached(tick))
+    {
+      ctr++; /** counter for the heartbeat led */
+      mess++;
+    }
+
+    health_mon_event();  // Questionable register updated if VSYS or temperature fault changed
+    cfg_eeprom_event();  // modified configuration written on eeprom in background
+    ee_log_event();      // compaction of the parameter store in background
+    scpi_uart_event();   // user serial characters received copied on the capture ring
+    sys_i2c_async_event(i2c0);  // deadline of frames started by timer, bus recovery out of interrupt
+    i2c_com_event();     // error of a posted relay command pushed on the SCPI error queue
 
  
     /** Flashing led */
@@ -473,7 +491,6 @@ int main(void)
 
       fprintf(stdout, "SCPI Command: %s \r\n",&rec.data[0]);  // send message to debug port
       result = SCPI_Input(&scpi_context, &rec.data[0],nb_char);  // send command to SCPI parser
-      sleep_ms(50);
       gpio_put(PICO_DEFAULT_LED_PIN, 1);  // Turn ON board led
     }
   }
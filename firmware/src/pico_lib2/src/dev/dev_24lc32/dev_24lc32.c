@@ -29,8 +29,17 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * Modified by dlock8, 2024:
+ * - End of write cycle detected by acknowledge polling instead of a fixed delay
+ * - Write of a buffer split on page boundaries, one transfer by page
+ * - Sequential read of a buffer in one transfer
+ * - Current address read return an at24cx_err_t instead of the number of bytes read
+ */
+
 #include "dev_24lc32.h"
 #include "stdio.h"
+#include <string.h>
 
 void at24cx_i2c_device_register(at24cx_dev_t* dev, uint16_t _dev_chip, uint8_t _i2c_addres)
 {
@@ -74,6 +83,19 @@ static at24cx_err_t at24cx_i2c_error_check(at24cx_dev_t* dev, at24cx_writedata_t
     return AT24CX_OK;
 }
 
+at24cx_err_t at24cx_i2c_wait_ready(at24cx_dev_t dev)
+{
+  uint32_t t0 = time_us_32();
+
+  // device does not acknowledge its address until the internal write cycle is completed
+  while (!sys_i2c_probe(i2c0, dev.i2c_addres))
+  {
+    if (time_us_32() - t0 > AT24CX_WRITE_CYCLE_TIMEOUT_US) return AT24CX_ERR;
+    sleep_us(AT24CX_POLL_INTERVAL_US);
+  }
+  return AT24CX_OK;
+}
+
 at24cx_err_t at24cx_i2c_byte_write(at24cx_dev_t dev, at24cx_writedata_t dt)
 {
   at24cx_err_t err;
@@ -90,8 +112,7 @@ at24cx_err_t at24cx_i2c_byte_write(at24cx_dev_t dev, at24cx_writedata_t dt)
 
   if (sys_i2c_wbuf(i2c0, dev.i2c_addres, data, sizeof(data)) == sizeof(data))
   {
-    sleep_ms(AT24CX_WRITE_CYCLE_DELAY);
-    return AT24CX_OK;
+    return at24cx_i2c_wait_ready(dev);
   }
 
   return err;
@@ -111,19 +132,61 @@ at24cx_err_t at24cx_i2c_page_write(at24cx_dev_t dev, at24cx_writedata_t dt)
 
   if (((dt.address + dev.page_write_size - 1) > dev.byte_size) || (dt.address) % dev.page_write_size)
   {
-    sleep_ms(AT24CX_WRITE_CYCLE_DELAY);
     return AT24CX_INVALID_PAGEWRITE_ADDRESS;
   }
 
   if (sys_i2c_wbuf(i2c0, dev.i2c_addres, data, dev.page_write_size + 2) == (dev.page_write_size + 2))
   {
-    sleep_ms(AT24CX_WRITE_CYCLE_DELAY);
-    return AT24CX_OK;
+    return at24cx_i2c_wait_ready(dev);
   }
 
   return err;
 }
 
+at24cx_err_t at24cx_i2c_write(at24cx_dev_t dev, uint16_t address, const uint8_t* data, uint32_t len)
+{
+  uint8_t buf[AT24CX_MAX_PAGE_SIZE + 2];
+  uint32_t chunk;
+  at24cx_err_t err;
+
+  if (!dev.status) return AT24CX_NOT_DETECTED;
+  if (len == 0 || (address + len - 1) > dev.byte_size) return AT24CX_INVALID_ADDRESS;
+
+  while (len)
+  {
+    // stop on page boundary, the address counter of the device roll over inside the page
+    chunk = dev.page_write_size - (address % dev.page_write_size);
+    if (chunk > len) chunk = len;
+
+    buf[0] = address >> 8;
+    buf[1] = address & 0xFF;
+    memcpy(&buf[2], data, chunk);
+    if (sys_i2c_wbuf(i2c0, dev.i2c_addres, buf, chunk + 2) != (int32_t)(chunk + 2)) return AT24CX_ERR;
+
+    err = at24cx_i2c_wait_ready(dev);
+    if (err != AT24CX_OK) return err;
+
+    address += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+  return AT24CX_OK;
+}
+
+at24cx_err_t at24cx_i2c_sequential_read(at24cx_dev_t dev, uint16_t address, uint8_t* data, uint32_t len)
+{
+  uint8_t reg[2];
+
+  if (!dev.status) return AT24CX_NOT_DETECTED;
+  if (len == 0 || (address + len - 1) > dev.byte_size) return AT24CX_INVALID_ADDRESS;
+
+  reg[0] = address >> 8;
+  reg[1] = address & 0xFF;
+  if (sys_i2c_rbyte_eeprom(i2c0, dev.i2c_addres, reg, data, len) != (int32_t)len) return AT24CX_ERR;
+
+  return AT24CX_OK;
+}
+
 at24cx_err_t at24cx_i2c_byte_read(at24cx_dev_t dev, at24cx_writedata_t* dt)
 {
   at24cx_err_t err;
@@ -144,15 +207,15 @@ at24cx_err_t at24cx_i2c_byte_read(at24cx_dev_t dev, at24cx_writedata_t* dt)
   return err;
 }
 
-// Not working properly, return strange data.
-// Need to debug but i have no use to it
 at24cx_err_t at24cx_i2c_current_address_read(at24cx_dev_t dev, at24cx_writedata_t* dt)
 {
-  at24cx_err_t err;
   uint8_t data;
 
-  err = sys_i2c_rbyte(i2c0, dev.i2c_addres, &data);
-  dt->data = data;
+  if (!dev.status) return AT24CX_NOT_DETECTED;
 
-  return err;
+  // address counter is the last address accessed + 1, moved by any read including the probe of the register
+  if (sys_i2c_rbyte(i2c0, dev.i2c_addres, &data) != 1) return AT24CX_ERR;
+
+  dt->data = data;
+  return AT24CX_OK;
 }
@@ -87,6 +87,24 @@ typedef struct {
  */
 #define AT24CX_WRITE_CYCLE_DELAY    5
 
+/**
+ * @brief AT24CX write cycle timeout.
+ * @details Maximum time of acknowledge polling after a write, in us.
+ */
+#define AT24CX_WRITE_CYCLE_TIMEOUT_US    10000
+
+/**
+ * @brief AT24CX acknowledge polling interval.
+ * @details Time between two address probes during the write cycle, in us.
+ */
+#define AT24CX_POLL_INTERVAL_US    100
+
+/**
+ * @brief AT24CX largest page.
+ * @details Page write size of the AT24C512.
+ */
+#define AT24CX_MAX_PAGE_SIZE    128
+
 /**
  * @brief Register device.
  * @details Register device based on specification.
@@ -105,6 +123,26 @@ at24cx_err_t at24cx_i2c_byte_write(at24cx_dev_t dev, at24cx_writedata_t dt);
 */
 at24cx_err_t at24cx_i2c_page_write(at24cx_dev_t dev, at24cx_writedata_t dt);
 
+/**
+ * @brief Write buffer to device.
+ * @details Write len bytes to AT24CX from any address, split in page writes.
+ * The end of each write cycle is detected by acknowledge polling.
+*/
+at24cx_err_t at24cx_i2c_write(at24cx_dev_t dev, uint16_t address, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Wait end of write cycle.
+ * @details Poll the AT24CX address until acknowledge or AT24CX_WRITE_CYCLE_TIMEOUT_US.
+*/
+at24cx_err_t at24cx_i2c_wait_ready(at24cx_dev_t dev);
+
+/**
+ * @brief Read buffer from device.
+ * @details Sequential read of len bytes from AT24CX in one transfer, any length up to the
+ * end of memory. Only the first address is sent.
+*/
+at24cx_err_t at24cx_i2c_sequential_read(at24cx_dev_t dev, uint16_t address, uint8_t *data, uint32_t len);
+
 /**
  * @brief Read word from device.
  * @details Read word from AT24CX.
@@ -113,7 +151,8 @@ at24cx_err_t at24cx_i2c_byte_read(at24cx_dev_t dev, at24cx_writedata_t *dt);
 
 /**
  * @brief Read from device.
- * @details Read word from current address of AT24CX.
+ * @details Read word from current address of AT24CX. The address counter is the last
+ * address accessed + 1 (roll over at end of memory), the probe of the register move the counter.
 */
 at24cx_err_t at24cx_i2c_current_address_read(at24cx_dev_t dev, at24cx_writedata_t *dt);
 
@@ -8,6 +8,8 @@
  *
  * @details OneWire driver to read / write on the EEprom of the Onewire Device. Plan to be used
  *          to detect what's is connected to Interconnect IO Board before turning the main power.
+ *          The bus is driven by a PIO state machine (dev_ds2431.pio), bytes are transferred by DMA
+ *          and the overdrive speed is used when all devices answer at this speed.
  *
  *
  * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
@@ -20,12 +22,17 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <time.h>
 #include <ctype.h>
 #include "pico/stdlib.h"
 #include "pico/binary_info.h"
 #include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
 #include "dev_ds2431.h"
+#include "dev_ds2431.pio.h"
 
 /**
  * @brief List of OneWire chip models.
@@ -53,38 +60,228 @@ int LastFamilyDiscrepancy; /**< Last discrepancy for the family code during the
 bool LastDeviceFlag;       /**< Flag indicating if the last device has been found in the search. */
 
 /**
- * @brief Function to send a One-Wire reset pulse and detect if Onewire respond (presence)
+ * @brief State of the PIO 1-Wire master.
+ */
+static struct
+{
+  bool ready;          /**< PIO state machine and DMA channels are configured */
+  PIO pio;             /**< PIO block used */
+  uint sm;             /**< State machine running the onewire program */
+  uint offset;         /**< Location of the program on PIO instruction memory */
+  int dma_tx;          /**< DMA channel feeding the TX FIFO */
+  int dma_rx;          /**< DMA channel emptying the RX FIFO */
+  pio_sm_config cfg;   /**< Configuration of the state machine (speed and bits by transfer) */
+  bool overdrive;      /**< Link is on overdrive speed */
+  uint8_t od_fail;     /**< Number of overdrive failures since boot */
+} ow;
+
+/**
+ * @brief Devices found by the last search, used until the check of presence or a CRC show a change
+ */
+static struct
+{
+  bool valid;          /**< Cache contains the devices of the link */
+  struct rom rom;      /**< Devices ID found by the last search */
+  uint32_t searches;   /**< Number of searches done since boot */
+} owc;
+
+/**
+ * @brief Wait the end of the current slot, the state machine wait the next bit with the bus released
+ *
+ * @return true     State machine is idle
+ * @return false    Timeout
+ */
+static bool onewire_wait_idle(void)
+{
+  uint32_t start = time_us_32();
+  while (!pio_sm_is_tx_fifo_empty(ow.pio, ow.sm) || pio_sm_get_pc(ow.pio, ow.sm) != ow.offset + onewire_offset_slot)
+  {
+    if (time_us_32() - start > ONEWIRE_RESET_TIMEOUT_US)
+    {
+      fprintf(stdout, "OneWire PIO state machine not idle\n");
+      return false;
+    }
+    tight_loop_contents();
+  }
+  return true;
+}
+
+/**
+ * @brief Load the configuration on the state machine when the link is idle.
+ *        Restart empty the shift registers, required when the number of bits by transfer change.
+ */
+static void onewire_apply(void)
+{
+  onewire_wait_idle();
+  pio_sm_set_config(ow.pio, ow.sm, &ow.cfg);
+  pio_sm_restart(ow.pio, ow.sm);
+  pio_sm_clkdiv_restart(ow.pio, ow.sm);
+}
+
+/**
+ * @brief Set the speed of the link, the state machine tick is 1 us at standard speed
+ *
+ * @param overdrive  true: overdrive speed, false: standard speed
+ */
+static void onewire_speed(bool overdrive)
+{
+  float div = (float)clock_get_hz(clk_sys) / 1000000.0f;  // 1 us by tick
+  if (overdrive)
+  {
+    div *= ONEWIRE_OD_TICK;
+  }
+  sm_config_set_clkdiv(&ow.cfg, div);
+  ow.overdrive = overdrive;
+  onewire_apply();
+}
+
+/**
+ * @brief Select the number of bits by FIFO word, 8 for byte transfers or 1 for the search algorithm
+ *
+ * @param bits  true: one bit by word, false: one byte by word
+ */
+static void onewire_bit_mode(bool bits)
+{
+  sm_config_set_out_shift(&ow.cfg, true, true, bits ? 1 : 8);  // LSB first, autopull
+  sm_config_set_in_shift(&ow.cfg, true, true, bits ? 1 : 8);   // LSB first, autopush
+  onewire_apply();
+}
+
+/**
+ * @brief Send a One-Wire reset pulse at the current speed and detect if Onewire respond (presence)
+ *
+ * @return true     Onewire device is present
+ * @return false
+ */
+static bool onewire_reset_pulse(void)
+{
+  if (!onewire_wait_idle())
+  {
+    return false;
+  }
+  while (!pio_sm_is_rx_fifo_empty(ow.pio, ow.sm))
+  {
+    pio_sm_get(ow.pio, ow.sm);  // discard data left by an aborted transfer
+  }
+  pio_sm_exec(ow.pio, ow.sm, pio_encode_jmp(ow.offset + onewire_offset_reset));
+
+  uint32_t start = time_us_32();
+  while (pio_sm_is_rx_fifo_empty(ow.pio, ow.sm))
+  {
+    if (time_us_32() - start > ONEWIRE_RESET_TIMEOUT_US)
+    {
+      return false;
+    }
+    tight_loop_contents();
+  }
+  return !(pio_sm_get(ow.pio, ow.sm) & 1);  // device pull the bus low when present
+}
+
+/**
+ * @brief Return at standard speed, a standard reset put back all devices at standard speed.
+ *        The overdrive is not used anymore after ONEWIRE_OD_MAX_FAIL failures.
  *
+ * @return true     Onewire device is present
+ * @return false
+ */
+static bool onewire_standard(void)
+{
+  onewire_speed(false);
+  if (++ow.od_fail >= ONEWIRE_OD_MAX_FAIL)
+  {
+    fprintf(stdout, "OneWire overdrive disabled, standard speed used\n");
+  }
+  return onewire_reset_pulse();
+}
+
+/**
+ * @brief Function to send a One-Wire reset pulse and detect if Onewire respond (presence)
+ *        When no device answer at overdrive speed, the reset is done again at standard speed.
  *
  * @return true     Onewire device is present
  * @return false
  */
 static bool onewire_reset()
 {
-  gpio_put(ONEWIRE_PIN, 0);                // Pull the bus low when GPIO = OUT
-  sleep_us(2);                             // Hold for 2us
-  gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);     // Release the bus and transmit the bit
-  sleep_us(480);                           // Wait for 480us
-  gpio_set_dir(ONEWIRE_PIN, GPIO_IN);      // Release the bus and wait for the device to pull it low
-  sleep_us(65);                            // Wait for 60us
-  bool presence = !gpio_get(ONEWIRE_PIN);  // Check if the device pulled the bus low
-  sleep_us(440);                           // Wait for the remaining 420us
+  bool presence = onewire_reset_pulse();
+  if (!presence && ow.overdrive)
+  {
+    fprintf(stdout, "OneWire no presence at overdrive speed\n");
+    presence = onewire_standard();
+  }
   return presence;
 }
 
 /**
- * @brief Function to send a One-Wire write bit
+ * @brief Transfer bytes on the link with DMA, the CPU only wait the end of the transfer.
+ *        Each byte sent give the byte read on the same slots, 0xFF is sent to read a byte.
  *
- * @param bit   Value of bit to write
+ * @param tx    Bytes to send, NULL to send 0xFF (read)
+ * @param rx    Bytes read, NULL if not used
+ * @param len   Number of bytes
+ * @return true     Transfer done
+ * @return false    Timeout
  */
-static void onewire_write_bit(bool bit)
+static bool onewire_transfer(const uint8_t* tx, uint8_t* rx, size_t len)
 {
-  gpio_put(ONEWIRE_PIN, 0);             // Preset to Pull the bus low when set to GPIO_OUT
-  sleep_us(2);                          // Hold for 2us
-  gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);  // Release the bus and transmit the bit
-  sleep_us(bit ? 8 : 58);               // Write 0: Hold for 58us, Write 1: Hold for 8us
-  gpio_set_dir(ONEWIRE_PIN, GPIO_IN);   // Release the bus and wait for the device to pull it low
-  sleep_us(bit ? 64 : 10);              // Sample at 64us for recovery, 10us for the next bit
+  static const uint8_t ones = 0xFF; /**< Byte sent to read */
+  static uint8_t discard;           /**< Destination of the bytes not used */
+
+  if (len == 0)
+  {
+    return true;
+  }
+
+  dma_channel_config crx = dma_channel_get_default_config(ow.dma_rx);
+  channel_config_set_transfer_data_size(&crx, DMA_SIZE_8);
+  channel_config_set_read_increment(&crx, false);
+  channel_config_set_write_increment(&crx, rx != NULL);
+  channel_config_set_dreq(&crx, pio_get_dreq(ow.pio, ow.sm, false));
+  // byte is shifted from the left, it is on the upper byte of the FIFO word
+  dma_channel_configure(ow.dma_rx, &crx, rx ? rx : &discard, (io_rw_8*)&ow.pio->rxf[ow.sm] + 3, len, true);
+
+  dma_channel_config ctx = dma_channel_get_default_config(ow.dma_tx);
+  channel_config_set_transfer_data_size(&ctx, DMA_SIZE_8);
+  channel_config_set_read_increment(&ctx, tx != NULL);
+  channel_config_set_write_increment(&ctx, false);
+  channel_config_set_dreq(&ctx, pio_get_dreq(ow.pio, ow.sm, true));
+  dma_channel_configure(ow.dma_tx, &ctx, &ow.pio->txf[ow.sm], tx ? tx : &ones, len, true);
+
+  uint32_t start = time_us_32();
+  while (dma_channel_is_busy(ow.dma_rx))
+  {
+    if (time_us_32() - start > len * ONEWIRE_BYTE_TIMEOUT_US)
+    {
+      dma_channel_abort(ow.dma_tx);
+      dma_channel_abort(ow.dma_rx);
+      fprintf(stdout, "OneWire transfer timeout\n");
+      return false;
+    }
+    tight_loop_contents();
+  }
+  return true;
+}
+
+/**
+ * @brief Function to send One-Wire bytes
+ *
+ * @param data  Bytes to write
+ * @param len   Number of bytes
+ */
+static void onewire_write_bytes(const uint8_t* data, size_t len)
+{
+  onewire_transfer(data, NULL, len);
+}
+
+/**
+ * @brief Function to read One-Wire bytes
+ *
+ * @param data  Bytes read
+ * @param len   Number of bytes
+ */
+static void onewire_read_bytes(uint8_t* data, size_t len)
+{
+  onewire_transfer(NULL, data, len);
 }
 
 /**
@@ -94,45 +291,40 @@ static void onewire_write_bit(bool bit)
  */
 static void onewire_write_byte(uint8_t byte)
 {
-  // loop to write each bit of the bytes
-  for (int i = 0; i < 8; i++)
-  {
-    onewire_write_bit(byte & (1 << i));
-  }
+  onewire_write_bytes(&byte, 1);
 }
 
 /**
- * @brief Function to read a OneWire bit
+ * @brief Function to write and read a One-Wire bit, the link must be on bit mode
  *
- * @return true     Bit = 1
- * @return false    Bit = 0
+ * @param bit   Value of bit to write, 1 for a read slot
+ * @return      Bit read
  */
-static bool onewire_read_bit()
+static bool onewire_bit(bool bit)
 {
-  gpio_put(ONEWIRE_PIN, 0);             // Pull the bus low
-  sleep_us(2);                          // Hold for 2us
-  gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);  // Release the bus and transmit a read slot
-  sleep_us(6);                          // Hold for 6us
-  gpio_set_dir(ONEWIRE_PIN, GPIO_IN);   // Release the bus and sample the bit
-  sleep_us(12);                         // Sample at 9us
-  bool bit = gpio_get(ONEWIRE_PIN);     // Read the sampled bit
-  sleep_us(55);                         // Wait for the next bit
-  return bit;
+  pio_sm_put_blocking(ow.pio, ow.sm, bit);
+  return (pio_sm_get_blocking(ow.pio, ow.sm) >> 31) & 1;  // bit is shifted from the left
 }
 
 /**
- * @brief Function to send a One-Wire read byte
+ * @brief Function to send a One-Wire write bit
  *
- * @return  Byte read
+ * @param bit   Value of bit to write
  */
-static uint8_t onewire_read_byte()
+static void onewire_write_bit(bool bit)
 {
-  uint8_t byte = 0;
-  for (int i = 0; i < 8; i++)
-  {
-    byte |= (onewire_read_bit() << i);
-  }
-  return byte;
+  onewire_bit(bit);
+}
+
+/**
+ * @brief Function to read a OneWire bit
+ *
+ * @return true     Bit = 1
+ * @return false    Bit = 0
+ */
+static bool onewire_read_bit()
+{
+  return onewire_bit(true);
 }
 
 /**
@@ -184,6 +376,7 @@ static bool onewire_search(uint8_t* device_id)
 
     // Issue the search command
     onewire_write_byte(SEARCH_ROM);
+    onewire_bit_mode(true);  // the search is done bit by bit
 
     // Loop to do the search
     do
@@ -257,6 +450,7 @@ static bool onewire_search(uint8_t* device_id)
         }
       }
     } while (rom_byte_number < 8);  // Loop until through all ROM bytes 0-7
+    onewire_bit_mode(false);
 
     // If the search was successful then
     if (!(id_bit_number < 65))
@@ -293,17 +487,137 @@ static bool onewire_search(uint8_t* device_id)
 }
 
 /**
- * @brief Function to initialize the GPIO used to read onewire device
+ * @brief Check if a device is on the link with a SEARCH ROM forced on the path of its ID.
+ *        The search stop at the first bit where no device answer the ID.
  *
- *      GPIO is controlled like open collector device
- *      At initial start, we drive 1 for charge capacitors inside OneWire devices
- *      faster then using only pull-up method
+ * @param  device_id    Array of 8 numbers who identify the device
+ * @return true         Device is on the link
+ * @return false        Device not found
  */
-static void onewire_init()
+static bool onewire_verify(const uint8_t* device_id)
 {
-  gpio_set_function(ONEWIRE_PIN, GPIO_FUNC_SIO);
-  gpio_put(ONEWIRE_PIN, 1);
-  gpio_set_dir(ONEWIRE_PIN, GPIO_OUT);
+  bool id_bit, cmp_id_bit, bit;
+  bool found = true;
+
+  if (!onewire_reset())
+  {
+    return false;
+  }
+
+  onewire_write_byte(SEARCH_ROM);
+  onewire_bit_mode(true);  // the search is done bit by bit
+  for (int n = 0; n < 64 && found; n++)
+  {
+    bit = (device_id[n / 8] >> (n % 8)) & 1;
+    id_bit = onewire_read_bit();
+    cmp_id_bit = onewire_read_bit();
+    if ((id_bit && cmp_id_bit) || (id_bit != cmp_id_bit && id_bit != bit))
+    {
+      found = false;  // no device with this bit
+    }
+    else
+    {
+      onewire_write_bit(bit);  // devices with another bit leave the search
+    }
+  }
+  onewire_bit_mode(false);
+  return found;
+}
+
+/**
+ * @brief Function to initialize the PIO state machine and DMA channels used to drive the onewire bus
+ *
+ *      The bus is controlled like open collector device by the pin direction, the pin output stay at 0.
+ *      The external pull-up charge the capacitors inside OneWire devices.
+ *
+ * @return true     OneWire master ready
+ * @return false    No PIO state machine or DMA channel available
+ */
+static bool onewire_init()
+{
+  if (ow.ready)
+  {
+    return true;
+  }
+
+  ow.pio = pio0;
+  int sm = pio_claim_unused_sm(ow.pio, false);
+  if (sm < 0 || !pio_can_add_program(ow.pio, &onewire_program))
+  {
+    if (sm >= 0)
+    {
+      pio_sm_unclaim(ow.pio, sm);
+    }
+    ow.pio = pio1;
+    sm = pio_claim_unused_sm(ow.pio, false);
+    if (sm < 0 || !pio_can_add_program(ow.pio, &onewire_program))
+    {
+      if (sm >= 0)
+      {
+        pio_sm_unclaim(ow.pio, sm);
+      }
+      fprintf(stdout, "OneWire: no PIO state machine available\n");
+      return false;
+    }
+  }
+  ow.dma_tx = dma_claim_unused_channel(false);
+  ow.dma_rx = dma_claim_unused_channel(false);
+  if (ow.dma_tx < 0 || ow.dma_rx < 0)
+  {
+    if (ow.dma_tx >= 0) dma_channel_unclaim(ow.dma_tx);
+    if (ow.dma_rx >= 0) dma_channel_unclaim(ow.dma_rx);
+    pio_sm_unclaim(ow.pio, sm);
+    fprintf(stdout, "OneWire: no DMA channel available\n");
+    return false;
+  }
+  ow.sm = sm;
+  ow.offset = pio_add_program(ow.pio, &onewire_program);
+
+  gpio_pull_up(ONEWIRE_PIN);
+  pio_gpio_init(ow.pio, ONEWIRE_PIN);
+  pio_sm_set_pins_with_mask(ow.pio, ow.sm, 0, 1u << ONEWIRE_PIN);     // bus driven low only by the direction
+  pio_sm_set_pindirs_with_mask(ow.pio, ow.sm, 0, 1u << ONEWIRE_PIN);  // bus released
+
+  ow.cfg = onewire_program_get_default_config(ow.offset);
+  sm_config_set_sideset_pins(&ow.cfg, ONEWIRE_PIN);
+  sm_config_set_in_pins(&ow.cfg, ONEWIRE_PIN);
+  sm_config_set_out_shift(&ow.cfg, true, true, 8);  // LSB first, autopull
+  sm_config_set_in_shift(&ow.cfg, true, true, 8);   // LSB first, autopush
+  sm_config_set_clkdiv(&ow.cfg, (float)clock_get_hz(clk_sys) / 1000000.0f);
+  pio_sm_init(ow.pio, ow.sm, ow.offset + onewire_offset_slot, &ow.cfg);
+  pio_sm_set_enabled(ow.pio, ow.sm, true);
+
+  ow.ready = true;
+  sleep_ms(100);  // let charge OneWire devices in the link
+  fprintf(stdout, "OneWire master on PIO%d SM%d, DMA channels %d and %d\n", ow.pio == pio1, ow.sm, ow.dma_tx, ow.dma_rx);
+  return true;
+}
+
+/**
+ * @brief Put all devices of the link on overdrive speed (OVERDRIVE SKIP ROM)
+ *        If a device do not answer at overdrive speed, the link return at standard speed.
+ */
+static void onewire_overdrive(void)
+{
+  if (!ONEWIRE_OVERDRIVE || ow.overdrive || ow.od_fail >= ONEWIRE_OD_MAX_FAIL)
+  {
+    return;
+  }
+  if (!onewire_reset())
+  {
+    return;
+  }
+  onewire_write_byte(OVERDRIVE_SKIP_ROM);
+  onewire_speed(true);
+  if (onewire_reset_pulse())
+  {
+    fprintf(stdout, "OneWire overdrive speed\n");
+  }
+  else
+  {
+    fprintf(stdout, "OneWire overdrive not answered\n");
+    onewire_standard();
+  }
 }
 
 /**
@@ -317,17 +631,123 @@ static void onewire_init()
  */
 void onewire_select(const uint8_t* id)
 {
-  onewire_write_byte(MATCHROM);
+  uint8_t cmd[9]; /**<   MATCHROM command followed by the device ID */
 
-  for (int i = 0; i < 8; i++)
+  cmd[0] = MATCHROM;
+  memcpy(&cmd[1], id, 8);
+  onewire_write_bytes(cmd, sizeof(cmd));
+}
+
+/**
+ * @brief Tables of the 1-Wire CRC, CRC-8 (x^8 + x^5 + x^4 + 1) and CRC-16 (x^16 + x^15 + x^2 + 1),
+ *        both computed LSB first.
+ */
+static const uint8_t crc8_table[256] = {
+    0x00, 0x5E, 0xBC, 0xE2, 0x61, 0x3F, 0xDD, 0x83, 0xC2, 0x9C, 0x7E, 0x20, 0xA3, 0xFD, 0x1F, 0x41,
+    0x9D, 0xC3, 0x21, 0x7F, 0xFC, 0xA2, 0x40, 0x1E, 0x5F, 0x01, 0xE3, 0xBD, 0x3E, 0x60, 0x82, 0xDC,
+    0x23, 0x7D, 0x9F, 0xC1, 0x42, 0x1C, 0xFE, 0xA0, 0xE1, 0xBF, 0x5D, 0x03, 0x80, 0xDE, 0x3C, 0x62,
+    0xBE, 0xE0, 0x02, 0x5C, 0xDF, 0x81, 0x63, 0x3D, 0x7C, 0x22, 0xC0, 0x9E, 0x1D, 0x43, 0xA1, 0xFF,
+    0x46, 0x18, 0xFA, 0xA4, 0x27, 0x79, 0x9B, 0xC5, 0x84, 0xDA, 0x38, 0x66, 0xE5, 0xBB, 0x59, 0x07,
+    0xDB, 0x85, 0x67, 0x39, 0xBA, 0xE4, 0x06, 0x58, 0x19, 0x47, 0xA5, 0xFB, 0x78, 0x26, 0xC4, 0x9A,
+    0x65, 0x3B, 0xD9, 0x87, 0x04, 0x5A, 0xB8, 0xE6, 0xA7, 0xF9, 0x1B, 0x45, 0xC6, 0x98, 0x7A, 0x24,
+    0xF8, 0xA6, 0x44, 0x1A, 0x99, 0xC7, 0x25, 0x7B, 0x3A, 0x64, 0x86, 0xD8, 0x5B, 0x05, 0xE7, 0xB9,
+    0x8C, 0xD2, 0x30, 0x6E, 0xED, 0xB3, 0x51, 0x0F, 0x4E, 0x10, 0xF2, 0xAC, 0x2F, 0x71, 0x93, 0xCD,
+    0x11, 0x4F, 0xAD, 0xF3, 0x70, 0x2E, 0xCC, 0x92, 0xD3, 0x8D, 0x6F, 0x31, 0xB2, 0xEC, 0x0E, 0x50,
+    0xAF, 0xF1, 0x13, 0x4D, 0xCE, 0x90, 0x72, 0x2C, 0x6D, 0x33, 0xD1, 0x8F, 0x0C, 0x52, 0xB0, 0xEE,
+    0x32, 0x6C, 0x8E, 0xD0, 0x53, 0x0D, 0xEF, 0xB1, 0xF0, 0xAE, 0x4C, 0x12, 0x91, 0xCF, 0x2D, 0x73,
+    0xCA, 0x94, 0x76, 0x28, 0xAB, 0xF5, 0x17, 0x49, 0x08, 0x56, 0xB4, 0xEA, 0x69, 0x37, 0xD5, 0x8B,
+    0x57, 0x09, 0xEB, 0xB5, 0x36, 0x68, 0x8A, 0xD4, 0x95, 0xCB, 0x29, 0x77, 0xF4, 0xAA, 0x48, 0x16,
+    0xE9, 0xB7, 0x55, 0x0B, 0x88, 0xD6, 0x34, 0x6A, 0x2B, 0x75, 0x97, 0xC9, 0x4A, 0x14, 0xF6, 0xA8,
+    0x74, 0x2A, 0xC8, 0x96, 0x15, 0x4B, 0xA9, 0xF7, 0xB6, 0xE8, 0x0A, 0x54, 0xD7, 0x89, 0x6B, 0x35
+};
+static const uint16_t crc16_table[256] = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+/**
+ * @brief Calculate the CRC-8 (Dallas/Maxim) of a buffer, 0 when the buffer end with its CRC
+ *
+ * @param data  Data buffer
+ * @param size  Number of bytes
+ * @return      CRC-8
+ */
+static uint8_t onewire_crc8(const uint8_t* data, size_t size)
+{
+  uint8_t crc = 0;
+  for (size_t i = 0; i < size; i++)
+  {
+    crc = crc8_table[crc ^ data[i]];
+  }
+  return crc;
+}
+
+/**
+ * @brief Calculate the CRC-16 of a buffer, the DS2431 send the inverted CRC
+ *
+ * @param data  Data buffer
+ * @param size  Number of bytes
+ * @param crc   Initial value, CRC of the previous bytes
+ * @return      CRC-16
+ */
+static uint16_t onewire_crc16(const uint8_t* data, size_t size, uint16_t crc)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    crc = (crc >> 8) ^ crc16_table[(crc ^ data[i]) & 0xFF];
+  }
+  return crc;
+}
+
+/**
+ * @brief Send the ROM command addressing the device
+ *
+ * @param device_id     Array of 8 numbers who identify the device, NULL or 0 for all devices
+ */
+static void onewire_address(const uint8_t* device_id)
+{
+  if (device_id == NULL || device_id[0] == 0)
+  {                                // if device id not defined, expect single device
+    onewire_write_byte(SKIP_ROM);  // SKIP ROM command for DS2431
+  }
+  else
   {
-    onewire_write_byte(id[i]);
+    onewire_select(device_id);  // use device_id
   }
 }
 
 /**
  * @brief  Read OneWire lasered ROM ID
- *         Not normally used in normal operation
+ *         Valid only with a single device on the link, used to check the cache
  *
  * @param id       Array who will contains the ID
  * @param device_num  Which device
@@ -343,10 +763,7 @@ static bool read_eeprom_id(uint8_t id[])
     return false;
   }
   onewire_write_byte(READROM);  // Read data command
-  for (int i = 0; i < 8; i++)
-  {
-    id[i] = onewire_read_byte();  // Read ID bytes
-  }
+  onewire_read_bytes(id, 8);    // Read ID bytes
   return true;
 }
 
@@ -360,7 +777,7 @@ static bool read_eeprom_id(uint8_t id[])
  * @return true         no error found
  * @return false        error found
  */
-static bool read_eeprom(uint8_t* device_id, uint8_t* data_buffer, int start_address, int length)
+static bool read_eeprom(const uint8_t* device_id, uint8_t* data_buffer, int start_address, int length)
 {
   fprintf(stdout, "Read Eeprom Address: 0x%02x, len: %d\n", start_address, length);
 
@@ -370,143 +787,188 @@ static bool read_eeprom(uint8_t* device_id, uint8_t* data_buffer, int start_addr
     return false;
   }
 
-  if (device_id[0] == 0)
-  {                                // if device id not defined, expect single device
-    onewire_write_byte(SKIP_ROM);  // SKIP ROM command for DS2431
-  }
-  else
-  {
-    onewire_select(device_id);  // use device_id
-  }
-  onewire_write_byte(READ_MEMORY);                  // READ MEMORY command for DS2431
-  onewire_write_byte(start_address & 0xFF);         // LSB of start address
-  onewire_write_byte((start_address >> 8) & 0xFF);  // MSB of start address
-  for (int i = 0; i < length; i++)
-  {
-    data_buffer[i] = onewire_read_byte();
-  }
-  fprintf(stdout, "buffer = %s\n", (char*)data_buffer);
+  onewire_address(device_id);
+  uint8_t cmd[3] = {READ_MEMORY, start_address & 0xFF, (start_address >> 8) & 0xFF};  // READ MEMORY command for DS2431 and address
+  onewire_write_bytes(cmd, sizeof(cmd));
+  onewire_read_bytes(data_buffer, length);
+  fprintf(stdout, "buffer = %.*s\n", length, (char*)data_buffer);
   return true;
 }
 
 /**
- * @brief function to write on the Onewire device eeprom. Write is limited at 8 bytes by shot
+ * @brief Write a row of 8 bytes on the scratchpad of a device. The CRC-16 sent by the device
+ *        after the data is checked, the scratchpad is ready for the copy.
  *
- * @param device_id     Array of 8 numbers who identify the device
- * @param data_buffer   The data buffer who contains the data to write on eeprom
- * @param start_address The beginning address of the data to read
- * @param length        The length of data to read
- * @return true         no error found
- * @return false        error found
+ * @param device_id     Array of 8 numbers who identify the device, NULL or 0 for a single device
+ * @param row           The 8 bytes to write on scratchpad
+ * @param address       Address of the row on eeprom (multiple of 8)
+ * @return uint8_t      Error number (0 = No Error)
  */
-static uint8_t write_eeprom_8bytes(const uint8_t* device_id, const char* data_buffer, int start_address, int length)
+static uint8_t write_scratchpad(const uint8_t* device_id, const uint8_t* row, int address)
 {
-  volatile uint8_t ta[3];
-  volatile uint8_t crcv[2];
-  volatile uint8_t data_read[8];
+  uint8_t cmd[3 + DS2431_ROW]; /**<   Command, address and data sent to scratchpad */
+  uint8_t crcv[2];             /**<   Inverted CRC-16 returned by the device */
+  uint16_t crc;                /**<   CRC-16 expected */
 
-  // Write Scratchpad block
   if (!onewire_reset())
   {
     fprintf(stdout, "Device not found on write scratchpad\n");
     return DEVICE_DISCONNECTED;
   }
-  if (device_id[0] == 0)
-  {                                // if device id not defined, expect single device
-    onewire_write_byte(SKIP_ROM);  // SKIP ROM command for DS2431
-  }
-  else
+  onewire_address(device_id);
+  cmd[0] = WRITE_SCRATCHPAD;       // WRITE SCRATCHPAD command for DS2431
+  cmd[1] = address & 0xFF;         // LSB of start address
+  cmd[2] = (address >> 8) & 0xFF;  // MSB of start address
+  memcpy(&cmd[3], row, DS2431_ROW);
+  onewire_write_bytes(cmd, sizeof(cmd));
+  onewire_read_bytes(crcv, sizeof(crcv));  // CRC of command, address and data
+
+  crc = ~onewire_crc16(cmd, sizeof(cmd), 0);
+  if (crcv[0] != (crc & 0xFF) || crcv[1] != (crc >> 8))
   {
-    onewire_select(device_id);  // use device_id
-  }
-  onewire_write_byte(WRITE_SCRATCHPAD);             // WRITE SCRATCHPAD command for DS2431
-  onewire_write_byte(start_address & 0xFF);         // LSB of start address
-  onewire_write_byte((start_address >> 8) & 0xFF);  // MSB of start address
-  for (int i = 0; i < length; i++)
-  {
-    onewire_write_byte(data_buffer[i]);
+    fprintf(stdout, "Scratchpad CRC error at address 0x%02x, CRC: 0x%02x%02x, expected: 0x%04x\n", address, crcv[1], crcv[0], crc);
+    return BAD_INTEGRITY;
   }
+  return 0;  // no error
+}
+
+/**
+ * @brief Copy the scratchpad to eeprom and wait the programming time.
+ *        Without device_id, the copy is sent with SKIP ROM: all devices staged at the same address
+ *        are programmed at the same time with a single wait.
+ *
+ * @param device_id     Array of 8 numbers who identify the device, NULL for all devices
+ * @param address       Address of the row on eeprom (multiple of 8)
+ * @return uint8_t      Error number (0 = No Error)
+ */
+static uint8_t copy_scratchpad(const uint8_t* device_id, int address)
+{
+  uint8_t cmd[4]; /**<   Command and authorization code */
+  uint8_t status; /**<   Byte read after the programming */
 
-  // Read Scratchpad block
   if (!onewire_reset())
   {
-    fprintf(stdout, "Device not found on read Scratchpad \n");
+    fprintf(stdout, "Device not found on copy scratchpad\n");
     return DEVICE_DISCONNECTED;
   }
-  if (device_id[0] == 0)
-  {                                // if device id not defined, expect single device
-    onewire_write_byte(SKIP_ROM);  // SKIP ROM command for DS2431
-  }
-  else
-  {
-    onewire_select(device_id);  // use device_id
-  }
-  onewire_write_byte(READ_SCRATCHPAD);  // Read SCRATCHPAD command for DS2431
-  ta[0] = onewire_read_byte();          // Read TA1
-  ta[1] = onewire_read_byte();          // Read TA2
-  ta[2] = onewire_read_byte();          // Read ESTA1
-  for (int i = 0; i < length; i++)
-  {
-    data_read[i] = onewire_read_byte();
+  onewire_address(device_id);
+  cmd[0] = COPY_SCRATCHPAD;        // COPY SCRATCHPAD command for DS2431
+  cmd[1] = address & 0xFF;         // LSB of start address
+  cmd[2] = (address >> 8) & 0xFF;  // MSB of start address
+  cmd[3] = DS2431_ROW - 1;         // E/S, ending offset of a complete row
+  onewire_write_bytes(cmd, sizeof(cmd));
+  sleep_ms(DS2431_TPROG_MS);  // bus stay idle during EEPROM write time
+
+  onewire_read_bytes(&status, 1);
+  if (status != 0xAA && status != 0x55)
+  {  // device send alternate 1 and 0 when the copy is done
+    fprintf(stdout, "Copy scratchpad failure at address 0x%02x, status: 0x%02x\n", address, status);
+    return COPY_FAILURE;
   }
-  crcv[0] = onewire_read_byte();  // Read CRC0
-  crcv[1] = onewire_read_byte();  // Read CRC1
+  return 0;  // no error
+}
+
+/**
+ * @brief Write a string on many devices. Each row of 8 bytes is staged on the scratchpad of all
+ *        devices, then copied on eeprom. When all devices of the link are written, one copy
+ *        addressed to all devices share the programming time. The strings are verified at the
+ *        end with one read memory by device.
+ *
+ * @param device_id     Array of device ID
+ * @param info          Array of strings to write, one by device
+ * @param nbdev         Number of devices
+ * @param all           true if all devices of the link are written
+ * @param start_address Address on eeprom (multiple of 8)
+ * @param ecode         Array of error number by device, device with error are not written
+ * @return uint8_t      First error found (0 = No Error)
+ */
+static uint8_t write_eeprom_batch(const uint8_t* const device_id[], const char* const info[], size_t nbdev, bool all,
+                                  int start_address, int ecode[])
+{
+  uint8_t row[DS2431_ROW];   /**<   Row to write on scratchpad */
+  char readstr[NB_INFO + 1]; /**<   String read for verification */
+  size_t len[MAX_ONEWIRE];   /**<   Length of the strings */
+  size_t maxlen = 0;         /**<   Length of the longest string */
 
-  fprintf(stdout, "scratchpad status,TA1: 0x%02x,TA2: 0x%02x, E/S: 0x%02x,CRC0: 0x%02x, CRC1: 0x%02x\n", ta[0], ta[1], ta[2], crcv[0], crcv[1]);
-  // Compare write and read scratchpad
-  for (int i = 0; i < length; i++)
+  for (size_t nb = 0; nb < nbdev; nb++)
   {
-    if (data_read[i] != data_buffer[i])
-    {  // if error found stop
-      fprintf(stdout, "Error between read and write scratchpad at position %d, write 0x%02x,read 0x%02x\n", i, data_buffer[i], data_read[i]);
-      return BAD_INTEGRITY;
+    len[nb] = strnlen(info[nb], NB_INFO);
+    if (len[nb] > maxlen)
+    {
+      maxlen = len[nb];
     }
   }
 
-  // Copy Scratchpad block
-  if (!onewire_reset())
+  for (size_t pos = 0; pos < maxlen; pos += DS2431_ROW)
   {
-    fprintf(stdout, "Device not found on read Scratchpad \n");
-    return DEVICE_DISCONNECTED;
-  }
+    int address = start_address + pos;
+    size_t staged = 0;
 
-  if (device_id[0] == 0)
-  {                                // if device id not defined, expect single device
-    onewire_write_byte(SKIP_ROM);  // SKIP ROM command for DS2431
+    for (size_t nb = 0; nb < nbdev; nb++)
+    {
+      if (ecode[nb] == 0 && pos < len[nb])
+      {
+        memset(row, 0, sizeof(row));  // end of string is filled with 0
+        memcpy(row, info[nb] + pos, (len[nb] - pos < DS2431_ROW) ? len[nb] - pos : DS2431_ROW);
+        ecode[nb] = write_scratchpad(device_id[nb], row, address);
+        if (ecode[nb] == 0)
+        {
+          staged++;
+        }
+      }
+    }
+
+    if (all && staged == nbdev)
+    {  // same authorization on all devices, one copy for the link
+      uint8_t err = copy_scratchpad(NULL, address);
+      for (size_t nb = 0; nb < nbdev; nb++)
+      {
+        ecode[nb] = err;
+      }
+    }
+    else
+    {
+      for (size_t nb = 0; nb < nbdev; nb++)
+      {
+        if (ecode[nb] == 0 && pos < len[nb])
+        {
+          ecode[nb] = copy_scratchpad(device_id[nb], address);
+        }
+      }
+    }
+    fprintf(stdout, "Row address 0x%02x written on %d devices\n", address, staged);
   }
-  else
+
+  // one read memory by device to verify all rows
+  for (size_t nb = 0; nb < nbdev; nb++)
   {
-    onewire_select(device_id);  // use device_id
+    memset(readstr, 0, sizeof(readstr));
+    if (ecode[nb] != 0)
+    {
+      fprintf(stdout, "Write is failure with device # %d, error: %d\n", nb + 1, ecode[nb]);
+      ecode[nb] = OW_WRITE_FAIL;
+    }
+    else if (!read_eeprom(device_id[nb], (uint8_t*)readstr, start_address, len[nb]))
+    {
+      fprintf(stdout, "Read after Write is failure with device # %d\n", nb + 1);
+      ecode[nb] = OW_READ_WRITE_FAIL;
+    }
+    else if (memcmp(readstr, info[nb], len[nb]) != 0)
+    {
+      fprintf(stdout, "The strings are not identical with device # %d\nWrite: %s\nRead:  %s\n", nb + 1, info[nb], readstr);
+      ecode[nb] = OW_STR_NOT_IDENTICAL;
+    }
   }
-  onewire_write_byte(COPY_SCRATCHPAD);              // COPY SCRATCHPAD command for DS2431
-  onewire_write_byte(start_address & 0xFF);         // LSB of start address
-  onewire_write_byte((start_address >> 8) & 0xFF);  // MSB of start address
-  onewire_write_byte(0x07);                         // ES byte for DS2431, typically 0xA5
-  // Wait for the write to complete
-  sleep_ms(10);  // Delay for EEPROM write time
-  return 0;      // no error
-}
 
-// Function to calculate the CRC-8 checksum (Dallas/Maxim) for a given data buffer
-static uint8_t calculate_crc8(const uint8_t* data, size_t size)
-{
-  uint8_t crc = 0;
-  for (size_t i = 0; i < size; i++)
+  for (size_t nb = 0; nb < nbdev; nb++)
   {
-    uint8_t byte = data[i];
-    for (int j = 0; j < 8; j++)
+    if (ecode[nb] != 0)
     {
-      uint8_t mix = (crc ^ byte) & 0x01;
-      crc >>= 1;
-      if (mix)
-      {
-        crc ^= 0x8C;  // Polynomial: x^8 + x^5 + x^4 + 1 (0x8C)
-      }
-      byte >>= 1;
+      owc.valid = false;  // device could be removed, search again on next access
+      return ecode[nb];
     }
   }
-  // fprintf(stdout,"CRC checksum calculated: 0x%02X\n", crc);
-  return crc;
+  return 0;  // No Error
 }
 
 /**
@@ -516,7 +978,7 @@ static uint8_t calculate_crc8(const uint8_t* data, size_t size)
  * @param nb_devices_expected   Number of devices expected on OneWire link
  * @return true                 At least one device has been found
  */
-static bool onewire_read_id(struct rom* romid, size_t nb_devices_expected)
+static bool onewire_search_all(struct rom* romid, size_t nb_devices_expected)
 {
   char romstr[17]; /**<   Contains device id number in string format */
   size_t nb;       /**<   Counter to number of device found */
@@ -524,21 +986,20 @@ static bool onewire_read_id(struct rom* romid, size_t nb_devices_expected)
   bool valid;      /**<   Reset if error found during function execution */
   size_t ntry = 0; /**<   Counter to number of try to found the expected devices */
 
-  onewire_init();  // initialize oneWire GPIO
-  sleep_ms(100);   // let charge OneWire devices in the link
-
+  romid->nbid = 0;
   fprintf(stdout, "Searching All OneWire devices\n");
 
   do
   {  // loop is required due to intermittence in detection od Onewire devices
 
+    onewire_overdrive();
     valid = onewire_reset();
     if (valid == true)
     {
       fprintf(stdout, "OneWire presence detected\n");
       nb = 0;
       onewire_search_reset();  // initialize search counter and variables
-      while (onewire_search(id))
+      while (nb < MAX_ONEWIRE && onewire_search(id))
       {
         romstr[0] = '\0';  // initialize array first character at 0
         romid->ecode[nb] = 0;
@@ -554,11 +1015,15 @@ static bool onewire_read_id(struct rom* romid, size_t nb_devices_expected)
         strcpy(&romid->idstr[nb][0], romstr);
 
         // Calculate CRC-8 checksum of the data
-        uint8_t crc = calculate_crc8(id, 8);
+        uint8_t crc = onewire_crc8(id, 8);
         fprintf(stdout, "CRC checksum is 0x%02X\n", crc);
         if (crc != 0)
         {
           romid->ecode[nb] = CRC_MISMATCH;
+          if (ow.overdrive)
+          {  // search is done again at standard speed
+            onewire_standard();
+          }
         }
         nb++;  // increment number of device found
       }
@@ -579,6 +1044,154 @@ static bool onewire_read_id(struct rom* romid, size_t nb_devices_expected)
 
   return false;
 }
+
+/**
+ * @brief Check if the devices of the cache are still on the link.
+ *        The ROM of a single device is read and compared, each device of a link with many
+ *        devices is checked by a SEARCH ROM forced on its ID.
+ *
+ * @return true     Cache is valid
+ */
+static bool onewire_cache_check(void)
+{
+  uint8_t id[8]; /**<   ROM read on the link */
+
+  onewire_overdrive();
+  if (owc.rom.nbid != 1)
+  {  // READ ROM is not possible with many devices
+    for (size_t nb = 0; nb < owc.rom.nbid; nb++)
+    {
+      if (!onewire_verify(owc.rom.id[nb]))
+      {
+        fprintf(stdout, "OneWire device # %u not found on cache check\n", (unsigned)(nb + 1));
+        return false;
+      }
+    }
+    return owc.rom.nbid > 0;
+  }
+  if (!read_eeprom_id(id))
+  {
+    return false;
+  }
+  if (onewire_crc8(id, 8) != 0)
+  {
+    fprintf(stdout, "OneWire ROM CRC error on cache check\n");
+    if (ow.overdrive)
+    {
+      onewire_standard();
+    }
+    return false;
+  }
+  return memcmp(id, owc.rom.id[0], 8) == 0;
+}
+
+/**
+ * @brief Return the devices ID of the link. The search is done only if the cache is not valid,
+ *        if more devices are expected or if the devices of the cache are not found.
+ *
+ * @param struct rom            Contains device_id found on OneWire link
+ * @param nb_devices_expected   Number of devices expected on OneWire link
+ * @return true                 At least the expected number of devices has been found
+ */
+static bool onewire_read_id(struct rom* romid, size_t nb_devices_expected)
+{
+  bool valid; /**<   Result of the search */
+
+  romid->nbid = 0;
+  if (!onewire_init())
+  {  // initialize oneWire master
+    return false;
+  }
+
+  if (owc.valid && owc.rom.nbid >= nb_devices_expected)
+  {
+    if (onewire_cache_check())
+    {
+      *romid = owc.rom;
+      fprintf(stdout, "OneWire %d devices ID from cache\n", romid->nbid);
+      return true;
+    }
+    fprintf(stdout, "OneWire link changed, search devices again\n");
+  }
+
+  owc.valid = false;
+  valid = onewire_search_all(romid, nb_devices_expected);
+  owc.searches++;
+  if (valid)
+  {
+    owc.rom = *romid;
+    owc.valid = true;
+    for (size_t nb = 0; nb < romid->nbid; nb++)
+    {
+      if (romid->ecode[nb] != 0)
+      {  // a device with CRC error is not kept
+        owc.valid = false;
+      }
+    }
+  }
+  return valid;
+}
+
+/**
+ * @brief Append formatted text at the cursor of a bounded string. The text is truncated when
+ *        the string is full, the string stay terminated.
+ *
+ * @param str   String to fill
+ * @param size  Size of the string
+ * @param pos   Cursor, position of the end of the string, updated
+ * @param fmt   Format of the text
+ */
+static void onewire_append(char* str, size_t size, size_t* pos, const char* fmt, ...)
+{
+  va_list args;
+  int n;
+
+  if (*pos + 1 >= size)
+  {
+    return;  // string full
+  }
+  va_start(args, fmt);
+  n = vsnprintf(str + *pos, size - *pos, fmt, args);
+  va_end(args);
+  if (n > 0)
+  {
+    *pos += ((size_t)n < size - *pos) ? (size_t)n : size - *pos - 1;
+  }
+}
+
+/**
+ * @brief Return the ID of the devices on the link, from the cache when the link is not changed
+ *
+ * @param roms      String who will contains the devices ID separated by comma
+ * @param size      Size of the string
+ * @return uint8_t  Error number (0 = No Error)
+ */
+uint8_t onewire_read_roms(char* roms, size_t size)
+{
+  struct rom idr; /**<   Structure of device id */
+  size_t pos = 0; /**<   Position of the next ID on the string */
+
+  roms[0] = '\0';
+  if (!onewire_read_id(&idr, 1))
+  {
+    return OW_NO_ONEWIRE;
+  }
+
+  for (size_t nb = 0; nb < idr.nbid; nb++)
+  {
+    onewire_append(roms, size, &pos, "%s%s", nb ? "," : "", &idr.idstr[nb][0]);
+  }
+  fprintf(stdout, "OneWire devices: %s, searches since boot: %d\n", roms, owc.searches);
+
+  for (size_t e = 0; e < idr.nbid; e++)
+  {
+    if (idr.ecode[e] != 0)
+    {
+      return idr.ecode[e];
+    }  // if error exist, return error
+  }
+  return 0;  // No Error
+}
 /**
  * @brief Write string information to the One-Wire Device
  *        The string is write on oneWire device following this device_id
@@ -590,17 +1203,19 @@ static bool onewire_read_id(struct rom* romid, size_t nb_devices_expected)
 uint8_t onewire_write_info(const char* info, int start_address)
 {
   size_t nbinfo;      /**<   Number of character in string */
-  uint8_t pinfo[9];   /**<   contain substring to write on Onewire */
   uint8_t id[8];      /**<   Array of 8 bytes of the Device_id */
-  int epos;           /**<   Used to contains address to write on OneWire */
   size_t i, j;        /**<   Used in for-loop for extract device id from the string */
   int byte_index = 0; /**<   Counter to number of bytes received */
+  int ecode = 0;      /**<   Error of the write */
 
   nbinfo = strlen(info);
   fprintf(stdout, "OneWire Write eeprom,len: %d,address: 0x%02x, str: \n%s\n", nbinfo, start_address, info);
 
-  onewire_init();  // initialize oneWire GPIO
-  sleep_ms(100);   // let time to charge the one device
+  if (!onewire_init())
+  {  // initialize oneWire master
+    return OW_NO_ONEWIRE;
+  }
+  onewire_overdrive();
 
   // Loop through the string and extract the ID of the devices
   // According to the format, the first 16 characters of string are for the device_id
@@ -624,56 +1239,47 @@ uint8_t onewire_write_info(const char* info, int start_address)
     }  // if device id is completed
   }
 
-  // OneWire device could write a maximum of 8 bytes for single write
-  // The loop cut the string by 8 bytes and send each group to write eeprom function
-  for (i = 0; i < nbinfo; i += 8)
-  {
-    strncpy(pinfo, info + i, 8);
-    epos = start_address + i;  // Build location Address to use to write on EEprom
-    uint8_t valid = write_eeprom_8bytes(id, pinfo, epos, 8);
-    if (valid != 0)
-    {
-      fprintf(stdout, "Error on writing EEprom, error # %d\n", valid);
-      return OW_WRITE_FAIL;  // return error
-    }
-    pinfo[8] = '\0';
-    fprintf(stdout, "Cut String address %d, str= %s\n", epos, pinfo);
-  }
-
-  return 0;  // No Error
+  // The string is written by rows of 8 bytes and verified by a read memory
+  const uint8_t* ids[1] = {id};
+  const char* infos[1] = {info};
+  return write_eeprom_batch(ids, infos, 1, false, start_address, &ecode);
 }
 
 /**
  * @brief   Main function to perform a read of all eeprom on 1-wire link
  *
- * @param rinfo             Pointer who will contains the string read on Devices
+ * @param rinfo             String who will contains the string read on Devices, each device enclosed by bracket
+ * @param size              Size of rinfo, ONEWIRE_INFO_SIZE for all devices
  * @param start_address     Start Address on EEprom memory to start to read
- * @param length            Number of characters to read
+ * @param length            Number of characters to read (NB_INFO maximum)
  * @param nbid              Number of expected device on the OneWire link
  *                          Used on read loop  to be sure we have read all expected devices
  * @return uint8_t
  */
-uint8_t onewire_read_info(char** rinfo, int start_address, int length, size_t nbid)
+uint8_t onewire_read_info(char* rinfo, size_t size, int start_address, int length, size_t nbid)
 {
-  bool valid;              /**<  to get error from the function */
-  uint8_t readstr[length]; /**<   string to contents the result of the OneWire read */
-  struct rom idr;          /**<   Structure of device id */
+  bool valid;               /**<  to get error from the function */
+  uint8_t readstr[NB_INFO]; /**<   string to contents the result of the OneWire read */
+  struct rom idr;           /**<   Structure of device id */
+  size_t pos = 0;           /**<   Cursor on result string */
 
   fprintf(stdout, "OneWire Read eeprom info \n");
 
-  *rinfo = (char*)malloc(length * MAX_ONEWIRE);  // set size of pointer
+  rinfo[0] = '\0';
+  if (length > NB_INFO)
+  {
+    length = NB_INFO;
+  }
 
   valid = onewire_read_id(&idr, nbid);
   if (valid == false)
   {
     if (idr.nbid == 0)
     {
-      rinfo[0] = '\0';
       return OW_NO_ONEWIRE;
     }
     else
     {
-      rinfo[0] = '\0';
       return OW_NB_ONEWIRE;
     }
   }
@@ -685,24 +1291,14 @@ uint8_t onewire_read_info(char** rinfo, int start_address, int length, size_t nb
       valid = read_eeprom(&idr.id[nb][0], readstr, start_address, length);
       if (valid)
       {
-        // Add each device info to the result string
-        if (nb == 0)
-        {
-          strcpy(*rinfo, "[ ");  // enclose string with bracket
-          strcat(*rinfo, readstr);
-          strcat(*rinfo, " ]");
-        }
-        else
-        {
-          strcat(*rinfo, " [ ");
-          strcat(*rinfo, readstr);
-          strcat(*rinfo, " ]");
-        }
+        // Add each device info to the result string, enclosed with bracket
+        onewire_append(rinfo, size, &pos, "%s[ %.*s ]", pos ? " " : "", length, (char*)readstr);
       }
       else
       {
         fprintf(stdout, "Read error with device # %d\n", nb + 1);
         idr.ecode[nb] = OW_READ_FAIL;
+        owc.valid = false;  // device could be removed, search again on next access
       }
     }
   }
@@ -721,108 +1317,68 @@ uint8_t onewire_read_info(char** rinfo, int start_address, int length, size_t nb
 /**
  * @brief Check presence of oneWire and check Read Write capacity
  *
- * @param owdata        Pointer who will contains the result string to return.
+ * @param owdata        String who will contains the result string to return.
  *                      Util to know device_id available on the Onewire link
+ * @param size          Size of owdata, ONEWIRE_CHECK_SIZE for all devices
  * @param nbid          number of devices expected on oneWire link
  * @return uint8_t      Error number raised during operation
  */
 
-uint8_t onewire_check_devices(char** owdata, size_t nbid)
+uint8_t onewire_check_devices(char* owdata, size_t size, size_t nbid)
 {
-  bool valid;            /**<  to get error from the function */
-  bool found;            /**<  flag to indicate of at least one OneWire device has been found */
-  char teststr[NB_TEST]; /**<  Contains test string to write on device */
-  char readstr[NB_TEST]; /**<  Contains string read from device */
-  struct rom idr;        /**<  Structure who contains result of the search devices */
+  bool valid;                         /**<  to get error from the function */
+  bool found;                         /**<  flag to indicate of at least one OneWire device has been found */
+  char teststr[MAX_ONEWIRE][NB_TEST]; /**<  Contains test string to write on each device */
+  const uint8_t* ids[MAX_ONEWIRE];    /**<  ID of the devices to write */
+  const char* infos[MAX_ONEWIRE];     /**<  String to write on each device */
+  struct rom idr;                     /**<  Structure who contains result of the search devices */
 
-  *owdata = (char*)malloc((16 + 16) * MAX_ONEWIRE);  // set size of pointer to contains the ID of device
+  size_t pos = 0;                     /**<  Cursor on result string */
+
+  owdata[0] = '\0';
 
   valid = onewire_read_id(&idr, nbid);  // search devices and read device id
   if (valid == false)
   {  // if error received exit
     if (idr.nbid == 0)
     {
-      owdata[0] = '\0';
       return OW_NO_ONEWIRE;
     }
     else
     {
-      owdata[0] = '\0';
       return OW_NB_ONEWIRE;
     }
   }
 
-  found = false;                            // preset the flag found
-  for (size_t nb = 0; nb < idr.nbid; nb++)  // loop for each devices found on the search devices
+  for (size_t nb = 0; nb < idr.nbid; nb++)
   {
-    if (idr.ecode[nb] == 0)
-    {  // if no error detected
-      fprintf(stdout, "\nChecking OneWire device # %d\n", nb + 1);
-      // Generate a pseudo random 5-digit number based on device identifier
-      int randNb = idr.id[nb][1] % 90000 + 10000;  // Generates a random number between 10000 and 99999
+    if (idr.ecode[nb] != 0)
+    {
+      return idr.ecode[nb];  // if error raised during search devices, return this error
+    }
+  }
 
-      // Convert the random number to a string
-      char randStr[5];  // 5 digits
-      sprintf(randStr, "%d", randNb);
+  for (size_t nb = 0; nb < idr.nbid; nb++)  // build the test string of each device found
+  {
+    // Generate a pseudo random 5-digit number based on device identifier
+    int randNb = idr.id[nb][1] % 90000 + 10000;  // Generates a random number between 10000 and 99999
+    snprintf(teststr[nb], NB_TEST, "%.16s, %d", &idr.idstr[nb][0], randNb);  // device id, comma and random number
+    ids[nb] = &idr.id[nb][0];
+    infos[nb] = teststr[nb];
+  }
 
-      for (int x = 0; x < NB_TEST; x++)
-      {
-        teststr[x] = '\0';
-      }  // init teststr to NULL
-
-      strncpy(teststr, &idr.idstr[nb][0], 16);                 // Start string with device id
-      strcat(teststr, ", ");                                   // add comma
-      strcat(teststr, randStr);                                // add random number
-      idr.ecode[nb] = onewire_write_info(teststr, ADDR_TEST);  // Write string to OneWire
-      if (idr.ecode[nb] == 0)
-      {
-        fprintf(stdout, "Write is success with device # %d\n", nb + 1);
-        valid = read_eeprom(&idr.id[nb][0], readstr, ADDR_TEST, NB_TEST);  // Read string
-        if (valid)
-        {
-          fprintf(stdout, "Read after Write is success with device # %d\n", nb + 1);
-          // compare string
-          int tnb = strlen(teststr);
-          fprintf(stdout, "Test string: %s\nRead string %s\n", teststr, readstr);
-          int rescp = strncmp(teststr, readstr, tnb);
-          // Check if the strings are identical
-          if (rescp == 0)
-          {
-            fprintf(stdout, "The strings are identical.\n");
-            found = true;
-            // build string to be returned
-            if (nb == 0)
-            {
-              strcpy(*owdata, "VALID_OWID: ");
-              strcat(*owdata, &idr.idstr[nb][0]);
-            }
-            else
-            {
-              strcat(*owdata, ", NEXT_OWID: ");
-              strcat(*owdata, &idr.idstr[nb][0]);
-            }
-          }
-          else
-          {
-            fprintf(stdout, "The strings are not identical\n");
-            idr.ecode[nb] = OW_STR_NOT_IDENTICAL;
-          }
-        }
-        else
-        {
-          fprintf(stdout, "Read after Write is failure with device # %d\n", nb);
-          idr.ecode[nb] = OW_READ_WRITE_FAIL;
-        }
-      }
-      else
-      {
-        fprintf(stdout, "Write is failure with device # %d, error: %d\n", nb, idr.ecode[nb]);
-        idr.ecode[nb] = OW_WRITE_FAIL;
-      }
-    }
-    else
+  // Write the test string on all devices at the same time
+  write_eeprom_batch(ids, infos, idr.nbid, true, ADDR_TEST, idr.ecode);
+
+  found = false;  // preset the flag found
+  for (size_t nb = 0; nb < idr.nbid; nb++)
+  {
+    if (idr.ecode[nb] == 0)
     {
-      return idr.ecode[nb];  // if error raised during search devices, return this error
+      fprintf(stdout, "Write and Read is success with device # %d\n", nb + 1);
+      found = true;
+      // build string to be returned
+      onewire_append(owdata, size, &pos, "%s%s", pos ? ", NEXT_OWID: " : "VALID_OWID: ", &idr.idstr[nb][0]);
     }
   }
   // loop to see if error raised during the check of devices
@@ -837,7 +1393,6 @@ uint8_t onewire_check_devices(char** owdata, size_t nbid)
   if (!found)
   {
     fprintf(stdout, "No OneWire detected\n");
-    owdata[0] = '\0';
     return OW_NO_ONEWIRE;
   }
 
@@ -24,6 +24,15 @@
  */
 #define ONEWIRE_PIN 10
 
+/**
+ * @brief Speed of the 1-Wire link driven by PIO.
+ */
+#define ONEWIRE_OVERDRIVE 1             /**< 1: use overdrive speed when devices answer, 0: standard speed only */
+#define ONEWIRE_OD_TICK 0.15f           /**< Overdrive PIO tick in us (1 us at standard speed) */
+#define ONEWIRE_OD_MAX_FAIL 3           /**< Overdrive failures before the standard speed is kept until reboot */
+#define ONEWIRE_BYTE_TIMEOUT_US 1000    /**< Maximum time to transfer a byte at standard speed (8 x 79 us) */
+#define ONEWIRE_RESET_TIMEOUT_US 1500   /**< Maximum time of a reset at standard speed (960 us) */
+
 /**
  * @brief Start address of the information string on EEPROM.
  */
@@ -34,6 +43,16 @@
  */
 #define NB_INFO 64
 
+/**
+ * @brief Size of the string returned by onewire_read_info for all devices ("[ info ]" by device).
+ */
+#define ONEWIRE_INFO_SIZE (MAX_ONEWIRE * (NB_INFO + 5) + 1)
+
+/**
+ * @brief Size of the string returned by onewire_check_devices for all devices.
+ */
+#define ONEWIRE_CHECK_SIZE (MAX_ONEWIRE * (16 + 13) + 1)
+
 /**
  * @brief Test address available to check read/write during testing.
  */
@@ -49,6 +68,16 @@
  */
 #define MAX_ONEWIRE 2
 
+/**
+ * @brief Size of the DS2431 scratchpad, the eeprom is written by row of 8 bytes.
+ */
+#define DS2431_ROW 8
+
+/**
+ * @brief Programming time of a row after the copy of the scratchpad (tPROG).
+ */
+#define DS2431_TPROG_MS 10
+
 /**
  * @brief Structure to define chip model attributes.
  */
@@ -99,6 +128,8 @@ struct rom
 #define SEARCH_ROM 0xF0       /**< Command to search ROM. */
 #define READ_ROM 0x33         /**< Command to read ROM (duplicate). */
 #define SKIP_ROM 0xCC         /**< Command to skip ROM. */
+#define OVERDRIVE_SKIP_ROM 0x3C  /**< Command to skip ROM and set all devices on overdrive speed. */
+#define OVERDRIVE_MATCH_ROM 0x69 /**< Command to match ROM and set the device on overdrive speed. */
 #define ALARM_SEARCH 0xEC     /**< Command to perform an alarm search. */
 
 /**
@@ -126,7 +157,8 @@ struct rom
 /**> List of function visible by other program*/
 
 uint8_t onewire_write_info(const char* info, int start_address);
-uint8_t onewire_read_info(char** rinfo, int start_address, int length, size_t nbid);
-uint8_t onewire_check_devices(char** owdata, size_t nbid);
+uint8_t onewire_read_info(char* rinfo, size_t size, int start_address, int length, size_t nbid);
+uint8_t onewire_check_devices(char* owdata, size_t size, size_t nbid);
+uint8_t onewire_read_roms(char* roms, size_t size);
 
 #endif
@@ -84,6 +84,13 @@
 
     - Return current = 0 if current is negative on ina219GetCurrent_mA
     - Add function ina219CalibrateCurrent_mA to perform calibration from know value
+    - Keep the calibration written on device, used to convert shunt voltage to current
+    - Add ina219ShuntToCurrent_uA for background sampling
+    - Add float functions to return current and power without truncation
+    - Add ina219SetConfig and ina219GetConfig to change conversion mode
+    - Add ina219SetAdcMode to select resolution and averaging, kept after calibration
+    - Add ina219ReadMeas to read one fresh conversion (CNVR polling) in integer units
+    - Add ina219CalibrateCurrent_uA, calibration computed on integer without truncation of mA
 **************************************************************************/
 
 #include "dev_ina219.h"
@@ -95,6 +102,11 @@ uint32_t ina219_powerDivider_mW = 0;   /**< Multiplier for converting raw power
 
 // This variable contains the default calibration factor
 uint32_t ina219_Calfactor = 0; /**< Default calibration factor for INA219 */
+uint16_t ina219_CalActive = 0; /**< Calibration factor written on the device */
+uint16_t ina219_AdcConfig = INA219_CONFIG_ADC_DEFAULT; /**< Bus and shunt ADC setting of config register */
+
+// Conversion time in us of one ADC code (datasheet table 5)
+static const uint32_t ina219ConvTime_us[16] = {84, 148, 276, 532, 84, 148, 276, 532, 532, 1060, 2130, 4260, 8510, 17020, 34050, 68100};
 
 /**************************************************************************/
 /*!
@@ -109,6 +121,11 @@ static void ina219WriteRegister(uint8_t reg, uint16_t value)
   buffer[1] = value >> 8;    // Upper 8-bits
   buffer[2] = value & 0xFF;  // Lower 8-bits
 
+  if (reg == INA219_REG_CALIBRATION)
+  {
+    ina219_CalActive = value;  // keep actual calibration
+  }
+
   // set register
   sys_i2c_wbuf(i2c0, INA219_ADDRESS, buffer, sizeof(buffer));
 }
@@ -211,7 +228,7 @@ void ina219SetCalibration_32V_2A(void)
   ina219WriteRegister(INA219_REG_CALIBRATION, ina219_Calfactor);
 
   // Set Config register to take into account the settings above
-  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_32V | INA219_CONFIG_GAIN_8_320MV | INA219_CONFIG_BADCRES_12BIT | INA219_CONFIG_SADCRES_12BIT_1S_532US
+  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_32V | INA219_CONFIG_GAIN_8_320MV | ina219_AdcConfig
                     | INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
   ina219WriteRegister(INA219_REG_CONFIG, config);
 }
@@ -300,7 +317,7 @@ void ina219SetCalibration_32V_1A(void)
   ina219WriteRegister(INA219_REG_CALIBRATION, ina219_Calfactor);
 
   // Set Config register to take into account the settings above
-  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_32V | INA219_CONFIG_GAIN_8_320MV | INA219_CONFIG_BADCRES_12BIT | INA219_CONFIG_SADCRES_12BIT_1S_532US
+  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_32V | INA219_CONFIG_GAIN_8_320MV | ina219_AdcConfig
                     | INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
   ina219WriteRegister(INA219_REG_CONFIG, config);
 }
@@ -383,7 +400,7 @@ void ina219SetCalibration_16V_500mA(void)
   ina219WriteRegister(INA219_REG_CALIBRATION, ina219_Calfactor);
 
   // Set Config register to take into account the settings above
-  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_16V | INA219_CONFIG_GAIN_2_80MV | INA219_CONFIG_BADCRES_12BIT | INA219_CONFIG_SADCRES_12BIT_1S_532US
+  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_16V | INA219_CONFIG_GAIN_2_80MV | ina219_AdcConfig
                     | INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
   ina219WriteRegister(INA219_REG_CONFIG, config);
 }
@@ -462,7 +479,7 @@ void ina219SetCalibration_16V_200mA(void)
   ina219WriteRegister(INA219_REG_CALIBRATION, ina219_Calfactor);
 
   // Set Config register to take into account the settings above
-  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_16V | INA219_CONFIG_GAIN_1_40MV | INA219_CONFIG_BADCRES_12BIT | INA219_CONFIG_SADCRES_12BIT_1S_532US
+  uint16_t config = INA219_CONFIG_BVOLTAGERANGE_16V | INA219_CONFIG_GAIN_1_40MV | ina219_AdcConfig
                     | INA219_CONFIG_MODE_SANDBVOLT_CONTINUOUS;
   ina219WriteRegister(INA219_REG_CONFIG, config);
 }
@@ -476,6 +493,7 @@ int16_t ina219Init(void)
 {
   // Reset INA219 (set to default values)
   ina219WriteRegister(INA219_REG_CONFIG, INA219_CONFIG_RESET);
+  ina219_AdcConfig = INA219_CONFIG_ADC_DEFAULT;
 
   // Setup chip for 32V and 2A by default
   // ina219SetCalibration_32V_2A();
@@ -582,11 +600,25 @@ int16_t ina219GetCurrent_mA(void)
 /**************************************************************************/
 bool ina219CalibrateCurrent_mA(float ina219current, float meascurrent)
 {
-  uint16_t newcalfactor;
+  return ina219CalibrateCurrent_uA((int32_t)(ina219current * 1000), (int32_t)(meascurrent * 1000));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Same as ina219CalibrateCurrent_mA with current in uA, the new
+            factor is computed on integer with rounding
+*/
+/**************************************************************************/
+bool ina219CalibrateCurrent_uA(int32_t ina219current, int32_t meascurrent)
+{
+  uint32_t newcalfactor;
   uint16_t actualcal;
 
+  if (ina219current <= 0 || meascurrent <= 0) return false;  // no valid ratio
+
   // Compute new calibration factor
-  newcalfactor = ((uint16_t)meascurrent * ina219_Calfactor) / (uint16_t)ina219current;
+  newcalfactor = ((uint64_t)meascurrent * ina219_Calfactor + ina219current / 2) / ina219current;
+  if (newcalfactor > 0xFFFE) newcalfactor = 0xFFFE;  // bit 0 is not used
 
   // verify if the corrected calibration factor is already written or not
   ina219Read16(INA219_REG_CALIBRATION, &actualcal);
@@ -599,4 +631,160 @@ bool ina219CalibrateCurrent_mA(float ina219current, float meascurrent)
   }
 
   return false;
-}
\ No newline at end of file
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts a raw shunt voltage value to current in uA using the
+            calibration written on the device (same formula as the current
+            register: current = shunt * cal / 4096)
+*/
+/**************************************************************************/
+int32_t ina219ShuntToCurrent_uA(int16_t shunt)
+{
+  if (ina219_currentDivider_mA == 0) return 0;  // device not configured
+  return (int32_t)(((int64_t)shunt * ina219_CalActive * 1000) / (4096 * (int64_t)ina219_currentDivider_mA));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the configuration register (range, gain, ADC resolution
+            and averaging, operating mode)
+*/
+/**************************************************************************/
+void ina219SetConfig(uint16_t config)
+{
+  ina219WriteRegister(INA219_REG_CONFIG, config);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the configuration register
+*/
+/**************************************************************************/
+uint16_t ina219GetConfig(void)
+{
+  uint16_t value;
+  ina219Read16(INA219_REG_CONFIG, &value);
+  return value;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Selects the resolution and the number of samples averaged by
+            the device, same setting for bus and shunt ADC. Averaging is
+            available only at 12 bits.
+
+    @param  bits     Resolution, 9 to 12 bits
+    @param  samples  Number of samples averaged, power of 2 from 1 to 128
+    @return false if the combination is not supported
+*/
+/**************************************************************************/
+bool ina219SetAdcMode(uint8_t bits, uint8_t samples)
+{
+  uint8_t code;
+
+  if (samples == 0 || (samples & (samples - 1))) return false;  // power of 2 only
+  if (bits < 9 || bits > 12) return false;
+  if (samples > 1 && bits != 12) return false;
+
+  if (samples == 1)
+  {
+    code = bits - 9;  // 0X00 to 0X11
+  }
+  else
+  {
+    code = 0x08;  // 1000 = 12 bits, add log2(samples)
+    for (uint8_t n = samples; n > 1; n >>= 1) code++;
+  }
+
+  ina219_AdcConfig = INA219_CONFIG_ADC(code);
+  ina219SetConfig((ina219GetConfig() & ~(INA219_CONFIG_BADCRES_MASK | INA219_CONFIG_SADCRES_MASK)) | ina219_AdcConfig);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the ADC setting and the time of one measure (shunt and
+            bus conversion)
+*/
+/**************************************************************************/
+void ina219GetAdcMode(uint8_t* bits, uint8_t* samples, uint32_t* conv_us)
+{
+  uint8_t scode = (ina219_AdcConfig & INA219_CONFIG_SADCRES_MASK) >> 3;
+  uint8_t bcode = (ina219_AdcConfig & INA219_CONFIG_BADCRES_MASK) >> 7;
+
+  if (scode & 0x08)
+  {
+    *bits = 12;
+    *samples = 1 << (scode & 0x07);
+  }
+  else
+  {
+    *bits = 9 + (scode & 0x03);
+    *samples = 1;
+  }
+  *conv_us = ina219ConvTime_us[scode] + ina219ConvTime_us[bcode];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads bus, shunt, current and power registers. With fresh, the
+            conversion is restarted by a write of the config register and
+            the conversion ready bit is polled, the values come from one
+            complete conversion. Values are kept on integer at full
+            resolution of the device.
+
+    @return false if the device is powered down or conversion not ready
+            before the timeout
+*/
+/**************************************************************************/
+bool ina219ReadMeas(ina219_meas_t* m, bool fresh)
+{
+  uint16_t config, bus, power;
+  int16_t shunt, current;
+  uint32_t wait_us = 0;
+  absolute_time_t until;
+
+  if (fresh)
+  {
+    config = ina219GetConfig();
+    if (config & INA219_CONFIG_MODE_SVOLT_TRIGGERED) wait_us += ina219ConvTime_us[(config & INA219_CONFIG_SADCRES_MASK) >> 3];
+    if (config & INA219_CONFIG_MODE_BVOLT_TRIGGERED) wait_us += ina219ConvTime_us[(config & INA219_CONFIG_BADCRES_MASK) >> 7];
+    if (wait_us == 0) return false;  // power down or ADC off
+
+    ina219SetConfig(config);  // restart conversion, CNVR cleared
+    until = make_timeout_time_us(wait_us + INA219_CNVR_MARGIN_US);
+    sleep_us(wait_us);
+    ina219Read16(INA219_REG_BUSVOLTAGE, &bus);
+    while (!(bus & INA219_BUSVOLTAGE_CNVR))
+    {
+      if (time_reached(until)) return false;
+      sleep_us(INA219_CNVR_POLL_US);
+      ina219Read16(INA219_REG_BUSVOLTAGE, &bus);
+    }
+  }
+  else
+  {
+    ina219Read16(INA219_REG_BUSVOLTAGE, &bus);
+  }
+
+  ina219Read16(INA219_REG_SHUNTVOLTAGE, (uint16_t*)&shunt);
+  ina219Read16(INA219_REG_CURRENT, (uint16_t*)&current);
+  ina219Read16(INA219_REG_POWER, &power);  // clear CNVR
+
+  m->bus_mv = (bus >> 3) * 4;
+  m->shunt_uv = shunt * 10;
+  m->overflow = (bus & INA219_BUSVOLTAGE_OVF) != 0;
+  if (ina219_currentDivider_mA == 0)
+  {  // device not calibrated
+    m->current_ua = 0;
+    m->power_uw = 0;
+  }
+  else
+  {
+    m->current_ua = (int32_t)current * 1000 / (int32_t)ina219_currentDivider_mA;
+    m->power_uw = (int32_t)((uint32_t)power * 20000 / ina219_currentDivider_mA);
+  }
+  return true;
+}
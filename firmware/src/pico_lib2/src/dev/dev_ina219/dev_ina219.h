@@ -82,7 +82,11 @@
 #define INA219_CONFIG_SADCRES_12BIT_16S_8510US (0x0060)  /**< 16 x 12-bit shunt samples averaged together */
 #define INA219_CONFIG_SADCRES_12BIT_32S_17MS   (0x0068)  /**< 32 x 12-bit shunt samples averaged together */
 #define INA219_CONFIG_SADCRES_12BIT_64S_34MS   (0x0070)  /**< 64 x 12-bit shunt samples averaged together */
-#define INA219_CONFIG_SADCRES_12BIT_128S_69MS  (0x0078)  /**< 128 x 12-bit shunt samples
+#define INA219_CONFIG_SADCRES_12BIT_128S_69MS  (0x0078)  /**< 128 x 12-bit shunt samples averaged together */
+
+#define INA219_CONFIG_ADC(code)                ((uint16_t)(((code) << 7) | ((code) << 3)))  /**< Same ADC code on bus and shunt */
+#define INA219_CONFIG_ADC_DEFAULT              (INA219_CONFIG_BADCRES_12BIT | INA219_CONFIG_SADCRES_12BIT_1S_532US)  /**< ADC setting after init */
+#define INA219_ADC_MAX_SAMPLES                 (128)  /**< Maximum number of samples averaged by the device */
 
 #define INA219_CONFIG_MODE_MASK                (0x0007)  /**< Operating Mode Mask */
 #define INA219_CONFIG_MODE_POWERDOWN           (0x0000)  /**< Power down mode */
@@ -106,6 +110,10 @@
     BUS VOLTAGE REGISTER (R) 
     -----------------------------------------------------------------------*/ 
 #define INA219_REG_BUSVOLTAGE                  (0x02)  /**< Bus Voltage Register (Read-only) */
+#define INA219_BUSVOLTAGE_CNVR                 (0x0002)  /**< Conversion ready, cleared by read of power register or write of config */
+#define INA219_BUSVOLTAGE_OVF                  (0x0001)  /**< Math overflow, current or power out of range */
+#define INA219_CNVR_POLL_US                    (50)     /**< Period of conversion ready polling */
+#define INA219_CNVR_MARGIN_US                  (2000)   /**< Margin on conversion time before timeout */
 /*=========================================================================*/ 
 
 /*========================================================================= 
@@ -127,6 +135,18 @@
 /*=========================================================================*/ 
 
 
+/**
+ * @brief Measure read on one conversion, full resolution integer values.
+ */
+typedef struct
+{
+  int32_t bus_mv;      /**< Bus voltage in mV (LSB 4 mV) */
+  int32_t shunt_uv;    /**< Shunt voltage in uV (LSB 10 uV) */
+  int32_t current_ua;  /**< Current in uA (LSB from calibration) */
+  int32_t power_uw;    /**< Power in uW (LSB = 20 x current LSB) */
+  bool overflow;       /**< Math overflow on current or power */
+} ina219_meas_t;
+
 int16_t ina219Init(void);
 int16_t ina219GetShuntVoltage(void);
 int16_t ina219GetBusVoltage(void);
@@ -135,6 +155,13 @@ int16_t ina219GetPower_mW(void);
 int16_t ina219GetCurrent(void);
 int16_t ina219GetCurrent_mA(void);
 bool    ina219CalibrateCurrent_mA(float,float);
+bool    ina219CalibrateCurrent_uA(int32_t ina219current, int32_t meascurrent);
+int32_t ina219ShuntToCurrent_uA(int16_t shunt);
+void    ina219SetConfig(uint16_t config);
+uint16_t ina219GetConfig(void);
+bool    ina219SetAdcMode(uint8_t bits, uint8_t samples);
+void    ina219GetAdcMode(uint8_t* bits, uint8_t* samples, uint32_t* conv_us);
+bool    ina219ReadMeas(ina219_meas_t* m, bool fresh);
 void    ina219SetCalibration_32V_2A(void);
 void    ina219SetCalibration_32V_1A(void);
 void    ina219SetCalibration_16V_500mA(void);
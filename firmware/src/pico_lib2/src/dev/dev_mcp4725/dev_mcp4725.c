@@ -28,11 +28,32 @@ static bool mcp4725_write(i2c_inst_t* i2c, uint8_t cmd, uint8_t addr, uint16_t v
   return (sys_i2c_wbuf(i2c, addr, buffer, sizeof(buffer)) == sizeof(buffer));
 }
 
+uint8_t dev_mcp4725_fast_buf(uint16_t value, uint8_t* buffer)
+{
+  if (value > 4095) value = 4095;
+
+  buffer[0] = (dac_pd << 4) | (value >> 8);  // C2 C1 = 00 fast mode, PD1 PD0, D11..D8
+  buffer[1] = value & 0xFF;                  // D7..D0
+  return 2;
+}
+
+bool dev_mcp4725_set_fast(i2c_inst_t* i2c, uint8_t addr, uint16_t value)
+{
+  uint8_t buffer[2];
+
+  return (sys_i2c_wbuf(i2c, addr, buffer, dev_mcp4725_fast_buf(value, buffer)) == sizeof(buffer));
+}
+
 bool dev_mcp4725_set_raw(i2c_inst_t* i2c, uint8_t addr, uint16_t value)
 {
   return mcp4725_write(i2c, WRITEDAC, addr, value);
 }
 
+bool dev_mcp4725_save_raw(i2c_inst_t* i2c, uint8_t addr, uint16_t value)
+{
+  return mcp4725_write(i2c, WRITEDACEEPROM, addr, value);
+}
+
 bool dev_mcp4725_set(i2c_inst_t* i2c, uint8_t addr, float volt)
 {
   uint16_t value = 0;
@@ -59,6 +80,14 @@ bool dev_mcp4725_save(i2c_inst_t* i2c, uint8_t addr, float volt)
   return mcp4725_write(i2c, WRITEDACEEPROM, addr, value);
 }
 
+uint16_t dev_mcp4725_get_raw(i2c_inst_t* i2c, uint8_t addr)
+{
+  uint8_t value[5];
+
+  sys_i2c_rbuf(i2c, addr, value, sizeof(value));  // Read 5 bytes
+  return (value[1] << 4) + (value[2] >> 4);       // transform 8 bits value in 12 bits result
+}
+
 float dev_mcp4725_get(i2c_inst_t* i2c, uint8_t addr)
 {
   uint8_t value[5];
@@ -82,6 +82,38 @@ extern "C"
   */
   bool dev_mcp4725_set_raw(i2c_inst_t* i2c, uint8_t addr, uint16_t value);
 
+  /*! @brief - Builds the 2 bytes fast mode write of dac register (no EEPROM)
+      @param value Output value for channel (0..4095)
+      @param buffer Buffer of 2 bytes receiving the command
+      @return Number of bytes of the command
+  */
+  uint8_t dev_mcp4725_fast_buf(uint16_t value, uint8_t* buffer);
+
+  /*! @brief - Sets adc output with fast mode write (2 bytes)
+      @param i2c I2C channel i2c0 or i2c1
+      @param addr I2C address MCP4725_ADDRn
+      @param value Output value for channel (0..4095)
+      @return true
+      @return[error] false
+  */
+  bool dev_mcp4725_set_fast(i2c_inst_t* i2c, uint8_t addr, uint16_t value);
+
+  /*! @brief - Sets adc output and save settings to EEPROM (50ms)
+      @param i2c I2C channel i2c0 or i2c1
+      @param addr I2C address MCP4725_ADDRn
+      @param value Output value for channel (0..4095)
+      @return true
+      @return[error] false
+  */
+  bool dev_mcp4725_save_raw(i2c_inst_t* i2c, uint8_t addr, uint16_t value);
+
+  /*! @brief - Reads dac output register
+      @param i2c I2C channel i2c0 or i2c1
+      @param addr I2C address MCP4725_ADDRn
+      @return Output value of channel (0..4095)
+  */
+  uint16_t dev_mcp4725_get_raw(i2c_inst_t* i2c, uint8_t addr);
+
   /*!
       @brief Sets the ADC output for the MCP4725.
 
@@ -23,6 +23,7 @@
     @section ADC MODIFICATIONS
 
     - fix documentation errors found by Doxygen
+    - add integer functions sys_adc_uv and sys_adc_temp_mc, double functions use them
 **************************************************************************/
 
 #ifndef _SYS_ADC_H_
@@ -75,6 +76,14 @@
  */
 #define ADC_VREF 3.3
 
+/*! 
+ * @def ADC_VREF_UV
+ * @brief ADC reference voltage in microvolt.
+ *
+ * Used by the integer conversion functions.
+ */
+#define ADC_VREF_UV 3300000
+
 
 
 /*! $## **Functions:**
@@ -100,6 +109,17 @@ uint16_t sys_adc_raw(uint8_t ch);
 */
 double sys_adc_scale(uint8_t ch, double low, double high);
 
+/*! @brief - Read ADC voltage value without floating point
+    @param ch ADC channel
+    @return ADC voltage value in uV 0..3300000 (VREF)
+*/
+uint32_t sys_adc_uv(uint8_t ch);
+
+/*! @brief - Read ADC internal temp. sensor without floating point
+    @return Temp. value in milli celsius
+*/
+int32_t sys_adc_temp_mc();
+
 /*! @brief - Read ADC voltage value
     @param ch ADC channel
     @return ADC voltage value 0..3.3V (VREF)
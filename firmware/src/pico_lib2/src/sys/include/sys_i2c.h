@@ -27,6 +27,11 @@
     @section I2C MODIFICATIONS
 
     - fix documentation errors found by Doxygen
+    - add bus recovery, bounded retry and error counters per address
+    - add speed per device address with fallback on repeated errors
+    - add functions shared with asynchronous transfer (sys_i2c_async)
+    - add bus ownership flag, transfer from interrupt must check sys_i2c_busy
+    - bus ownership taken atomically (sys_i2c_take), held by an asynchronous frame from begin to end of frame
 **************************************************************************/
 
 
@@ -53,6 +58,51 @@
 */
 #define I2C_TIMEOUT_CHAR 500
 
+/*!
+    @def SYS_I2C_RECOVER_US
+    @brief Half period of the clock used during bus recovery.
+    @details Time in microseconds between each level change of SCL while the bus is cleared.
+    @n
+*/
+#define SYS_I2C_RECOVER_US 5
+
+/*!
+    @def SYS_I2C_NB_ADDR
+    @brief Number of 7 bits addresses.
+    @details Size of the table of error counters, one entry per device address.
+    @n
+*/
+#define SYS_I2C_NB_ADDR 128
+
+/*!
+    @def SYS_I2C_FAST_BAUD
+    @brief I2C fast mode baudrate.
+    @details Intermediate speed used when a device fail at a higher speed.
+    @n
+*/
+#define SYS_I2C_FAST_BAUD 400000
+
+/*!
+    @def SYS_I2C_FALLBACK_ERR
+    @brief Number of consecutive errors before speed reduction.
+    @details After this number of failed transfer, the speed of the device is reduced.
+    @n
+*/
+#define SYS_I2C_FALLBACK_ERR 3
+
+/*! $## **Types:**
+    @--
+*/
+
+/*! @brief Error counters of a device address
+*/
+typedef struct
+{
+    uint16_t nack;      //!< Number of transfer not acknowledged
+    uint16_t timeout;   //!< Number of transfer stopped by timeout
+    uint16_t recovery;  //!< Number of bus recovery executed
+} sys_i2c_stat_t;
+
 
 /*!
     @def SYS_SDA0
@@ -114,6 +164,117 @@ void sys_i2c_init(i2c_inst_t* i2c, uint32_t sda, uint32_t scl, uint32_t baudrate
 */
 void sys_i2c_init_def(i2c_inst_t* i2c, uint32_t baudrate, bool pullup);
 
+/*! @brief - Set speed used to communicate with a device.
+             The bus baudrate is changed before each transfer to the device.
+             After repeated errors, the speed is reduced to fast mode then to bus default.
+             Only available on i2c initialized by sys_i2c_init.
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @param baudrate Baudrate in Hz, 0 to use bus default
+*/
+void sys_i2c_setspeed(i2c_inst_t* i2c, uint8_t addr, uint32_t baudrate);
+
+/*! @brief - Get speed used to communicate with a device
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @return Baudrate in Hz
+*/
+uint32_t sys_i2c_getspeed(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Set number of retry executed after a failed transfer
+    @param i2c I2C channel i2c0 or i2c1
+    @param retry Number of retry, 0 to disable
+*/
+void sys_i2c_setretry(i2c_inst_t* i2c, uint8_t retry);
+
+/*! @brief - Get number of retry executed after a failed transfer
+    @param i2c I2C channel i2c0 or i2c1
+    @return Number of retry
+*/
+uint8_t sys_i2c_getretry(i2c_inst_t* i2c);
+
+/*! @brief - Prepare the bus for a transfer: take the bus, wait end of asynchronous
+             transfer if the bus is owned, and set the speed of the device
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+*/
+void sys_i2c_select(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Take the bus without wait, the test and set is done with interrupts disabled.
+             Can be called from interrupt.
+    @param i2c I2C channel i2c0 or i2c1
+    @return true if the bus was free and is now owned by the caller
+*/
+bool sys_i2c_take(i2c_inst_t* i2c);
+
+/*! @brief - Release the bus taken by sys_i2c_take or sys_i2c_select
+    @param i2c I2C channel i2c0 or i2c1
+*/
+void sys_i2c_release(i2c_inst_t* i2c);
+
+/*! @brief - Set the speed of a device on the bus, without wait.
+             The bus must be owned by the caller, used by the asynchronous transfer to
+             restart a frame from interrupt.
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+*/
+void sys_i2c_claim(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Update error counters and speed of a device with the result of a transfer.
+             The bus stay owned by the caller.
+             Recover the bus if the transfer stopped by timeout, the recovery wait on the
+             bus lines: a timeout must not be accounted from interrupt.
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @param ret Result of the transfer, negative on error
+*/
+void sys_i2c_account(i2c_inst_t* i2c, uint8_t addr, int32_t ret);
+
+/*! @brief - Clear a stuck bus. Clock out 9 SCL pulses until SDA is released,
+             generate a STOP and restart the i2c controller.
+             Only available on i2c initialized by sys_i2c_init.
+    @param i2c I2C channel i2c0 or i2c1
+    @return true if bus is free after recovery
+*/
+bool sys_i2c_recover(i2c_inst_t* i2c);
+
+/*! @brief - Check if the bus is used by a transfer. A transfer started from
+             interrupt (timer) must be delayed if the bus is busy.
+             Status read only, can be called from interrupt.
+    @param i2c I2C channel i2c0 or i2c1
+    @return true if the bus is owned by a blocking transfer or an asynchronous frame
+*/
+bool sys_i2c_busy(i2c_inst_t* i2c);
+
+/*! @brief - Check if a device acknowledge its address, without retry.
+             A NACK is not counted as error, used to poll a busy device
+             (ex: eeprom on write cycle).
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @return true if the device acknowledged
+*/
+bool sys_i2c_probe(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Read one byte at the speed of the device, without retry and without
+             update of the error counters and speed fallback. Used to test a speed.
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @return true if the read completed
+*/
+bool sys_i2c_test(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Read error counters of a device address
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @return Counters of NACK, timeout and bus recovery
+*/
+sys_i2c_stat_t sys_i2c_getstat(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Clear error counters of all addresses
+    @param i2c I2C channel i2c0 or i2c1
+*/
+void sys_i2c_clearstat(i2c_inst_t* i2c);
+
 /*! $## **Byte functions:**
     @--
     @n
@@ -0,0 +1,132 @@
+/**
+ * @file    sys_i2c_async.h
+ *
+ * @brief   Asynchronous I2C Functions Module
+ *
+ * @details This module provides I2C transfer executed by DMA and interrupt:
+ *   - A frame (write and read segments) is built then started.
+ *   - The CPU is free during the transfer, completion is signaled by callback or wait.
+ *   - Error counters, speed and bus recovery are shared with sys_i2c.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#ifndef _SYS_I2C_ASYNC_H_
+#define _SYS_I2C_ASYNC_H_
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardware/i2c.h"
+
+/*! $## **Constants:**
+    @--
+*/
+
+/*!
+    @def SYS_I2C_ASYNC_MAX
+    @brief Maximum number of bytes on a frame.
+    @details Total of bytes written and read on a single asynchronous frame.
+    @n
+*/
+#define SYS_I2C_ASYNC_MAX 32
+
+/*! $## **Types:**
+    @--
+*/
+
+/*! @brief Completion callback, called from interrupt when the frame is completed
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @param status Bytes read (or written if no read), negative on error
+    @param user User data given on start
+*/
+typedef void (*sys_i2c_async_cb_t)(i2c_inst_t* i2c, uint8_t addr, int32_t status, void* user);
+
+/*! $## **Asynchronous transfer:**
+    @--
+    @n
+*/
+
+/*! @brief - Claim DMA channels and install interrupt handler.
+             The i2c must be initialized before.
+    @param i2c I2C channel i2c0 or i2c1
+    @return true if asynchronous transfer is available
+*/
+bool sys_i2c_async_init(i2c_inst_t* i2c);
+
+/*! @brief - Begin a new frame. Wait the bus, the bus is owned by the frame until its end
+             (or until start return an error)
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+*/
+void sys_i2c_async_begin(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Begin a new frame if the bus is free, without wait. Used from interrupt (timer
+             or completion callback), the frame can not be modified by another transfer
+             between begin and start.
+    @param i2c I2C channel i2c0 or i2c1
+    @param addr I2C address
+    @return true if the bus is owned by the frame, false if the bus is used
+*/
+bool sys_i2c_async_try_begin(i2c_inst_t* i2c, uint8_t addr);
+
+/*! @brief - Add a write segment to the frame
+    @param i2c I2C channel i2c0 or i2c1
+    @param pBuf Buffer to write, copied on the frame
+    @param len Length to write
+    @param stop If true generate STOP after the segment
+    @return true if segment added
+*/
+bool sys_i2c_async_write(i2c_inst_t* i2c, const uint8_t* pBuf, uint32_t len, bool stop);
+
+/*! @brief - Add the read segment to the frame, must be the last segment.
+             A RESTART is generated if previous segment has no STOP
+    @param i2c I2C channel i2c0 or i2c1
+    @param pBuf Buffer to read, must stay valid until end of frame
+    @param len Length to read
+    @return true if segment added
+*/
+bool sys_i2c_async_read(i2c_inst_t* i2c, uint8_t* pBuf, uint32_t len);
+
+/*! @brief - Start the frame on the bus and return immediately
+    @param i2c I2C channel i2c0 or i2c1
+    @param cb Completion callback, NULL if not used
+    @param user User data given to callback
+    @return PICO_OK if frame started
+    @return[error] PICO_ERROR_GENERIC If asynchronous transfer not initialized or frame empty, the bus is released
+*/
+int32_t sys_i2c_async_start(i2c_inst_t* i2c, sys_i2c_async_cb_t cb, void* user);
+
+/*! @brief - Check if a frame is on the bus. Status read only, can be called from interrupt
+    @param i2c I2C channel i2c0 or i2c1
+    @return true if frame not completed
+*/
+bool sys_i2c_async_busy(i2c_inst_t* i2c);
+
+/*! @brief - Check the deadline of a frame started from interrupt, recover the bus on timeout.
+             Called by the main loop, the recovery can not be done from interrupt.
+    @param i2c I2C channel i2c0 or i2c1
+*/
+void sys_i2c_async_event(i2c_inst_t* i2c);
+
+/*! @brief - Wait end of frame. On timeout, the bus is recovered.
+             On error, frame is restarted up to the number of retry of the bus
+    @param i2c I2C channel i2c0 or i2c1
+    @return Bytes read (or written if no read)
+    @return[error] PICO_ERROR_GENERIC On error
+    @return[error] PICO_ERROR_TIMEOUT On timeout
+*/
+int32_t sys_i2c_async_wait(i2c_inst_t* i2c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif   // _SYS_I2C_ASYNC_H_
@@ -49,6 +49,17 @@ uint16_t sys_adc_raw(uint8_t ch)
   return adc_read();
 }
 
+uint32_t sys_adc_uv(uint8_t ch)
+{
+  return (uint32_t)(((uint64_t)sys_adc_raw(ch) * ADC_VREF_UV + 2047) / 4095);  // 64 bits, 4095 * 3300000 overflow 32 bits
+}
+
+int32_t sys_adc_temp_mc()
+{
+  // 27 - (V - 0.706) / 0.001721 computed in uV, result in milli celsius
+  return 27000 - (int32_t)((((int64_t)sys_adc_uv(ADC_CH_T) - 706000) * 1000) / 1721);
+}
+
 double sys_adc_scale(uint8_t ch, double low, double high)
 {
   return ((double)sys_adc_raw(ch)) * ((high - low) / 4095.0) + low;
@@ -56,17 +67,17 @@ double sys_adc_scale(uint8_t ch, double low, double high)
 
 double sys_adc_volt(uint8_t ch)
 {
-  return ((double)sys_adc_raw(ch)) * (ADC_VREF / 4095.0);
+  return sys_adc_uv(ch) * 1E-6;
 }
 
 double sys_adc_vsys()
 {
-  return sys_adc_volt(ADC_CH_V) * 3.0;
+  return sys_adc_uv(ADC_CH_V) * 3E-6;
 }
 
 double sys_adc_temp_c()
 {
-  return 27.0 - ((sys_adc_volt(ADC_CH_T) - 0.706) / 0.001721);
+  return sys_adc_temp_mc() * 1E-3;
 }
 
 double sys_adc_temp_f()
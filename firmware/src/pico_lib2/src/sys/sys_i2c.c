@@ -1,12 +1,16 @@
 // Copyright 2021 Ocean (iiot2k@gmail.com)
 // All rights reserved.
 // eeprom support addition by dlock8
+// bus recovery, retry, error counters and speed per device addition by dlock8
+// bus ownership flag for transfer started from interrupt addition by dlock8
 
 #include "pico/stdlib.h"
 #include "pico/mutex.h"
+#include "hardware/sync.h"
 
 #include "sys_gpio.h"
 #include "sys_i2c.h"
+#include "sys_i2c_async.h"
 
 // mutex for i2c
 auto_init_mutex(i2c_mutex);
@@ -15,6 +19,226 @@ auto_init_mutex(i2c_mutex);
 #define EXIT_SECTION mutex_exit(&i2c_mutex);
 
 static uint32_t i2c_baudrate[] = {0, 0};
+static uint32_t i2c_defbaud[] = {0, 0};   // baudrate set by sys_i2c_init, used if device has no speed
+static uint32_t i2c_sda[] = {0, 0};       // sda pin recorded by sys_i2c_init, used for bus recovery
+static uint32_t i2c_scl[] = {0, 0};       // scl pin recorded by sys_i2c_init, used for bus recovery
+static bool i2c_pins_set[] = {false, false};  // true if pins are known, bus recovery allowed
+static uint8_t i2c_retry[] = {0, 0};      // number of retry allowed after a failed transfer
+
+static sys_i2c_stat_t i2c_stat[2][SYS_I2C_NB_ADDR];  // error counters per device address
+static uint32_t i2c_speed[2][SYS_I2C_NB_ADDR];       // baudrate per device address, 0 = bus default
+static uint8_t i2c_errseq[2][SYS_I2C_NB_ADDR];       // consecutive errors per device address
+static volatile bool i2c_active[] = {false, false};  // bus owned by a transfer, set by take and cleared by release
+
+bool sys_i2c_take(i2c_inst_t* i2c)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  uint32_t save = save_and_disable_interrupts();  // test and set, interrupt could take the bus
+  bool free = !i2c_active[idx];
+
+  i2c_active[idx] = true;
+  restore_interrupts(save);
+  return free;
+}
+
+void sys_i2c_release(i2c_inst_t* i2c)
+{
+  i2c_active[(i2c == i2c0) ? 0 : 1] = false;
+}
+
+void sys_i2c_select(i2c_inst_t* i2c, uint8_t addr)
+{
+  while (!sys_i2c_take(i2c))
+  {
+    sys_i2c_async_wait(i2c);  // bus owned by an asynchronous frame, released at the end of frame
+    tight_loop_contents();
+  }
+  sys_i2c_claim(i2c, addr);
+}
+
+void sys_i2c_claim(i2c_inst_t* i2c, uint8_t addr)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  uint32_t baud = i2c_speed[idx][addr & (SYS_I2C_NB_ADDR - 1)];
+
+  if (!i2c_pins_set[idx]) return;  // bus not initialized by sys_i2c_init, keep actual baudrate
+
+  sys_i2c_setbaudrate(i2c, baud ? baud : i2c_defbaud[idx]);
+}
+
+// Reduce the speed of a device after repeated errors
+static void sys_i2c_fallback(i2c_inst_t* i2c, uint8_t addr, int32_t ret)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  addr &= (SYS_I2C_NB_ADDR - 1);
+
+  if (ret >= 0)
+  {
+    i2c_errseq[idx][addr] = 0;  // transfer ok, restart the sequence
+    return;
+  }
+
+  if (++i2c_errseq[idx][addr] < SYS_I2C_FALLBACK_ERR) return;
+  i2c_errseq[idx][addr] = 0;
+
+  // step down: fast mode plus -> fast mode -> bus default
+  if (i2c_speed[idx][addr] > SYS_I2C_FAST_BAUD && SYS_I2C_FAST_BAUD > i2c_defbaud[idx])
+    i2c_speed[idx][addr] = SYS_I2C_FAST_BAUD;
+  else
+    i2c_speed[idx][addr] = 0;
+}
+
+void sys_i2c_account(i2c_inst_t* i2c, uint8_t addr, int32_t ret)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  sys_i2c_stat_t* stat = &i2c_stat[idx][addr & (SYS_I2C_NB_ADDR - 1)];
+
+  sys_i2c_fallback(i2c, addr, ret);  // adjust device speed on repeated errors
+
+  if (ret == PICO_ERROR_TIMEOUT)
+  {
+    stat->timeout++;
+    // device could hold sda low in the middle of a byte, release the bus before next transfer
+    if (sys_i2c_recover(i2c)) stat->recovery++;
+  }
+  else if (ret < 0)
+  {
+    stat->nack++;  // address or data not acknowledged
+  }
+}
+
+bool sys_i2c_busy(i2c_inst_t* i2c)
+{
+  return i2c_active[(i2c == i2c0) ? 0 : 1];  // asynchronous frame own the bus from begin to end of frame
+}
+
+bool sys_i2c_probe(i2c_inst_t* i2c, uint8_t addr)
+{
+  int32_t ret;
+  uint8_t rb;
+  ENTER_SECTION;
+  sys_i2c_select(i2c, addr);
+  ret = i2c_read_timeout_us(i2c, addr, &rb, 1, false, I2C_TIMEOUT_CHAR);
+  sys_i2c_account(i2c, addr, (ret == PICO_ERROR_GENERIC) ? 0 : ret);  // nack is the answer, not a bus error
+  sys_i2c_release(i2c);
+  EXIT_SECTION;
+  return ret >= 0;
+}
+
+bool sys_i2c_test(i2c_inst_t* i2c, uint8_t addr)
+{
+  int32_t ret;
+  uint8_t rb;
+  ENTER_SECTION;
+  sys_i2c_select(i2c, addr);
+  ret = i2c_read_timeout_us(i2c, addr, &rb, 1, false, I2C_TIMEOUT_CHAR);
+  if (ret == PICO_ERROR_TIMEOUT) sys_i2c_recover(i2c);  // release the bus, not counted as device error
+  sys_i2c_release(i2c);
+  EXIT_SECTION;
+  return ret >= 0;
+}
+
+// Update error counters and recover the bus on timeout
+// return true if the transfer must be executed again
+static bool sys_i2c_retry(i2c_inst_t* i2c, uint8_t addr, int32_t ret, uint8_t* count)
+{
+  sys_i2c_account(i2c, addr, ret);
+  sys_i2c_release(i2c);  // taken again by select on retry
+
+  if (ret >= 0) return false;  // transfer completed
+
+  return (*count)++ < sys_i2c_getretry(i2c);
+}
+
+bool sys_i2c_recover(i2c_inst_t* i2c)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  uint32_t sda = i2c_sda[idx];
+  uint32_t scl = i2c_scl[idx];
+
+  if (!i2c_pins_set[idx]) return false;  // pins unknown, recovery not possible
+
+  i2c_deinit(i2c);  // release the controller, abort pending transfer
+
+  // emulate open drain: output low or input (pull-up)
+  gpio_put(sda, 0);
+  gpio_put(scl, 0);
+  gpio_set_dir(sda, GPIO_IN);
+  gpio_set_dir(scl, GPIO_IN);
+  gpio_set_function(sda, GPIO_FUNC_SIO);
+  gpio_set_function(scl, GPIO_FUNC_SIO);
+  sleep_us(SYS_I2C_RECOVER_US);
+
+  // clock out up to 9 bits until the device release sda
+  for (uint8_t i = 0; i < 9 && !gpio_get(sda); i++)
+  {
+    gpio_set_dir(scl, GPIO_OUT);  // scl low
+    sleep_us(SYS_I2C_RECOVER_US);
+    gpio_set_dir(scl, GPIO_IN);  // scl high
+    sleep_us(SYS_I2C_RECOVER_US);
+  }
+
+  // generate STOP: sda low to high while scl is high
+  gpio_set_dir(scl, GPIO_OUT);
+  sleep_us(SYS_I2C_RECOVER_US);
+  gpio_set_dir(sda, GPIO_OUT);
+  sleep_us(SYS_I2C_RECOVER_US);
+  gpio_set_dir(scl, GPIO_IN);
+  sleep_us(SYS_I2C_RECOVER_US);
+  gpio_set_dir(sda, GPIO_IN);
+  sleep_us(SYS_I2C_RECOVER_US);
+
+  bool free = gpio_get(sda) && gpio_get(scl);  // bus is idle if both lines are high
+
+  // give pins back to the i2c controller
+  gpio_set_function(sda, GPIO_FUNC_I2C);
+  gpio_set_function(scl, GPIO_FUNC_I2C);
+  i2c_init(i2c, i2c_baudrate[idx]);
+
+  return free;
+}
+
+void sys_i2c_setretry(i2c_inst_t* i2c, uint8_t retry)
+{
+  i2c_retry[(i2c == i2c0) ? 0 : 1] = retry;
+}
+
+uint8_t sys_i2c_getretry(i2c_inst_t* i2c)
+{
+  return i2c_retry[(i2c == i2c0) ? 0 : 1];
+}
+
+sys_i2c_stat_t sys_i2c_getstat(i2c_inst_t* i2c, uint8_t addr)
+{
+  return i2c_stat[(i2c == i2c0) ? 0 : 1][addr & (SYS_I2C_NB_ADDR - 1)];
+}
+
+void sys_i2c_clearstat(i2c_inst_t* i2c)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+
+  for (uint32_t i = 0; i < SYS_I2C_NB_ADDR; i++)
+  {
+    i2c_stat[idx][i].nack = 0;
+    i2c_stat[idx][i].timeout = 0;
+    i2c_stat[idx][i].recovery = 0;
+  }
+}
+
+void sys_i2c_setspeed(i2c_inst_t* i2c, uint8_t addr, uint32_t baudrate)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  i2c_speed[idx][addr & (SYS_I2C_NB_ADDR - 1)] = baudrate;
+  i2c_errseq[idx][addr & (SYS_I2C_NB_ADDR - 1)] = 0;
+}
+
+uint32_t sys_i2c_getspeed(i2c_inst_t* i2c, uint8_t addr)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  uint32_t baud = i2c_speed[idx][addr & (SYS_I2C_NB_ADDR - 1)];
+
+  return baud ? baud : i2c_defbaud[idx];
+}
 
 void sys_i2c_setbaudrate(i2c_inst_t* i2c, uint32_t baudrate)
 {
@@ -34,6 +258,7 @@ void sys_i2c_init(i2c_inst_t* i2c, uint32_t sda, uint32_t scl, uint32_t baudrate
 
   // init i2c
   i2c_baudrate[idx] = baudrate;
+  i2c_defbaud[idx] = baudrate;
 
   i2c_init(i2c, baudrate);
 
@@ -46,6 +271,11 @@ void sys_i2c_init(i2c_inst_t* i2c, uint32_t sda, uint32_t scl, uint32_t baudrate
     sys_gpio_setpullup(sda);
     sys_gpio_setpullup(scl);
   }
+
+  // save pins for bus recovery
+  i2c_sda[idx] = sda;
+  i2c_scl[idx] = scl;
+  i2c_pins_set[idx] = true;
 }
 
 void sys_i2c_init_def(i2c_inst_t* i2c, uint32_t baudrate, bool pullup)
@@ -58,42 +288,76 @@ void sys_i2c_init_def(i2c_inst_t* i2c, uint32_t baudrate, bool pullup)
 
 int32_t sys_i2c_rbyte(i2c_inst_t* i2c, uint8_t addr, uint8_t* rb)
 {
-  return i2c_read_timeout_us(i2c, addr, rb, 1, false, I2C_TIMEOUT_CHAR);
+  int32_t ret;
+  uint8_t count = 0;
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    ret = i2c_read_timeout_us(i2c, addr, rb, 1, false, I2C_TIMEOUT_CHAR);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
+  return ret;
 }
 
 int32_t sys_i2c_rbyte_reg(i2c_inst_t* i2c, uint8_t addr, uint8_t reg, uint8_t* rb)
 {
+  int32_t ret;
+  uint8_t count = 0;
   ENTER_SECTION;
-  int32_t ret = i2c_write_timeout_us(i2c, addr, &reg, 1, true, I2C_TIMEOUT_CHAR);  // nostop = true
-  if (ret > 0) ret = i2c_read_timeout_us(i2c, addr, rb, 1, false, I2C_TIMEOUT_CHAR);
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    absolute_time_t until = make_timeout_time_us(2 * I2C_TIMEOUT_CHAR);  // deadline for complete operation
+    ret = i2c_write_blocking_until(i2c, addr, &reg, 1, true, until);  // nostop = true
+    if (ret > 0) ret = i2c_read_blocking_until(i2c, addr, rb, 1, false, until);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   EXIT_SECTION;
   return ret;
 }
 
 int32_t sys_i2c_wbyte(i2c_inst_t* i2c, uint8_t addr, uint8_t wb)
 {
-  return i2c_write_timeout_us(i2c, addr, &wb, 1, false, I2C_TIMEOUT_CHAR);
+  int32_t ret;
+  uint8_t count = 0;
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    ret = i2c_write_timeout_us(i2c, addr, &wb, 1, false, I2C_TIMEOUT_CHAR);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
+  return ret;
 }
 
 int32_t sys_i2c_wbyte_reg(i2c_inst_t* i2c, uint8_t addr, uint8_t reg, uint8_t wb)
 {
+  int32_t ret;
+  uint8_t count = 0;
   ENTER_SECTION;
   uint8_t buffer[2];
   buffer[0] = reg;
   buffer[1] = wb;
-  uint8_t ret = i2c_write_timeout_us(i2c, addr, buffer, 2, false, 2 * I2C_TIMEOUT_CHAR);
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    ret = i2c_write_timeout_us(i2c, addr, buffer, 2, false, 2 * I2C_TIMEOUT_CHAR);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   EXIT_SECTION;
   return ret;
 }
 
 int32_t sys_i2c_wbuf_rbuf(i2c_inst_t* i2c, uint8_t addr, uint8_t* wBuf, uint32_t wlen, uint8_t* rBuf, uint32_t rlen)
 {
+  int32_t ret;
+  uint8_t count = 0;
   ENTER_SECTION;
-  int32_t ret = i2c_write_timeout_us(i2c, addr, wBuf, wlen, true, wlen * I2C_TIMEOUT_CHAR);
-  if (ret > 0)
+  do
   {
-    ret = i2c_read_timeout_us(i2c, addr, rBuf, rlen, false, rlen * I2C_TIMEOUT_CHAR);
-  }
+    sys_i2c_select(i2c, addr);
+    absolute_time_t until = make_timeout_time_us((wlen + rlen) * I2C_TIMEOUT_CHAR);  // deadline for complete operation
+    ret = i2c_write_blocking_until(i2c, addr, wBuf, wlen, true, until);
+    if (ret > 0)
+    {
+      ret = i2c_read_blocking_until(i2c, addr, rBuf, rlen, false, until);
+    }
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   EXIT_SECTION;
 
   return ret;
@@ -101,38 +365,72 @@ int32_t sys_i2c_wbuf_rbuf(i2c_inst_t* i2c, uint8_t addr, uint8_t* wBuf, uint32_t
 
 int32_t sys_i2c_rbuf(i2c_inst_t* i2c, uint8_t addr, uint8_t* pBuf, uint32_t len)
 {
-  int32_t ret = i2c_read_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  int32_t ret;
+  uint8_t count = 0;
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    ret = i2c_read_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   return ret;
 }
 
 int32_t sys_i2c_rbuf_reg(i2c_inst_t* i2c, uint8_t addr, uint8_t reg, uint8_t* pBuf, uint32_t len)
 {
+  int32_t ret;
+  uint8_t count = 0;
   ENTER_SECTION;
-  int32_t ret = i2c_write_timeout_us(i2c, addr, &reg, 1, true, I2C_TIMEOUT_CHAR);
-  if (ret > 0) ret = i2c_read_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    absolute_time_t until = make_timeout_time_us((len + 1) * I2C_TIMEOUT_CHAR);  // deadline for complete operation
+    ret = i2c_write_blocking_until(i2c, addr, &reg, 1, true, until);
+    if (ret > 0) ret = i2c_read_blocking_until(i2c, addr, pBuf, len, false, until);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   EXIT_SECTION;
   return ret;
 }
 
 int32_t sys_i2c_wbuf(i2c_inst_t* i2c, uint8_t addr, const uint8_t* pBuf, uint32_t len)
 {
-  return i2c_write_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  int32_t ret;
+  uint8_t count = 0;
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    ret = i2c_write_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
+  return ret;
 }
 
 int32_t sys_i2c_wbuf_reg(i2c_inst_t* i2c, uint8_t addr, uint8_t reg, uint8_t* pBuf, uint32_t len)
 {
+  int32_t ret;
+  uint8_t count = 0;
   ENTER_SECTION;
-  int32_t ret = i2c_write_timeout_us(i2c, addr, &reg, 1, true, I2C_TIMEOUT_CHAR);  // was true
-  if (ret > 0) ret = i2c_write_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    absolute_time_t until = make_timeout_time_us((len + 1) * I2C_TIMEOUT_CHAR);  // deadline for complete operation
+    ret = i2c_write_blocking_until(i2c, addr, &reg, 1, true, until);  // was true
+    if (ret > 0) ret = i2c_write_blocking_until(i2c, addr, pBuf, len, false, until);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   EXIT_SECTION;
   return ret;
 }
 
 int32_t sys_i2c_rbyte_eeprom(i2c_inst_t* i2c, uint8_t addr, uint8_t* ee_address, uint8_t* pBuf, uint32_t len)
 {
+  int32_t ret;
+  uint8_t count = 0;
   ENTER_SECTION;
-  int32_t ret = i2c_write_timeout_us(i2c, addr, ee_address, 2, true, I2C_TIMEOUT_CHAR);
-  if (ret > 0) ret = i2c_read_timeout_us(i2c, addr, pBuf, len, false, len * I2C_TIMEOUT_CHAR);
+  do
+  {
+    sys_i2c_select(i2c, addr);
+    absolute_time_t until = make_timeout_time_us((len + 2) * I2C_TIMEOUT_CHAR);  // deadline for complete operation
+    ret = i2c_write_blocking_until(i2c, addr, ee_address, 2, true, until);
+    if (ret > 0) ret = i2c_read_blocking_until(i2c, addr, pBuf, len, false, until);
+  } while (sys_i2c_retry(i2c, addr, ret, &count));
   EXIT_SECTION;
   return ret;
 }
@@ -0,0 +1,354 @@
+// Copyright (c) 2024, D.Lockhead. All rights reserved.
+// asynchronous i2c transfer using DMA and interrupt
+
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#include "sys_i2c.h"
+#include "sys_i2c_async.h"
+
+// state of asynchronous transfer for one i2c
+typedef struct
+{
+  bool ready;                       // DMA channels and interrupt installed
+  volatile bool busy;               // frame on the bus
+  volatile int32_t status;          // result of last frame
+  int dma_tx;                       // DMA channel feeding data_cmd register
+  int dma_rx;                       // DMA channel reading data_cmd register
+  uint8_t addr;                     // device address
+  uint32_t cmd[SYS_I2C_ASYNC_MAX];  // data_cmd words of the frame
+  uint32_t ncmd;                    // number of words on the frame
+  uint32_t nwrite;                  // number of bytes written
+  uint8_t nstop;                    // number of STOP on the frame
+  volatile uint8_t stop_cnt;        // number of STOP detected
+  volatile bool stop_seen;          // last STOP detected, frame done when the rx DMA is completed
+  bool last_stop;                   // last segment added ends with STOP
+  uint8_t* rbuf;                    // read buffer
+  uint32_t rlen;                    // number of bytes to read
+  uint8_t retry;                    // retry executed on the frame
+  absolute_time_t until;            // deadline of the frame
+  sys_i2c_async_cb_t cb;            // completion callback
+  void* user;                       // user data for callback
+} sys_i2c_async_t;
+
+static sys_i2c_async_t async_i2c[2];
+
+static void sys_i2c_async_run(i2c_inst_t* i2c);
+static void sys_i2c_async_complete(i2c_inst_t* i2c);
+
+// Restart the frame after an error if retry is allowed, no wait: called from interrupt
+static bool sys_i2c_async_retry(i2c_inst_t* i2c)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  if (as->retry++ >= sys_i2c_getretry(i2c)) return false;
+
+  sys_i2c_claim(i2c, as->addr);  // bus still owned by the frame, speed could be reduced after repeated errors
+  sys_i2c_async_run(i2c);
+  return true;
+}
+
+// Frame completed, call user callback
+static void sys_i2c_async_done(i2c_inst_t* i2c, int32_t status)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  i2c_get_hw(i2c)->intr_mask = 0;  // no interrupt outside of frame
+  as->status = status;
+  as->busy = false;
+  sys_i2c_release(i2c);  // callback could begin the next frame
+
+  if (as->cb) as->cb(i2c, as->addr, status, as->user);
+}
+
+// Frame transferred without error, from interrupt
+static void sys_i2c_async_complete(i2c_inst_t* i2c)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  if (!as->busy) return;  // already completed by the other interrupt
+  sys_i2c_account(i2c, as->addr, PICO_OK);
+  sys_i2c_async_done(i2c, as->rlen ? (int32_t)as->rlen : (int32_t)as->nwrite);
+}
+
+// Interrupt: frame stopped by abort (NACK) or all STOP detected
+static void sys_i2c_async_irq(i2c_inst_t* i2c)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+  i2c_hw_t* hw = i2c_get_hw(i2c);
+  uint32_t stat = hw->intr_stat;
+
+  if (!as->busy)
+  {
+    hw->intr_mask = 0;  // mask is set to default by i2c_init, disable it
+    return;
+  }
+
+  if (stat & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)
+  {
+    dma_channel_abort(as->dma_tx);
+    if (as->rlen) dma_channel_abort(as->dma_rx);
+    dma_channel_acknowledge_irq0(as->dma_rx);
+    (void)hw->clr_tx_abrt;  // release tx fifo
+    (void)hw->clr_stop_det;
+
+    sys_i2c_account(i2c, as->addr, PICO_ERROR_GENERIC);  // NACK: counters only, no bus recovery
+    if (!sys_i2c_async_retry(i2c))  // address or data not acknowledged, restart the frame
+    {
+      sys_i2c_async_done(i2c, PICO_ERROR_GENERIC);
+    }
+    return;
+  }
+
+  if (stat & I2C_IC_INTR_STAT_R_STOP_DET_BITS)
+  {
+    (void)hw->clr_stop_det;
+    if (++as->stop_cnt >= as->nstop)
+    {
+      as->stop_seen = true;
+      // last byte could be on rx fifo, the rx DMA interrupt complete the frame
+      if (!as->rlen || !dma_channel_is_busy(as->dma_rx)) sys_i2c_async_complete(i2c);
+    }
+  }
+}
+
+// Interrupt: rx DMA completed, complete the frame if the last STOP is already detected
+static void sys_i2c_async_dma_irq(void)
+{
+  for (uint8_t idx = 0; idx < 2; idx++)
+  {
+    sys_i2c_async_t* as = &async_i2c[idx];
+    if (!as->ready || !dma_channel_get_irq0_status(as->dma_rx)) continue;  // shared interrupt
+
+    dma_channel_acknowledge_irq0(as->dma_rx);
+    if (as->busy && as->stop_seen) sys_i2c_async_complete(idx ? i2c1 : i2c0);
+  }
+}
+
+static void sys_i2c_async_irq0(void)
+{
+  sys_i2c_async_irq(i2c0);
+}
+
+static void sys_i2c_async_irq1(void)
+{
+  sys_i2c_async_irq(i2c1);
+}
+
+// Check deadline of the frame, recover the bus on timeout. The recovery wait on the bus lines,
+// called from thread only (wait or event)
+static void sys_i2c_async_timeout(i2c_inst_t* i2c)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+  uint32_t save = save_and_disable_interrupts();
+
+  if (!as->busy || !time_reached(as->until))
+  {
+    restore_interrupts(save);
+    return;
+  }
+
+  i2c_get_hw(i2c)->intr_mask = 0;
+  dma_channel_abort(as->dma_tx);
+  if (as->rlen) dma_channel_abort(as->dma_rx);
+  dma_channel_acknowledge_irq0(as->dma_rx);  // abort could raise the completion interrupt
+  restore_interrupts(save);
+
+  sys_i2c_account(i2c, as->addr, PICO_ERROR_TIMEOUT);  // count timeout and recover the bus
+  if (!sys_i2c_async_retry(i2c))
+  {
+    sys_i2c_async_done(i2c, PICO_ERROR_TIMEOUT);
+  }
+}
+
+// Load the frame on DMA channels
+static void sys_i2c_async_run(i2c_inst_t* i2c)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+  i2c_hw_t* hw = i2c_get_hw(i2c);
+
+  as->stop_cnt = 0;
+  as->stop_seen = false;
+  as->until = make_timeout_time_us((as->ncmd + as->nstop) * I2C_TIMEOUT_CHAR);
+
+  hw->enable = 0;  // address can be changed only when disabled
+  hw->tar = as->addr;
+  hw->enable = 1;
+  (void)hw->clr_intr;  // clear pending interrupts
+
+  as->busy = true;
+  hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+  if (as->rlen)
+  {
+    dma_channel_config crx = dma_channel_get_default_config(as->dma_rx);
+    channel_config_set_transfer_data_size(&crx, DMA_SIZE_8);
+    channel_config_set_read_increment(&crx, false);
+    channel_config_set_write_increment(&crx, true);
+    channel_config_set_dreq(&crx, i2c_get_dreq(i2c, false));
+    dma_channel_configure(as->dma_rx, &crx, as->rbuf, &hw->data_cmd, as->rlen, true);
+  }
+
+  dma_channel_config ctx = dma_channel_get_default_config(as->dma_tx);
+  channel_config_set_transfer_data_size(&ctx, DMA_SIZE_32);
+  channel_config_set_read_increment(&ctx, true);
+  channel_config_set_write_increment(&ctx, false);
+  channel_config_set_dreq(&ctx, i2c_get_dreq(i2c, true));
+  dma_channel_configure(as->dma_tx, &ctx, &hw->data_cmd, as->cmd, as->ncmd, true);
+}
+
+bool sys_i2c_async_init(i2c_inst_t* i2c)
+{
+  uint8_t idx = (i2c == i2c0) ? 0 : 1;
+  sys_i2c_async_t* as = &async_i2c[idx];
+
+  if (as->ready) return true;
+
+  as->dma_tx = dma_claim_unused_channel(false);
+  as->dma_rx = dma_claim_unused_channel(false);
+  if (as->dma_tx < 0 || as->dma_rx < 0)
+  {
+    if (as->dma_tx >= 0) dma_channel_unclaim(as->dma_tx);
+    if (as->dma_rx >= 0) dma_channel_unclaim(as->dma_rx);
+    return false;  // no DMA channel available
+  }
+
+  i2c_get_hw(i2c)->intr_mask = 0;
+  irq_set_exclusive_handler(idx ? I2C1_IRQ : I2C0_IRQ, idx ? sys_i2c_async_irq1 : sys_i2c_async_irq0);
+  irq_set_enabled(idx ? I2C1_IRQ : I2C0_IRQ, true);
+
+  if (!async_i2c[0].ready && !async_i2c[1].ready)
+  {  // one handler for both i2c
+    irq_add_shared_handler(DMA_IRQ_0, sys_i2c_async_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+  }
+  dma_channel_acknowledge_irq0(as->dma_rx);
+  dma_channel_set_irq0_enabled(as->dma_rx, true);
+
+  as->ready = true;
+  return true;
+}
+
+// Reset the frame, the bus is owned by the caller
+static void sys_i2c_async_reset(i2c_inst_t* i2c, uint8_t addr)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  as->addr = addr;
+  as->ncmd = 0;
+  as->nwrite = 0;
+  as->nstop = 0;
+  as->last_stop = false;
+  as->rbuf = NULL;
+  as->rlen = 0;
+}
+
+void sys_i2c_async_begin(i2c_inst_t* i2c, uint8_t addr)
+{
+  while (!sys_i2c_take(i2c))
+  {
+    sys_i2c_async_wait(i2c);  // previous frame must be completed
+    tight_loop_contents();
+  }
+  sys_i2c_async_reset(i2c, addr);
+}
+
+bool sys_i2c_async_try_begin(i2c_inst_t* i2c, uint8_t addr)
+{
+  if (!sys_i2c_take(i2c)) return false;  // bus used by a command or a frame
+  sys_i2c_async_reset(i2c, addr);
+  return true;
+}
+
+bool sys_i2c_async_write(i2c_inst_t* i2c, const uint8_t* pBuf, uint32_t len, bool stop)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  if (len == 0 || as->rlen || as->ncmd + len > SYS_I2C_ASYNC_MAX) return false;
+
+  for (uint32_t i = 0; i < len; i++)
+  {
+    as->cmd[as->ncmd++] = pBuf[i];
+  }
+  if (stop)
+  {
+    as->cmd[as->ncmd - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    as->nstop++;
+  }
+  as->nwrite += len;
+  as->last_stop = stop;
+  return true;
+}
+
+bool sys_i2c_async_read(i2c_inst_t* i2c, uint8_t* pBuf, uint32_t len)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  if (len == 0 || as->rlen || as->ncmd + len > SYS_I2C_ASYNC_MAX) return false;
+
+  for (uint32_t i = 0; i < len; i++)
+  {
+    as->cmd[as->ncmd + i] = I2C_IC_DATA_CMD_CMD_BITS;  // read command
+  }
+  if (as->ncmd && !as->last_stop)
+  {
+    as->cmd[as->ncmd] |= I2C_IC_DATA_CMD_RESTART_BITS;  // change of direction without STOP
+  }
+  as->ncmd += len;
+  as->cmd[as->ncmd - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+  as->nstop++;
+  as->last_stop = true;
+  as->rbuf = pBuf;
+  as->rlen = len;
+  return true;
+}
+
+int32_t sys_i2c_async_start(i2c_inst_t* i2c, sys_i2c_async_cb_t cb, void* user)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  if (!as->ready || as->ncmd == 0)
+  {
+    sys_i2c_release(i2c);  // frame not started, bus taken by begin
+    return PICO_ERROR_GENERIC;
+  }
+
+  if (!as->last_stop)
+  {  // frame must release the bus
+    as->cmd[as->ncmd - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    as->nstop++;
+    as->last_stop = true;
+  }
+
+  sys_i2c_claim(i2c, as->addr);  // speed of the device, bus owned since begin
+
+  as->cb = cb;
+  as->user = user;
+  as->retry = 0;
+  sys_i2c_async_run(i2c);
+  return PICO_OK;
+}
+
+bool sys_i2c_async_busy(i2c_inst_t* i2c)
+{
+  return async_i2c[(i2c == i2c0) ? 0 : 1].busy;
+}
+
+void sys_i2c_async_event(i2c_inst_t* i2c)
+{
+  sys_i2c_async_timeout(i2c);
+}
+
+int32_t sys_i2c_async_wait(i2c_inst_t* i2c)
+{
+  sys_i2c_async_t* as = &async_i2c[(i2c == i2c0) ? 0 : 1];
+
+  while (as->busy)
+  {
+    sys_i2c_async_timeout(i2c);
+    tight_loop_contents();
+  }
+  return as->status;
+}
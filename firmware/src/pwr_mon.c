@@ -0,0 +1,398 @@
+/**
+ * @file    pwr_mon.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Background power monitoring with the INA219
+ *
+ * @details A timer start the read of the shunt and bus registers of the INA219 with
+ *          asynchronous I2C frames. The sample is skipped if the internal I2C bus is
+ *          used by a command. Each sample update min, max and sum of voltage, current and power,
+ *          the energy and the charge are integrated with the time between samples.
+ *          All values are kept as integer, conversion is done only when the result is read.
+ *          The inrush capture read the current at the fastest conversion rate after the close of
+ *          a power relay, the monitor is stopped during the capture.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "include/functadv.h"
+#include "include/pwr_mon.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
+#include "pico_lib2/src/sys/include/sys_i2c_async.h"
+#include "pico_lib2/src/dev/dev_ina219/dev_ina219.h"
+
+#define PWR_STEP_IDLE 0   // no frame on the bus
+#define PWR_STEP_SHUNT 1  // read of shunt register
+#define PWR_STEP_BUS 2    // read of bus register
+
+/**
+ * @brief State of the power monitor.
+ */
+static struct
+{
+  repeating_timer_t timer;  // sampling timer
+  bool running;             // timer active
+  uint32_t period_ms;       // sampling period
+  volatile uint8_t step;    // frame on the bus
+  uint8_t reg;              // register read by the frame
+  uint8_t buf[2];           // register value
+  int16_t shunt;            // shunt value of the sample
+  bool have_last;           // previous sample valid for integration
+  uint64_t last_us;         // time of previous sample
+  int64_t last_p_nw;        // power of previous sample in nW
+  int32_t last_i_ua;        // current of previous sample in uA
+  pwr_stat_t st;            // statistic since last clear
+} pm = {.period_ms = PWR_MON_DEF_PERIOD_MS};
+
+/**
+ * @brief State of the inrush capture.
+ */
+static struct
+{
+  uint8_t state;                             // PWR_CAP_IDLE, PWR_CAP_ARMED or PWR_CAP_DONE
+  uint32_t points;                           // number of points requested
+  uint32_t count;                            // number of points acquired
+  int32_t peak_ua;                           // peak current
+  uint32_t settle_us;                        // time to settle inside the band
+  pwr_cap_point_t pt[PWR_CAP_MAX_POINTS];    // captured points
+} pcap = {.state = PWR_CAP_IDLE, .points = PWR_CAP_DEF_POINTS};
+
+static void pwr_mon_read(uint8_t reg);
+
+/**
+ * @brief Add a sample on the statistic and integrate energy and charge
+ *
+ * @param shunt  Raw shunt register
+ * @param mv     Bus voltage in mV
+ */
+static void pwr_mon_add(int16_t shunt, int32_t mv)
+{
+  pwr_stat_t* st = &pm.st;
+  uint64_t now = time_us_64();
+  int32_t ua = ina219ShuntToCurrent_uA(shunt);
+  int64_t p_nw = (int64_t)mv * ua;  // mV x uA = nW
+  int32_t p_uw = (int32_t)(p_nw / 1000);
+  int64_t q;
+
+  if (st->count == 0)
+  {
+    st->v_min = st->v_max = mv;
+    st->i_min = st->i_max = ua;
+    st->p_min = st->p_max = p_uw;
+  }
+  if (mv < st->v_min) st->v_min = mv;
+  if (mv > st->v_max) st->v_max = mv;
+  if (ua < st->i_min) st->i_min = ua;
+  if (ua > st->i_max) st->i_max = ua;
+  if (p_uw < st->p_min) st->p_min = p_uw;
+  if (p_uw > st->p_max) st->p_max = p_uw;
+  st->v_sum += mv;
+  st->i_sum += ua;
+  st->p_sum += p_uw;
+  st->count++;
+
+  if (pm.have_last)
+  {  // previous value is hold until this sample
+    uint64_t dt = now - pm.last_us;
+
+    st->energy_rem += pm.last_p_nw * (int64_t)dt;
+    q = st->energy_rem / PWR_MON_NWUS_PER_UWH;
+    st->energy_uwh += q;
+    st->energy_rem -= q * PWR_MON_NWUS_PER_UWH;
+
+    st->charge_rem += (int64_t)pm.last_i_ua * (int64_t)dt;
+    q = st->charge_rem / PWR_MON_UAUS_PER_UAH;
+    st->charge_uah += q;
+    st->charge_rem -= q * PWR_MON_UAUS_PER_UAH;
+
+    st->time_us += dt;
+  }
+
+  pm.have_last = true;
+  pm.last_us = now;
+  pm.last_p_nw = p_nw;
+  pm.last_i_ua = ua;
+}
+
+/**
+ * @brief End of frame, called from I2C interrupt. The bus register is read after the shunt register.
+ */
+static void pwr_mon_done(i2c_inst_t* i2c, uint8_t addr, int32_t status, void* user)
+{
+  uint16_t value = (pm.buf[0] << 8) | pm.buf[1];
+
+  if (status < 0)
+  {
+    pm.st.error++;
+    pm.step = PWR_STEP_IDLE;
+    return;
+  }
+
+  if (pm.step == PWR_STEP_SHUNT)
+  {
+    pm.shunt = (int16_t)value;
+    pwr_mon_read(INA219_REG_BUSVOLTAGE);
+    return;
+  }
+
+  pm.step = PWR_STEP_IDLE;
+  pwr_mon_add(pm.shunt, (value >> 3) * 4);  // drop CNVR and OVF, LSB = 4mV
+}
+
+/**
+ * @brief Start the asynchronous read of an INA219 register
+ *
+ * @param reg  Register to read
+ */
+static void pwr_mon_read(uint8_t reg)
+{
+  pm.reg = reg;
+  if (!sys_i2c_async_try_begin(i2c0, INA219_ADDRESS))
+  {
+    pm.st.skip++;  // bus used by a command, sample on next period
+    pm.step = PWR_STEP_IDLE;
+    return;
+  }
+  pm.step = (reg == INA219_REG_SHUNTVOLTAGE) ? PWR_STEP_SHUNT : PWR_STEP_BUS;
+
+  sys_i2c_async_write(i2c0, &pm.reg, 1, false);
+  sys_i2c_async_read(i2c0, pm.buf, sizeof(pm.buf));
+  if (sys_i2c_async_start(i2c0, pwr_mon_done, NULL) != PICO_OK)
+  {
+    pm.st.error++;
+    pm.step = PWR_STEP_IDLE;
+  }
+}
+
+/**
+ * @brief Timer callback, start a sample if the bus is free
+ *
+ * @param rt      Repeating timer
+ * @return true   Timer continue
+ */
+static bool pwr_mon_timer(repeating_timer_t* rt)
+{
+  if (pm.step != PWR_STEP_IDLE)
+  {
+    pm.st.skip++;  // previous sample not completed, sample on next period
+    return true;
+  }
+
+  pwr_mon_read(INA219_REG_SHUNTVOLTAGE);
+  return true;
+}
+
+/**
+ * @brief Start or restart the power monitor
+ *
+ * @param period_ms  Sampling period in ms (PWR_MON_MIN_PERIOD_MS to PWR_MON_MAX_PERIOD_MS)
+ * @return true      Monitor is running
+ * @return false     Period out of range or no timer available
+ */
+bool pwr_mon_start(uint32_t period_ms)
+{
+  if (period_ms < PWR_MON_MIN_PERIOD_MS || period_ms > PWR_MON_MAX_PERIOD_MS) return false;
+
+  pwr_mon_stop();
+  pm.period_ms = period_ms;
+  pm.have_last = false;  // no integration over the stop time
+  pm.running = add_repeating_timer_ms(-(int32_t)period_ms, pwr_mon_timer, NULL, &pm.timer);
+
+  fprintf(stdout, "Power monitor sampling every %lu ms\n", period_ms);
+  return pm.running;
+}
+
+/**
+ * @brief Stop the power monitor, wait end of frame on the bus
+ */
+void pwr_mon_stop(void)
+{
+  if (!pm.running) return;
+
+  cancel_repeating_timer(&pm.timer);
+  pm.running = false;
+  while (pm.step != PWR_STEP_IDLE)
+  {
+    sys_i2c_async_wait(i2c0);  // deadline of the frame is checked by wait
+  }
+}
+
+/**
+ * @brief Return the sampling period
+ *
+ * @return uint32_t  Period in ms, 0 if the monitor is stopped
+ */
+uint32_t pwr_mon_period(void)
+{
+  return pm.running ? pm.period_ms : 0;
+}
+
+/**
+ * @brief Clear the statistic, energy and charge
+ */
+void pwr_mon_clear(void)
+{
+  uint32_t save = save_and_disable_interrupts();
+
+  memset(&pm.st, 0, sizeof(pm.st));
+  pm.have_last = false;
+  restore_interrupts(save);
+}
+
+/**
+ * @brief Return a copy of the statistic, taken without update by the sampler
+ *
+ * @param st  Statistic returned
+ */
+void pwr_mon_get(pwr_stat_t* st)
+{
+  uint32_t save = save_and_disable_interrupts();
+
+  *st = pm.st;
+  restore_interrupts(save);
+}
+
+/**
+ * @brief Arm the inrush capture, executed on the next close of a power relay
+ *
+ * @param points    Number of points (1 to PWR_CAP_MAX_POINTS)
+ * @return uint8_t  NOERR or EOOR if out of range
+ */
+uint8_t pwr_cap_arm(uint32_t points)
+{
+  if (points < 1 || points > PWR_CAP_MAX_POINTS) return EOOR;
+
+  pcap.points = points;
+  pcap.state = PWR_CAP_ARMED;
+  return NOERR;
+}
+
+/**
+ * @brief Return the state of the inrush capture
+ *
+ * @return uint8_t  PWR_CAP_IDLE, PWR_CAP_ARMED or PWR_CAP_DONE
+ */
+uint8_t pwr_cap_state(void)
+{
+  return pcap.state;
+}
+
+/**
+ * @brief Compute the peak current and the time to settle inside the band around the final value.
+ *        The final value is the mean of the last 10% of points.
+ */
+static void pwr_cap_analyze(void)
+{
+  uint32_t nfinal = (pcap.count / 10) ? pcap.count / 10 : 1;
+  int64_t sum = 0;
+  int32_t ua, final, band;
+
+  pcap.peak_ua = INT32_MIN;
+  for (uint32_t i = 0; i < pcap.count; i++)
+  {
+    ua = ina219ShuntToCurrent_uA(pcap.pt[i].shunt);
+    if (ua > pcap.peak_ua) pcap.peak_ua = ua;
+    if (i >= pcap.count - nfinal) sum += ua;
+  }
+  final = (int32_t)(sum / nfinal);
+  band = ((final < 0) ? -final : final) * PWR_CAP_SETTLE_PCT / 100;
+  if (band < PWR_CAP_SETTLE_MIN_UA) band = PWR_CAP_SETTLE_MIN_UA;
+
+  pcap.settle_us = 0;
+  for (uint32_t i = pcap.count; i > 0; i--)
+  {  // last point outside of the band
+    ua = ina219ShuntToCurrent_uA(pcap.pt[i - 1].shunt);
+    if (ua > final + band || ua < final - band)
+    {
+      pcap.settle_us = (i < pcap.count) ? pcap.pt[i].time_us : pcap.pt[i - 1].time_us;
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Power relay closed, execute the capture if armed. The shunt register is read at the
+ *        conversion rate, the function return at the end of the capture (maximum 2048 x 84 us).
+ */
+void pwr_cap_event(void)
+{
+  uint32_t period, start, next, t;
+  uint16_t config;
+  uint8_t buf[2];
+  uint8_t reg = INA219_REG_SHUNTVOLTAGE;
+  uint32_t i;
+
+  if (pcap.state != PWR_CAP_ARMED) return;
+
+  period = pwr_mon_period();
+  pwr_mon_stop();  // bus reserved for the capture
+
+  config = ina219GetConfig();
+  ina219SetConfig((config & (INA219_CONFIG_BVOLTAGERANGE_MASK | INA219_CONFIG_GAIN_MASK)) | INA219_CONFIG_BADCRES_9BIT |
+                  INA219_CONFIG_SADCRES_9BIT_1S_84US | INA219_CONFIG_MODE_SVOLT_CONTINUOUS);
+  sys_i2c_wbuf(i2c0, INA219_ADDRESS, &reg, 1);  // register pointer kept for next reads
+
+  start = time_us_32();
+  next = start;
+  for (i = 0; i < pcap.points; i++)
+  {
+    while ((int32_t)(time_us_32() - next) < 0)
+    {
+      tight_loop_contents();
+    }
+    t = time_us_32();
+    if (sys_i2c_rbuf(i2c0, INA219_ADDRESS, buf, sizeof(buf)) < 0) break;
+    pcap.pt[i].time_us = t - start;
+    pcap.pt[i].shunt = (int16_t)((buf[0] << 8) | buf[1]);
+    next += PWR_CAP_PERIOD_US;
+  }
+  pcap.count = i;
+
+  ina219SetConfig(config);  // restore conversion mode
+  if (period) pwr_mon_start(period);
+
+  pwr_cap_analyze();
+  pcap.state = PWR_CAP_DONE;
+  fprintf(stdout, "Inrush capture: %lu points in %lu us\n", pcap.count, pcap.count ? pcap.pt[pcap.count - 1].time_us : 0);
+}
+
+/**
+ * @brief Return the result of the inrush capture
+ *
+ * @param peak_ma    Peak current in mA
+ * @param settle_ms  Time to settle in ms
+ * @param points     Number of points acquired
+ * @return true      Result available
+ */
+bool pwr_cap_result(float* peak_ma, float* settle_ms, uint32_t* points)
+{
+  if (pcap.state != PWR_CAP_DONE || pcap.count == 0) return false;
+
+  *peak_ma = pcap.peak_ua * 1E-3f;
+  *settle_ms = pcap.settle_us * 1E-3f;
+  *points = pcap.count;
+  return true;
+}
+
+/**
+ * @brief Return the points of the inrush capture
+ *
+ * @param points                   Number of points acquired
+ * @return const pwr_cap_point_t*  Points, NULL if no capture completed
+ */
+const pwr_cap_point_t* pwr_cap_data(uint32_t* points)
+{
+  if (pcap.state != PWR_CAP_DONE) return NULL;
+
+  *points = pcap.count;
+  return pcap.pt;
+}
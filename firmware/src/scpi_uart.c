@@ -17,10 +17,14 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <inttypes.h>
 #include <ctype.h>
 #include "pico/stdlib.h"
 #include "hardware/uart.h"
 #include "hardware/irq.h"
+#include "hardware/dma.h"
+#include "hardware/watchdog.h"
+#include "hardware/sync.h"
 #include "include/scpi_uart.h"
 
 /**
@@ -61,6 +65,260 @@ struct user_com u_com = {
     DEF_LASTCHAR         //!< Default last received character.
 };
 
+/**
+ * @brief Receive ring written by DMA, aligned on its size for the DMA ring wrap.
+ */
+static uint8_t rx_ring[USER_RX_RING] __attribute__((aligned(USER_RX_RING)));
+
+/**
+ * @brief State of the DMA transfers of the user UART.
+ */
+static struct
+{
+  int dma_rx;                // DMA channel writing the receive ring
+  int dma_tx;                // DMA channel writing the UART transmit FIFO
+  bool irq_installed;        // DMA interrupt handler added
+  volatile uint32_t reload;  // number of transfer count reload of the receive channel
+  uint32_t tail;             // index of the next byte to read on the ring (modulo 2^32)
+  uint32_t overrun;          // bytes lost because the ring was not read in time
+  uint32_t term[8];          // terminator characters, one bit by character
+  uint8_t nterm;             // number of terminator characters, 0: last character sent is used
+} urx = {-1, -1, false, 0, 0, 0, {0}, 0};
+
+/**
+ * @brief DMA interrupt, reload the transfer count for a continuous receive.
+ *        The write address continue on the ring.
+ */
+static void uart_rx_dma_irq(void)
+{
+  if (urx.dma_rx < 0 || !dma_channel_get_irq0_status(urx.dma_rx)) return;  // shared interrupt
+
+  dma_channel_acknowledge_irq0(urx.dma_rx);
+  urx.reload++;
+  dma_channel_set_trans_count(urx.dma_rx, USER_RX_DMA_COUNT, true);
+}
+
+/**
+ * @brief Return the number of bytes received since the start of the receive DMA
+ *
+ * @return uint32_t  Index of the next byte to be written (modulo 2^32)
+ */
+static uint32_t uart_rx_head(void)
+{
+  uint32_t reload, remain;
+
+  do
+  {  // read again if the count is reloaded during the read
+    reload = urx.reload;
+    remain = dma_channel_hw_addr(urx.dma_rx)->transfer_count;
+  } while (reload != urx.reload);
+
+  return reload * USER_RX_DMA_COUNT + (USER_RX_DMA_COUNT - remain);
+}
+
+/**
+ * @brief Read the next byte of the receive ring. If the ring has been filled before the read,
+ *        the oldest bytes are lost.
+ *
+ * @return int  byte received, -1 if no byte available
+ */
+static int uart_rx_getc(void)
+{
+  uint32_t head = uart_rx_head();
+
+  if (head == urx.tail)
+  {
+    return -1;
+  }
+  if (head - urx.tail > USER_RX_RING)
+  {  // ring overwritten, continue with the oldest byte available
+    urx.overrun += head - urx.tail - USER_RX_RING;
+    urx.tail = head - USER_RX_RING;
+  }
+  return rx_ring[urx.tail++ & (USER_RX_RING - 1)];
+}
+
+/**
+ * @brief Capture ring of the received characters, filled in background from the receive ring.
+ */
+static uint8_t cap_ring[USER_CAP_SIZE];
+
+/**
+ * @brief State of the background capture.
+ */
+static struct
+{
+  bool on;        // capture running
+  bool bol;       // next character is the first of a line, timestamp added before
+  uint32_t rx;    // index of the next byte to capture on the receive ring (modulo 2^32)
+  uint32_t head;  // bytes written on the capture ring (modulo 2^32)
+  uint32_t tail;  // bytes read on the capture ring (modulo 2^32)
+  uint32_t lost;  // bytes lost, receive or capture ring overwritten
+  bool timer;     // drain timer running
+  repeating_timer_t rt;  // drain timer, the capture continue during a long command
+} cap = {false, true, 0, 0, 0, 0, false};
+
+/**
+ * @brief Write one byte on the capture ring, the oldest byte is lost if the ring is full.
+ *
+ * @param c  byte to write
+ */
+static void uart_cap_put(uint8_t c)
+{
+  cap_ring[cap.head++ & (USER_CAP_SIZE - 1)] = c;
+  if (cap.head - cap.tail > USER_CAP_SIZE)
+  {
+    cap.tail++;
+    cap.lost++;
+  }
+}
+
+/**
+ * @brief Write the timestamp "[s.ms] " on the capture ring, without printf (called from timer interrupt)
+ */
+static void uart_cap_stamp(void)
+{
+  char ts[16];
+  uint32_t ms = to_ms_since_boot(get_absolute_time());
+  uint32_t s = ms / 1000;
+  int n = sizeof(ts);
+
+  ms %= 1000;
+  ts[--n] = ' ';
+  ts[--n] = ']';
+  for (int i = 0; i < 3; i++, ms /= 10)
+  {
+    ts[--n] = '0' + ms % 10;
+  }
+  ts[--n] = '.';
+  do
+  {
+    ts[--n] = '0' + s % 10;
+    s /= 10;
+  } while (s);
+  ts[--n] = '[';
+
+  for (; n < (int)sizeof(ts); n++)
+  {
+    uart_cap_put(ts[n]);
+  }
+}
+
+/**
+ * @brief Copy the new bytes of the receive ring on the capture ring. A timestamp "[s.ms] " is
+ *        written before the first character of each line. The capture use its own index on
+ *        the receive ring, the bytes read by a transaction are also captured.
+ *        Called by the capture timer and by the commands, the copy is done with interrupts disabled.
+ */
+static void uart_cap_drain(void)
+{
+  if (!cap.on || !u_com.status)
+  {
+    return;
+  }
+
+  uint32_t save = save_and_disable_interrupts();
+  uint32_t head = uart_rx_head();
+  if (head - cap.rx > USER_RX_RING)
+  {  // receive ring overwritten before the capture
+    cap.lost += head - cap.rx - USER_RX_RING;
+    cap.rx = head - USER_RX_RING;
+  }
+
+  while (cap.rx != head)
+  {
+    uint8_t c = rx_ring[cap.rx++ & (USER_RX_RING - 1)];
+    if (cap.bol)
+    {
+      uart_cap_stamp();
+      cap.bol = false;
+    }
+    uart_cap_put(c);
+    if (c == '\n')
+    {
+      cap.bol = true;
+    }
+  }
+  restore_interrupts(save);
+}
+
+/**
+ * @brief Capture timer, the receive ring is copied before it is overwritten even if a command
+ *        block the main loop (sweep, inrush capture, 1-Wire write)
+ *
+ * @param rt      Repeating timer
+ * @return true   Timer continue
+ */
+static bool uart_cap_timer(repeating_timer_t* rt)
+{
+  uart_cap_drain();
+  return true;
+}
+
+/**
+ * @brief Claim the DMA channels and start the receive DMA from the uart to the ring
+ *
+ * @return true   DMA channels available
+ */
+static bool uart_rx_start(void)
+{
+  if (urx.dma_rx < 0)
+  {
+    urx.dma_rx = dma_claim_unused_channel(false);
+  }
+  if (urx.dma_tx < 0)
+  {
+    urx.dma_tx = dma_claim_unused_channel(false);
+  }
+  if (urx.dma_rx < 0 || urx.dma_tx < 0)
+  {
+    fprintf(stdout, "Serial: no DMA channel available\n");
+    return false;
+  }
+
+  if (!urx.irq_installed)
+  {
+    irq_add_shared_handler(DMA_IRQ_0, uart_rx_dma_irq, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    urx.irq_installed = true;
+  }
+
+  dma_channel_config cfg = dma_channel_get_default_config(urx.dma_rx);
+  channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+  channel_config_set_read_increment(&cfg, false);
+  channel_config_set_write_increment(&cfg, true);
+  channel_config_set_ring(&cfg, true, USER_RX_RING_BITS);  // wrap write address on the ring
+  channel_config_set_dreq(&cfg, uart_get_dreq(u_com.uart_id, false));
+
+  uint32_t save = save_and_disable_interrupts();  // capture timer must not read the indexes during the restart
+  urx.reload = 0;
+  urx.tail = 0;
+  urx.overrun = 0;
+  cap.rx = 0;
+  dma_channel_acknowledge_irq0(urx.dma_rx);
+  dma_channel_set_irq0_enabled(urx.dma_rx, true);
+  dma_channel_configure(urx.dma_rx, &cfg, rx_ring, &uart_get_hw(u_com.uart_id)->dr, USER_RX_DMA_COUNT, true);
+  restore_interrupts(save);
+  return true;
+}
+
+/**
+ * @brief Stop the DMA transfers of the uart
+ */
+static void uart_rx_stop(void)
+{
+  if (urx.dma_rx >= 0)
+  {
+    dma_channel_set_irq0_enabled(urx.dma_rx, false);  // abort could raise the completion interrupt
+    dma_channel_abort(urx.dma_rx);
+    dma_channel_acknowledge_irq0(urx.dma_rx);
+  }
+  if (urx.dma_tx >= 0)
+  {
+    dma_channel_abort(urx.dma_tx);
+  }
+}
+
 /**
  * @brief  function to configure the parameters of the user uart based on the data set on the uart structure
  *
@@ -93,9 +351,10 @@ void scpi_uart_enable()
   // Set our data format
   uart_set_format(u_com.uart_id, u_com.data_bits, u_com.stop_bits, u_com.parity);
 
-  // Turn off FIFO's - we want to do this character by character
+  // FIFO enabled, the receive FIFO is emptied by DMA to the receive ring
   uart_set_fifo_enabled(u_com.uart_id, true);
-  u_com.status = 1;  // set flag to indicate of serial port is enabled
+  uart_rx_stop();  // if already enabled
+  u_com.status = uart_rx_start();  // set flag to indicate of serial port is enabled
 }
 
 /**
@@ -105,6 +364,7 @@ void scpi_uart_enable()
 void scpi_uart_disable()
 {
   // Disable.
+  uart_rx_stop();
   uart_deinit(u_com.uart_id);
 
   // set pins used for uart to GPIO mode
@@ -342,56 +602,119 @@ const char* scpi_uart_get_protocol()
 }
 
 /**
- * @brief Utility function to empty the receive buffer before send new string
+ * @brief Utility function to empty the receive ring before send new string. The bytes are kept
+ *        on the capture ring if the capture is running.
  *
  */
 static void clear_receive_fifo()
 {
-  // Read and discard any available data in the FIFO
-  while (uart_is_readable(u_com.uart_id))
+  uart_cap_drain();
+  uint32_t head = uart_rx_head();
+  if (head != urx.tail)
   {
-    char data = uart_getc(u_com.uart_id);  // Read and discard data
-    printf("Receive fifo clear char: 0x%x\n", data);
+    fprintf(stdout, "Receive ring clear, %" PRIu32 " bytes discarded\n", head - urx.tail);
   }
+  urx.tail = head;  // discard data received before the command
 }
 
 /**
- * @brief function to send character to uart if space is available on the fifo
+ * @brief Function to check if a character is a terminator of the received string
  *
- * @param c character to send
+ * @param c  character received
+ * @return true if the character end the string
  */
-static void send_char(char c)
+static bool uart_is_term(uint8_t c)
 {
-  // Wait for UART to be ready for TX
-  while (!uart_is_writable(u_com.uart_id))
-    ;
-
-  // Send character
-  uart_putc(u_com.uart_id, c);
+  if (urx.nterm == 0)
+  {
+    return c == u_com.lastchr;  // last character of the string sent
+  }
+  return (urx.term[c >> 5] >> (c & 31)) & 1;
 }
 
 /**
- * @brief function to receive char from uart. The char need to be received before timeout expire. End of string character is returned
- *        if timeout occur
+ * @brief function to send data to the uart by DMA. The function return when the last byte is on the uart FIFO.
+ *        The timeout is the time to send the data plus the receive timeout, used when CTS block the transmit.
  *
- * @param timeout_ms  timeout time in milliseconds
- * @return char received on uart
+ * @param data  data to send
+ * @param len   number of bytes
+ * @return uint8_t Error code to success or error
  */
-static char receive_char_with_timeout(uint32_t timeout_ms)
+static uint8_t uart_tx_dma(const char* data, size_t len)
 {
-  uint32_t start_time = time_us_32();
+  if (len == 0)
+  {
+    return NOCERR;
+  }
+
+  dma_channel_config cfg = dma_channel_get_default_config(urx.dma_tx);
+  channel_config_set_transfer_data_size(&cfg, DMA_SIZE_8);
+  channel_config_set_read_increment(&cfg, true);
+  channel_config_set_write_increment(&cfg, false);
+  channel_config_set_dreq(&cfg, uart_get_dreq(u_com.uart_id, true));
+  dma_channel_configure(urx.dma_tx, &cfg, &uart_get_hw(u_com.uart_id)->dr, data, len, true);
 
-  while (!uart_is_readable(u_com.uart_id))
+  uint32_t start = time_us_32();
+  uint32_t limit = u_com.timeout_ms * 1000 + (uint32_t)((uint64_t)len * 12 * 1000000 / u_com.actual_baud);
+  while (dma_channel_is_busy(urx.dma_tx))
   {
-    // Check timeout
-    if ((time_us_32() - start_time) >= (timeout_ms * 1000))
+    if (time_us_32() - start >= limit)
     {
-      return '\0';  // Return null character to indicate timeout
+      dma_channel_abort(urx.dma_tx);
+      uart_cap_drain();
+      fprintf(stdout, "Serial transmit timeout, %" PRIu32 " bytes not sent\n",
+              (uint32_t)dma_channel_hw_addr(urx.dma_tx)->transfer_count);
+      return UART_TX_TIMEOUT;
     }
+    uart_cap_drain();  // the receive ring could be filled during a long transmit
   }
+  return NOCERR;
+}
+
+/**
+ * @brief function to receive a string from the receive ring. The string end on a terminator character,
+ *        when the buffer is full or when no character is received during the timeout.
+ *
+ * @param dread Buffer where the string will be stored
+ * @param rsize Size of the buffer
+ * @param len   Number of characters received
+ * @return uint8_t Error code to success or error
+ */
+static uint8_t uart_rx_read_string(char* dread, size_t rsize, size_t* len)
+{
+  uint32_t last = time_us_32();  // time of the last character received
+  size_t n = 0;
+  uint8_t err;
 
-  // Read character and return
-  return uart_getc(u_com.uart_id);
+  while (true)
+  {
+    int c = uart_rx_getc();
+    if (c < 0)
+    {
+      if (time_us_32() - last >= u_com.timeout_ms * 1000)
+      {  // no character during timeout
+        err = n ? UART_LASTCHAR_TIMEOUT_MS : UART_RX_TIMEOUT_MS;
+        break;
+      }
+      uart_cap_drain();
+      continue;
+    }
+    last = time_us_32();
+    dread[n++] = c;
+    if (uart_is_term(c))
+    {
+      err = NOCERR;
+      break;
+    }
+    if (n >= rsize - 1)
+    {
+      err = UART_BUFFER_FULL;
+      break;
+    }
+  }
+  dread[n] = '\0';  // Null-terminate the received string
+  *len = n;
+  return err;
 }
 
 /**
@@ -401,33 +724,26 @@ static char receive_char_with_timeout(uint32_t timeout_ms)
  * @return uint8_t Error code to success or error
  */
 uint8_t scpi_uart_write_data(char* dwt)
-{               // write data only
-  int tcr = 0;  // Counter for transmit characters
+{  // write data only
+  size_t tcr = strlen(dwt);
   if (u_com.status == 0)
   {
     return UART_NOT_ENABLED;
   }  // if serial not enabled
 
-  do
+  if (tcr > 0)
   {
-    if (dwt[tcr] != '\0')
-    {  // if string is not empty
-      send_char(dwt[tcr]);
-      fprintf(stdout, "Sent char #%d: 0x%x, %c\n", tcr, dwt[tcr], dwt[tcr]);
-      tcr++;  // increment char pointer
-    }
-  } while (dwt[tcr] != '\0');  // loop until end of string
-
-  u_com.lastchr = dwt[tcr - 1];  // identify the last valid character of string, expect CR or LF
-  fprintf(stdout, "lastchar Tx only: 0x%x\n", dwt[tcr - 1]);
-  return NOCERR;
+    u_com.lastchr = dwt[tcr - 1];  // identify the last valid character of string, expect CR or LF
+  }
+  return uart_tx_dma(dwt, tcr);
 }
 
 /**
  * @brief Function to perform UART write and read operations.
  *
  * This function writes data to a UART interface and expects a response,
- * reading the response into the provided read buffer.
+ * reading the response into the provided read buffer. The response end with a character
+ * of the terminator set, or with the last character sent if the set is empty.
  *
  * @param dwt Pointer to the write buffer containing the data to be sent.
  * @param dread Pointer to the read buffer where the response will be stored.
@@ -439,84 +755,501 @@ uint8_t scpi_uart_write_data(char* dwt)
  */
 uint8_t scpi_uart_write_read_data(char* dwt, char* dread, size_t rsize)
 {  // write data, expect answer
+  size_t tcr = strlen(dwt);  // number of characters to send
+  size_t rtr = 0;            // number of characters received
+  uint8_t err;
 
+  dread[0] = '\0';  // clear receive buffer
   if (u_com.status == 0)
   {
     return UART_NOT_ENABLED;
   }  // if serial not enabled
 
-  clear_receive_fifo();  // clear Rx fifo
-  dread[0] = '\0';       // clear receive buffer
+  clear_receive_fifo();  // clear Rx ring
+  uint32_t start_time = time_us_32();
 
-  uint32_t start_time = time_us_32();  // used by timeout
+  if (tcr > 0)
+  {                                // if character send, save last character of the string
+    u_com.lastchr = dwt[tcr - 1];  // identify the last valid character of string, expect CR or LF
+  }
+  err = uart_tx_dma(dwt, tcr);  // answer is stored on the ring during the transmit
+  if (err == NOCERR)
+  {
+    err = uart_rx_read_string(dread, rsize, &rtr);
+  }
 
-  int rtr = 0;  // Counter for received characters
-  int tcr = 0;  // Counter for transmit characters
+  fprintf(stdout, "Serial sent %lu bytes, received %lu bytes in %" PRIu32 " us, error: %d\n", (unsigned long)tcr, (unsigned long)rtr,
+          time_us_32() - start_time, err);
+  if (urx.overrun)
+  {
+    fprintf(stdout, "Serial receive ring overrun, %" PRIu32 " bytes lost\n", urx.overrun);
+    urx.overrun = 0;
+  }
+  return err;
+}
 
-  // transmit loop, could receive character back is available
-  do
+/**
+ * @brief Read one character of a string with escape sequences: \r, \n, \t, \\, \| and \xHH.
+ *
+ * @param str   pointer on the string, moved after the character read
+ * @return int  character read, -1 if the escape sequence is not valid
+ */
+static int uart_unescape(const char** str)
+{
+  const char* s = *str;
+  int c = (uint8_t)*s++;
+
+  if (c == '\\')
   {
-    if (dwt[tcr] != '\0')
+    switch (*s++)
     {
-      send_char(dwt[tcr]);
-      fprintf(stdout, "Sent char #%d: 0x%x, %c", tcr, dwt[tcr], dwt[tcr]);
-      tcr++;
+      case 'r':
+        c = '\r';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case '\\':
+        c = '\\';
+        break;
+      case '|':
+        c = '|';
+        break;
+      case 'x':
+        if (!isxdigit((uint8_t)s[0]) || !isxdigit((uint8_t)s[1]))
+        {
+          return -1;
+        }
+        c = (isdigit((uint8_t)s[0]) ? s[0] - '0' : (toupper(s[0]) - 'A' + 10)) << 4;
+        c |= isdigit((uint8_t)s[1]) ? s[1] - '0' : (toupper(s[1]) - 'A' + 10);
+        s += 2;
+        break;
+      default:
+        return -1;
     }
+  }
+  *str = s;
+  return c;
+}
 
-    // read character if is one available
-    if (uart_is_readable(u_com.uart_id))
-    {                                         // if character received on uart fifo
-      dread[rtr] = uart_getc(u_com.uart_id);  // save character on read array
-      fprintf(stdout, "  Rcv char #%d: 0x%x, %c", rtr, dread[rtr], dread[rtr]);
-      rtr++;
+/**
+ * @brief Write one character with escape sequence if not printable
+ *
+ * @param c     character
+ * @param out   string where the character is written, 4 characters maximum plus end of string
+ * @return size_t  number of characters written
+ */
+static size_t uart_escape(uint8_t c, char* out)
+{
+  switch (c)
+  {
+    case '\r':
+      return sprintf(out, "\\r");
+    case '\n':
+      return sprintf(out, "\\n");
+    case '\t':
+      return sprintf(out, "\\t");
+    case '\\':
+      return sprintf(out, "\\\\");
+    default:
+      return isprint(c) ? sprintf(out, "%c", c) : sprintf(out, "\\x%02X", c);
+  }
+}
+
+/**
+ * @brief Function to set the terminator characters of the received string. The escape sequences
+ *        \r, \n, \t, \\ and \xHH are accepted. An empty string select the last character sent.
+ *
+ * @param str   String of terminator characters
+ * @return uint8_t  Error code, UART_TERM_NOTVALID if the string is not valid
+ */
+uint8_t scpi_uart_set_terminator(const char* str)
+{
+  uint32_t term[8] = {0};
+  uint8_t nterm = 0;
+
+  while (*str)
+  {
+    int c = uart_unescape(&str);
+    if (c < 0)
+    {
+      return UART_TERM_NOTVALID;
+    }
+    if (!((term[c >> 5] >> (c & 31)) & 1))
+    {
+      if (nterm >= USER_TERM_MAX)
+      {
+        return UART_TERM_NOTVALID;
+      }
+      term[c >> 5] |= 1u << (c & 31);
+      nterm++;
     }
-    fprintf(stdout, "\n");     // print line return
-  } while (dwt[tcr] != '\0');  // loop until all characters has been sent
+  }
+  memcpy(urx.term, term, sizeof(term));
+  urx.nterm = nterm;
+  fprintf(stdout, "Serial terminator set with %d characters\n", nterm);
+  return NOCERR;
+}
 
-  if (tcr > 0)
-  {                                // if character send, save last character of the string
-    u_com.lastchr = dwt[tcr - 1];  // identify the last valid character of string, expect CR or LF
-    fprintf(stdout, "lastchar Tx: 0x%x, Rx:  0x%x\n", dwt[tcr - 1], dread[rtr - 1]);
+/**
+ * @brief function who return the terminator characters with escape sequences, empty if the
+ *        last character sent is used.
+ *
+ * @return const char*  terminator string
+ */
+const char* scpi_uart_get_terminator()
+{
+  static char ts[USER_TERM_MAX * 4 + 1];
+  size_t pos = 0;
+
+  for (int c = 0; c < 256; c++)
+  {
+    if (urx.nterm && ((urx.term[c >> 5] >> (c & 31)) & 1))
+    {
+      pos += uart_escape(c, ts + pos);
+    }
   }
+  ts[pos] = '\0';
+  return ts;
+}
 
-  if (dread[rtr - 1] != u_com.lastchr)
-  {  // if more character to receive
-    // receive loop with timeout
-    do
+/**
+ * @brief Function to start or stop the background capture of the received characters.
+ *        The capture ring is cleared at start, the characters received before are not captured.
+ *
+ * @param on    true to start the capture
+ * @return uint8_t  Error code, UART_NOT_ENABLED if the serial port is not enabled
+ */
+uint8_t scpi_uart_capture(bool on)
+{
+  if (on)
+  {
+    if (u_com.status == 0)
     {
-      // Receive character with timeout
-      char received_char = receive_char_with_timeout(u_com.timeout_ms);
-      if (received_char != '\0')
+      return UART_NOT_ENABLED;
+    }  // if serial not enabled
+    cap.rx = uart_rx_head();
+    cap.head = 0;
+    cap.tail = 0;
+    cap.lost = 0;
+    cap.bol = true;
+    cap.on = true;
+    if (!cap.timer)
+    {
+      cap.timer = add_repeating_timer_ms(USER_CAP_DRAIN_MS, uart_cap_timer, NULL, &cap.rt);
+    }
+  }
+  else
+  {
+    uart_cap_drain();  // keep the last characters received
+    if (cap.timer)
+    {
+      cancel_repeating_timer(&cap.rt);
+      cap.timer = false;
+    }
+  }
+  cap.on = on;
+  fprintf(stdout, "Serial capture %s\n", on ? "started" : "stopped");
+  return NOCERR;
+}
+
+/**
+ * @brief function who return the state of the capture
+ *
+ * @return true if the capture is running
+ */
+bool scpi_uart_capture_state()
+{
+  return cap.on;
+}
+
+/**
+ * @brief Function to return the number of bytes captured not yet read
+ *
+ * @return uint32_t  number of bytes on the capture ring
+ */
+uint32_t scpi_uart_capture_count()
+{
+  uart_cap_drain();
+  return cap.head - cap.tail;
+}
+
+/**
+ * @brief Function to read the bytes captured, oldest first. The data is returned in two parts
+ *        when the ring wrap, the bytes are removed from the ring and must be sent before the next
+ *        capture event.
+ *
+ * @param p1    first part of the data
+ * @param n1    size of the first part
+ * @param p2    second part of the data, at the beginning of the ring
+ * @param n2    size of the second part, 0 if no wrap
+ * @return uint32_t  number of bytes lost since the start of the capture
+ */
+uint32_t scpi_uart_capture_data(const uint8_t** p1, size_t* n1, const uint8_t** p2, size_t* n2)
+{
+  uart_cap_drain();
+  uint32_t save = save_and_disable_interrupts();  // ring indexes also updated by the capture timer
+  uint32_t n = cap.head - cap.tail;
+  uint32_t start = cap.tail & (USER_CAP_SIZE - 1);
+
+  *p1 = &cap_ring[start];
+  *n1 = (n > USER_CAP_SIZE - start) ? USER_CAP_SIZE - start : n;
+  *p2 = cap_ring;
+  *n2 = n - *n1;
+  cap.tail = cap.head;
+  restore_interrupts(save);
+  return cap.lost;
+}
+
+/**
+ * @brief Background event of the serial port, called by the main loop.
+ *        The received characters are copied on the capture ring if the capture is running,
+ *        the capture timer copy them when the main loop is blocked by a command.
+ */
+void scpi_uart_event()
+{
+  uart_cap_drain();
+}
+
+/**
+ * @brief Patterns of the expect engine. Each pattern is matched incrementally on the received
+ *        characters with its failure table (Knuth-Morris-Pratt), no character is read twice.
+ */
+static struct
+{
+  uint8_t npat;                              // number of patterns
+  uint8_t len[USER_EXP_MAX];                 // length of each pattern
+  uint8_t state[USER_EXP_MAX];               // characters of each pattern matched
+  uint8_t pat[USER_EXP_MAX][USER_EXP_LEN];   // patterns
+  uint8_t fail[USER_EXP_MAX][USER_EXP_LEN];  // length of the longest prefix which is also suffix
+  uint8_t text[USER_EXP_TEXT];               // last characters received
+  size_t ntext;                              // number of characters on text
+} uexp;
+
+/**
+ * @brief Prepare the patterns of the expect engine. The alternatives are separated by '|'.
+ *
+ * @param patterns  string of the patterns with escape sequences
+ * @return uint8_t  Error code, UART_PATTERN_NOTVALID if a pattern is empty, too long or not valid
+ */
+static uint8_t uart_expect_compile(const char* patterns)
+{
+  uint8_t n = 0;
+
+  memset(uexp.len, 0, sizeof(uexp.len));
+  memset(uexp.state, 0, sizeof(uexp.state));
+  uexp.npat = 0;
+
+  while (true)
+  {
+    if (*patterns == '|' || *patterns == '\0')
+    {  // end of an alternative
+      if (uexp.len[n] == 0)
       {
-        fprintf(stdout, "Rcv chr #%d: 0x%x, %c\n", rtr, received_char, received_char);
-        dread[rtr++] = received_char;  // Store received character in dread buffer
-        start_time = time_us_32();     // reset timeout
-        if (received_char == u_com.lastchr)
-        {
-          // printf("Last char Received: 0x%x, %c\n", received_char);
-          dread[rtr] = '\0';  // Null-terminate the received string
-          return NOCERR;      // Return 1 to indicate success
-        }
+        return UART_PATTERN_NOTVALID;
       }
-      else
+      n++;
+      if (*patterns++ == '\0')
       {
-        fprintf(stdout, "Timeout occurred in Receiver.\n");
-        dread[rtr] = '\0';          // Null-terminate the received string
-        return UART_RX_TIMEOUT_MS;  // Return 0 to indicate failure due to timeout
+        break;
       }
-    } while ((rtr < rsize - 1) && (time_us_32() - start_time) < (u_com.timeout_ms * 1000));
-    dread[rtr++] = '\0';  // Null-terminate the received string
-    if (rtr >= rsize)
+      if (n >= USER_EXP_MAX)
+      {
+        return UART_PATTERN_NOTVALID;
+      }
+      continue;
+    }
+    int c = uart_unescape(&patterns);
+    if (c < 0 || uexp.len[n] >= USER_EXP_LEN)
     {
-      fprintf(stdout, "UART Receive buffer overrun, receive string too long\n");
-      return UART_BUFFER_FULL;
+      return UART_PATTERN_NOTVALID;
     }
-    else
+    uexp.pat[n][uexp.len[n]++] = c;
+  }
+
+  for (uint8_t i = 0; i < n; i++)
+  {  // failure table of each pattern
+    uint8_t k = 0;
+    uexp.fail[i][0] = 0;
+    for (uint8_t j = 1; j < uexp.len[i]; j++)
+    {
+      while (k && uexp.pat[i][j] != uexp.pat[i][k])
+      {
+        k = uexp.fail[i][k - 1];
+      }
+      if (uexp.pat[i][j] == uexp.pat[i][k])
+      {
+        k++;
+      }
+      uexp.fail[i][j] = k;
+    }
+  }
+  uexp.npat = n;
+  return NOCERR;
+}
+
+/**
+ * @brief Advance all patterns with one received character
+ *
+ * @param c     character received
+ * @return uint8_t  number of the pattern found (1 to n), 0 if no pattern found
+ */
+static uint8_t uart_expect_step(uint8_t c)
+{
+  for (uint8_t i = 0; i < uexp.npat; i++)
+  {
+    uint8_t k = uexp.state[i];
+    while (k && uexp.pat[i][k] != c)
+    {
+      k = uexp.fail[i][k - 1];
+    }
+    if (uexp.pat[i][k] == c)
+    {
+      k++;
+    }
+    if (k == uexp.len[i])
+    {
+      return i + 1;
+    }
+    uexp.state[i] = k;
+  }
+  return 0;
+}
+
+/**
+ * @brief Function to wait for one of the patterns on the received characters. The characters not
+ *        read since the last command are used first, the characters written by
+ *        COM:SERIAL:Write before are not lost.
+ *
+ * @param patterns   patterns separated by '|', with escape sequences (\r, \n, \t, \\, \| and \xHH)
+ * @param timeout_ms maximum time to wait for a pattern
+ * @param match      number of the pattern found (1 to n), 0 on timeout
+ * @param text       last characters received, with escape sequences
+ * @param size       size of text
+ * @return uint8_t   Error code to success or error, timeout is not an error
+ */
+uint8_t scpi_uart_expect(const char* patterns, uint32_t timeout_ms, uint8_t* match, char* text, size_t size)
+{
+  uint8_t err;
+
+  *match = 0;
+  text[0] = '\0';
+  if (u_com.status == 0)
+  {
+    return UART_NOT_ENABLED;
+  }  // if serial not enabled
+
+  err = uart_expect_compile(patterns);
+  if (err != NOCERR)
+  {
+    return err;
+  }
+
+  uexp.ntext = 0;
+  uint64_t start = time_us_64();
+  while (*match == 0)
+  {
+    int c = uart_rx_getc();
+    if (c < 0)
     {
-      fprintf(stdout, "Lastchar never received, waiting for 0x%x\n", u_com.lastchr);
-      return UART_LASTCHAR_TIMEOUT_MS;
+      if (time_us_64() - start >= (uint64_t)timeout_ms * 1000)
+      {
+        break;
+      }
+      uart_cap_drain();
+      watchdog_update();  // the wait could be longer than the watchdog
+      continue;
+    }
+    if (uexp.ntext == USER_EXP_TEXT)
+    {  // keep the last characters
+      memmove(uexp.text, uexp.text + 1, USER_EXP_TEXT - 1);
+      uexp.ntext--;
     }
+    uexp.text[uexp.ntext++] = c;
+    *match = uart_expect_step(c);
   }
 
-  return NOCERR;  // return no error
-}
\ No newline at end of file
+  // last characters which fit on text with escape sequences
+  char esc[5];
+  size_t i = uexp.ntext, lgt = 0;
+  while (i > 0 && lgt + uart_escape(uexp.text[i - 1], esc) < size)
+  {
+    lgt += uart_escape(uexp.text[--i], esc);
+  }
+  for (lgt = 0; i < uexp.ntext; i++)
+  {
+    lgt += uart_escape(uexp.text[i], text + lgt);
+  }
+
+  fprintf(stdout, "Serial expect %s, pattern: %d in %" PRIu32 " ms\n", *match ? "found" : "timeout", *match,
+          (uint32_t)((time_us_64() - start) / 1000));
+  return NOCERR;
+}
+
+/**
+ * @brief Function to run a dialogue: wait for a pattern, send a string, wait for the next pattern...
+ *        The dialogue stop on the first pattern not found.
+ *
+ * @param steps      pattern and string to send alternated, an empty pattern does not wait
+ * @param nsteps     number of steps
+ * @param timeout_ms maximum time to wait for each pattern
+ * @param done       number of pairs (pattern, string) done
+ * @param match      number of the last pattern found (1 to n), 0 on timeout
+ * @param text       last characters received of the last pattern, with escape sequences
+ * @param size       size of text
+ * @return uint8_t   Error code to success or error, timeout is not an error
+ */
+uint8_t scpi_uart_expect_script(const char* const steps[], size_t nsteps, uint32_t timeout_ms, uint8_t* done,
+                                uint8_t* match, char* text, size_t size)
+{
+  char send[USER_SEND_MAX + 1];
+  uint8_t err = NOCERR;
+
+  *done = 0;
+  *match = 0;
+  text[0] = '\0';
+
+  for (size_t i = 0; i < nsteps && err == NOCERR; i++)
+  {
+    if (i % 2 == 0)
+    {  // pattern
+      if (steps[i][0] != '\0')
+      {
+        err = scpi_uart_expect(steps[i], timeout_ms, match, text, size);
+        if (*match == 0)
+        {
+          break;
+        }
+      }
+    }
+    else
+    {  // string to send
+      const char* s = steps[i];
+      size_t n = 0;
+      while (*s && n < USER_SEND_MAX)
+      {
+        int c = uart_unescape(&s);
+        if (c < 0)
+        {
+          return UART_PATTERN_NOTVALID;
+        }
+        send[n++] = c;
+      }
+      if (*s)
+      {
+        return UART_PATTERN_NOTVALID;
+      }  // string too long
+      send[n] = '\0';
+      err = scpi_uart_write_data(send);
+    }
+    if (err == NOCERR && (i % 2 == 1 || i == nsteps - 1))
+    {
+      (*done)++;  // pair completed
+    }
+  }
+  fprintf(stdout, "Serial script %d steps done\n", *done);
+  return err;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file    sweep.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   DAC sweep with ADC measure (curve tracer)
+ *
+ * @details The DAC is stepped from the start to the stop voltage with fast mode writes.
+ *          After the dwell time of each step, ADC0 and ADC1 are read and optionally the current
+ *          of the INA219. The points are kept as raw values on a table returned as one
+ *          binary block, the host converts the codes.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/watchdog.h"
+#include "include/functadv.h"
+#include "include/adc_acq.h"
+#include "include/wave_gen.h"
+#include "include/sweep.h"
+#include "pico_lib2/src/dev/dev_ina219/dev_ina219.h"
+#include "pico_lib2/src/dev/dev_mcp4725/dev_mcp4725.h"
+
+#define SWEEP_ACQ_WAIT_US (1000000 * ADC_ACQ_NB_CH / ADC_ACQ_RATE)  // one round robin of the free running acquisition
+
+/**
+ * @brief Settings and result of the sweep.
+ */
+static struct
+{
+  q16_t start;                           // start voltage
+  q16_t stop;                            // stop voltage
+  uint32_t points;                       // number of steps
+  uint32_t dwell_us;                     // time between DAC write and measure
+  bool current;                          // INA219 current measured
+  sweep_point_t data[SWEEP_MAX_POINTS];  // result of the last sweep
+} sw = {.start = SWEEP_DEF_START, .stop = SWEEP_DEF_STOP, .points = SWEEP_DEF_POINTS, .dwell_us = SWEEP_DEF_DWELL_US};
+
+/**
+ * @brief Set the start voltage
+ *
+ * @param volt      Voltage (MINDACVOLT to MAXDACVOLT)
+ * @return uint8_t  NOERR or EOOR
+ */
+uint8_t sweep_set_start(q16_t volt)
+{
+  if (volt < Q16(MINDACVOLT) || volt > Q16(MAXDACVOLT)) return EOOR;
+  sw.start = volt;
+  return NOERR;
+}
+
+/**
+ * @brief Return the start voltage
+ *
+ * @return q16_t  Voltage
+ */
+q16_t sweep_get_start(void)
+{
+  return sw.start;
+}
+
+/**
+ * @brief Set the stop voltage, could be lower than start for a descending sweep
+ *
+ * @param volt      Voltage (MINDACVOLT to MAXDACVOLT)
+ * @return uint8_t  NOERR or EOOR
+ */
+uint8_t sweep_set_stop(q16_t volt)
+{
+  if (volt < Q16(MINDACVOLT) || volt > Q16(MAXDACVOLT)) return EOOR;
+  sw.stop = volt;
+  return NOERR;
+}
+
+/**
+ * @brief Return the stop voltage
+ *
+ * @return q16_t  Voltage
+ */
+q16_t sweep_get_stop(void)
+{
+  return sw.stop;
+}
+
+/**
+ * @brief Set the number of steps, start and stop included
+ *
+ * @param points    Number of steps (SWEEP_MIN_POINTS to SWEEP_MAX_POINTS)
+ * @return uint8_t  NOERR or EOOR
+ */
+uint8_t sweep_set_points(uint32_t points)
+{
+  if (points < SWEEP_MIN_POINTS || points > SWEEP_MAX_POINTS) return EOOR;
+  sw.points = points;
+  return NOERR;
+}
+
+/**
+ * @brief Return the number of steps
+ *
+ * @return uint32_t  Number of steps
+ */
+uint32_t sweep_get_points(void)
+{
+  return sw.points;
+}
+
+/**
+ * @brief Set the dwell time between the DAC write and the measure
+ *
+ * @param dwell_us  Time in us (0 to SWEEP_MAX_DWELL_US)
+ * @return uint8_t  NOERR or EOOR
+ */
+uint8_t sweep_set_dwell(uint32_t dwell_us)
+{
+  if (dwell_us > SWEEP_MAX_DWELL_US) return EOOR;
+  sw.dwell_us = dwell_us;
+  return NOERR;
+}
+
+/**
+ * @brief Return the dwell time
+ *
+ * @return uint32_t  Time in us
+ */
+uint32_t sweep_get_dwell(void)
+{
+  return sw.dwell_us;
+}
+
+/**
+ * @brief Select the measure of the INA219 current on each step
+ *
+ * @param enable  True to measure the current
+ */
+void sweep_set_current(bool enable)
+{
+  sw.current = enable;
+}
+
+/**
+ * @brief Return the measure of the INA219 current
+ *
+ * @return true  Current measured on each step
+ */
+bool sweep_get_current(void)
+{
+  return sw.current;
+}
+
+/**
+ * @brief Read a raw ADC input, from the free running acquisition if it is running
+ *
+ * @param channel    ADC input (0 or 1)
+ * @param free_run   Free running acquisition is running
+ * @return uint16_t  12 bits ADC value
+ */
+static uint16_t sweep_adc(uint8_t channel, bool free_run)
+{
+  if (free_run) return adc_acq_last(channel);
+
+  adc_select_input(channel);
+  return adc_read();
+}
+
+/**
+ * @brief Execute the sweep. The DAC stay on the stop voltage at the end.
+ *
+ * @param data      Table of points of the sweep
+ * @param points    Number of points
+ * @return uint8_t  NOERR, EDE if the ADC is used by a capture or on DAC error
+ */
+uint8_t sweep_run(const sweep_point_t** data, uint32_t* points)
+{
+  uint16_t code_start = dac_volt_to_code(sw.start);
+  uint16_t code_stop = dac_volt_to_code(sw.stop);
+  int32_t span = (int32_t)code_stop - code_start;
+  bool free_run = adc_acq_running();
+  int32_t den = sw.points - 1;
+  int32_t num;
+  uint32_t t0 = time_us_32();
+  uint8_t state = adc_cap_state();
+  ina219_meas_t m;
+  sweep_point_t* pt;
+
+  if (state == ADC_CAP_ARMED || state == ADC_CAP_TRIGGERED) return EDE;  // ADC used by a capture
+
+  wave_stop();  // DAC used by the sweep
+
+  for (uint32_t i = 0; i < sw.points; i++)
+  {
+    watchdog_update();  // sweep could be longer than the watchdog, one step is less than 1.1 s
+    pt = &sw.data[i];
+    num = span * (int32_t)i;  // linear step on DAC code, rounded
+    pt->dac = code_start + (num + ((num < 0) ? -den / 2 : den / 2)) / den;
+    if (!dev_mcp4725_set_fast(i2c0, MCP4725_ADDR0, pt->dac))
+    {
+      fprintf(stdout, "Sweep, DAC error on step %lu\n", i);
+      return EDE;
+    }
+
+    if (sw.dwell_us) sleep_us(sw.dwell_us);
+    if (free_run) sleep_us(SWEEP_ACQ_WAIT_US);  // samples converted after the dwell
+
+    pt->adc0 = sweep_adc(0, free_run);
+    pt->adc1 = sweep_adc(1, free_run);
+    pt->current_ua = 0;
+    if (sw.current && ina219ReadMeas(&m, true)) pt->current_ua = m.current_ua;
+  }
+
+  fprintf(stdout, "Sweep of %lu points done in %lu us\n", sw.points, time_us_32() - t0);
+  *data = sw.data;
+  *points = sw.points;
+  return NOERR;
+}
@@ -212,44 +212,46 @@ struct TestResult
 void test_cmd_result(const char* title, const char* cmd, float expect_value, const char* unit, float lo_limit, float hi_limit,
                      struct TestResult* counter, CircularBuffer* buffer)
 {
-  float readv;
-  float hl, ll;
+  q16_t readv;
+  q16_t hl, ll;
   char message[MESSAGE_LENGTH];
+  char vtxt[16], ltxt[16], htxt[16];
 
   counter->total++;       // increment counter
   output_buffer_clear();  // clear result before capture output
   watchdog_update();      /** refresh watchdog */
 
   SCPI_Input(&scpi_context, cmd, strlen(cmd)); /** Send command to SCPI engine*/
-  // transform string received from command to number
-  do
+  // transform string received from command to fixed point number
+  if (!q16_parse(out_buffer, strlen(out_buffer), &readv))
   {
-    if (sscanf((out_buffer), "%f", &(readv)) != 1)
-    {
-      fprintf(stderr, "\t ERROR converting buffer to float, rvalue: %s\n", out_buffer);
-      (readv) = -99.99;
-      counter->error++;
-    }
-  } while (0);
+    fprintf(stderr, "\t ERROR converting buffer to number, rvalue: %s\n", out_buffer);
+    readv = Q16(-99.99);
+    counter->error++;
+  }
 
   // on ADC measure,multiplication of value by 2 is required due to voltage divider on selftest board
   if (strstr(cmd, "ADC0") != NULL || strstr(cmd, "ADC1") != NULL)
   {
     readv = readv * 2;
   }
-  hl = expect_value + hi_limit;
-  ll = expect_value - lo_limit;
+  hl = q16_from_float(expect_value + hi_limit);
+  ll = q16_from_float(expect_value - lo_limit);
+
+  q16_format(vtxt, sizeof(vtxt), readv, 2);
+  q16_format(ltxt, sizeof(ltxt), ll, 2);
+  q16_format(htxt, sizeof(htxt), hl, 2);
 
   if (readv > hl || readv < ll)
   {
-    snprintf(message, MESSAGE_LENGTH, "%s  ---> FAIL  VAL:%.2f %s, LL:%.2f, HL:%.2f ", title, readv, unit, ll, hl);
+    snprintf(message, MESSAGE_LENGTH, "%s  ---> FAIL  VAL:%s %s, LL:%s, HL:%s ", title, vtxt, unit, ltxt, htxt);
     fprintf(stdout, "%s\n", message);
     add_message(buffer, message);
     counter->bad++;
   }
   else
   {
-    fprintf(stdout, "%s  ---> PASS  VAL:%.2f %s, LL:%.2f, HL:%.2f  \n", title, readv, unit, ll, hl);
+    fprintf(stdout, "%s  ---> PASS  VAL:%s %s, LL:%s, HL:%s  \n", title, vtxt, unit, ltxt, htxt);
     counter->good++;
   }
 }
@@ -512,14 +514,14 @@ uint8_t test_selftest(char* testboard_num, uint8_t run)
   uart_puts(UART_ID, strval);                      // Send result
 
   /** Read 1-wire to detect if the selftest board is connected to interconnect IO*/
-  char* strdata = NULL;
+  char strdata[ONEWIRE_INFO_SIZE];
 
   // if testboard value >= 2, the selftest will run only if the 1-wire number match with
   // the testboard number.
 
   if (run >= 2)
   {
-    result = onewire_read_info(&strdata, ADDR_INFO, NB_INFO, 1);
+    result = onewire_read_info(strdata, sizeof(strdata), ADDR_INFO, NB_INFO, 1);
     fprintf(stdout, "\tSelftest 1-wire: %s\n", strdata);  // send message to debug port
                                                           // Use strstr to find the substring
     char* pos = strstr(strdata, testboard_num);
@@ -644,9 +646,11 @@ uint8_t test_selftest(char* testboard_num, uint8_t run)
   test_cmd_result("Test 5.2: PWR Module check current on 10 ohm(R2), read I(mA):", "ANA:PWR:I? \n", 500, "mA", 50, 50, &c_test, &buffer);
 
   // Perform Calibration of the PWR module INA219
-  float readv;                                           // contains the current value read from last command
-  sscanf((out_buffer), "%f", &(readv));                  // transform string in output_buffer to float number
-  sprintf(strval, "ANAlog:PWR:Cal %.2f, 500\n", readv);  // build calibration string to be used as command
+  q16_t readv = 0;                                       // contains the current value read from last command
+  char rtxt[16];                                         // value as text
+  q16_parse(out_buffer, strlen(out_buffer), &readv);     // transform string in output_buffer to fixed point number
+  q16_format(rtxt, sizeof(rtxt), readv, 2);              // text used on command
+  sprintf(strval, "ANAlog:PWR:Cal %s, 500\n", rtxt);     // build calibration string to be used as command
   TEST_SCPI_INPUT(strval);                               // send command
   test_cmd_result("Test 5.3: PWR Module check current on 10 ohm(R2), read I(mA):", "ANA:PWR:I? \n", 500, "mA", 5, 5, &c_test, &buffer);
   TEST_SCPI_INPUT("GPIO:OUT:DEV1:GP18  0 \n");  // Open K4
@@ -2117,8 +2121,8 @@ int onewiretest()
   const char* bd_test2 = "2D4CE282200000CC, 12345678,J1";
   const char* bd_test22 = "2DC1C38220000059, ABCDEFGH, J2";
 
-  char* owid = NULL;
-  valid = onewire_read_info(&owid, ADDR_TEST, NB_TEST, 1);
+  char owid[ONEWIRE_INFO_SIZE];
+  valid = onewire_read_info(owid, sizeof(owid), ADDR_TEST, NB_TEST, 1);
   if (valid != 0)
   {
     fprintf(stdout, "\nERROR READ 1-WIRE, error # %d:\n", valid);
@@ -2129,17 +2133,16 @@ int onewiretest()
   onewire_write_info(bd_test2, ADDR_TEST);
   onewire_write_info(bd_test22, ADDR_TEST);
   fprintf(stdout, "\nREAD TEST AFTER:\n");
-  onewire_read_info(&owid, ADDR_TEST, NB_TEST, 1);
+  onewire_read_info(owid, sizeof(owid), ADDR_TEST, NB_TEST, 1);
 
   fprintf(stdout, "\nRESULT TEST:\n");
   SCPI_ResultText(&scpi_context, owid);
 
   onewire_write_info(bd_info2, ADDR_INFO);
   fprintf(stdout, "\nREAD INFO:\n");
-  onewire_read_info(&owid, ADDR_INFO, NB_INFO, 1);
+  onewire_read_info(owid, sizeof(owid), ADDR_INFO, NB_INFO, 1);
   fprintf(stdout, "\nRESULT INFO:\n");
   SCPI_ResultText(&scpi_context, owid);
-  free(owid);
   return 0;
 }
 
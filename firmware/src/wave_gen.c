@@ -0,0 +1,375 @@
+/**
+ * @file    wave_gen.c
+ * @author  Daniel Lockhead
+ * @date    2024
+ *
+ * @brief   Waveform generator on the MCP4725 DAC
+ *
+ * @details A table of DAC codes is built for the selected function (sine, ramp, square or
+ *          arbitrary codes loaded by command). A timer reads the table with a phase accumulator
+ *          and starts a 2 bytes fast mode write of the DAC with an asynchronous I2C frame.
+ *          The sample is skipped when the internal I2C bus is used by a command or another frame,
+ *          the phase follows the time so the frequency is kept.
+ *
+ * @copyright Copyright (c) 2024, D.Lockhead. All rights reserved.
+ *
+ * This software is licensed under the BSD 3-Clause License.
+ * See the LICENSE file for more details.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "include/functadv.h"
+#include "include/wave_gen.h"
+#include "pico_lib2/src/sys/include/sys_i2c.h"
+#include "pico_lib2/src/sys/include/sys_i2c_async.h"
+#include "pico_lib2/src/dev/dev_mcp4725/dev_mcp4725.h"
+
+#define WAVE_NO_CODE 0xFFFF  // no code written on the DAC
+
+// First quarter of sine, 64 steps, Q15
+static const int16_t sin_quarter[65] = {
+    0,     804,   1608,  2410,  3212,  4011,  4808,  5602,  6393,  7179,  7962,  8739,  9512,
+    10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530, 18204, 18868,
+    19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319,
+    26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571, 30852, 31113,
+    31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757, 32767,
+};
+
+/**
+ * @brief State of the waveform generator.
+ */
+static struct
+{
+  repeating_timer_t timer;          // sampling timer
+  bool running;                     // timer active
+  uint8_t func;                     // WAVE_xxx
+  q16_t freq;                       // frequency in Hz
+  q16_t ampl;                       // amplitude in Vpp
+  q16_t offset;                     // offset in V
+  uint32_t phase;                   // phase accumulator, one period = 2^32
+  uint32_t step;                    // phase increment per sample
+  uint16_t table[WAVE_MAX_POINTS];  // DAC codes played
+  uint16_t len;                     // number of codes on table
+  uint16_t arb[WAVE_MAX_POINTS];    // arbitrary codes loaded by command
+  uint16_t arb_len;                 // number of arbitrary codes
+  uint16_t last;                    // last code written
+  uint8_t buf[2];                   // fast mode frame
+  volatile bool busy;               // frame on the bus
+  uint32_t sent;                    // samples written
+  uint32_t skip;                    // samples skipped, bus used
+  uint32_t error;                   // frames in error
+} wg = {.func = WAVE_OFF, .freq = WAVE_DEF_FREQ, .ampl = WAVE_DEF_AMPL, .offset = WAVE_DEF_OFFSET};
+
+/**
+ * @brief End of frame, called from I2C interrupt
+ */
+static void wave_done(i2c_inst_t* i2c, uint8_t addr, int32_t status, void* user)
+{
+  if (status < 0)
+  {
+    wg.error++;
+    wg.last = WAVE_NO_CODE;  // write again on next sample
+  }
+  else
+  {
+    wg.sent++;
+  }
+  wg.busy = false;
+}
+
+/**
+ * @brief Timer callback, write the sample of the phase if the bus is free
+ *
+ * @param rt      Repeating timer
+ * @return true   Timer continue
+ */
+static bool wave_timer(repeating_timer_t* rt)
+{
+  uint16_t code;
+
+  wg.phase += wg.step;  // phase follows the time, even if the sample is skipped
+  code = wg.table[((wg.phase >> 16) * wg.len) >> 16];
+  if (code == wg.last) return true;  // DAC already on this code
+
+  if (wg.busy || !sys_i2c_async_try_begin(i2c0, MCP4725_ADDR0))
+  {
+    wg.skip++;  // bus used by a command, sample on next period
+    return true;
+  }
+
+  wg.busy = true;
+  sys_i2c_async_write(i2c0, wg.buf, dev_mcp4725_fast_buf(code, wg.buf), true);
+  if (sys_i2c_async_start(i2c0, wave_done, NULL) != PICO_OK)
+  {
+    wg.error++;
+    wg.busy = false;
+    return true;
+  }
+  wg.last = code;
+  return true;
+}
+
+/**
+ * @brief Convert a level of the waveform to DAC code, amplitude and offset applied
+ *
+ * @param w          Level -1.0 to 1.0 on Q15
+ * @return uint16_t  DAC code
+ */
+static uint16_t wave_level(int32_t w)
+{
+  return dac_volt_to_code(wg.offset + (q16_t)(((int64_t)(wg.ampl / 2) * w) >> 15));
+}
+
+/**
+ * @brief Build the table of DAC codes of the function
+ */
+static void wave_build(void)
+{
+  uint16_t i, q;
+
+  switch (wg.func)
+  {
+    case WAVE_SIN:
+      for (i = 0; i < WAVE_STD_POINTS; i++)
+      {
+        q = i & 63;
+        switch (i >> 6)
+        {  // quadrant
+          case 0:
+            wg.table[i] = wave_level(sin_quarter[q]);
+            break;
+          case 1:
+            wg.table[i] = wave_level(sin_quarter[64 - q]);
+            break;
+          case 2:
+            wg.table[i] = wave_level(-sin_quarter[q]);
+            break;
+          default:
+            wg.table[i] = wave_level(-sin_quarter[64 - q]);
+            break;
+        }
+      }
+      wg.len = WAVE_STD_POINTS;
+      break;
+
+    case WAVE_RAMP:
+      for (i = 0; i < WAVE_STD_POINTS; i++)
+      {
+        wg.table[i] = wave_level(-32767 + (int32_t)i * 65534 / (WAVE_STD_POINTS - 1));
+      }
+      wg.len = WAVE_STD_POINTS;
+      break;
+
+    case WAVE_SQUARE:
+      wg.table[0] = wave_level(32767);
+      wg.table[1] = wave_level(-32767);
+      wg.len = 2;
+      break;
+
+    case WAVE_ARB:
+      memcpy(wg.table, wg.arb, wg.arb_len * sizeof(uint16_t));
+      wg.len = wg.arb_len;
+      break;
+  }
+}
+
+/**
+ * @brief Stop the timer, wait end of frame on the bus
+ */
+static void wave_halt(void)
+{
+  if (!wg.running) return;
+
+  cancel_repeating_timer(&wg.timer);
+  wg.running = false;
+  while (wg.busy)
+  {
+    sys_i2c_async_wait(i2c0);  // deadline of the frame is checked by wait
+  }
+}
+
+/**
+ * @brief Build the table and start the timer if a function is selected
+ *
+ * @return uint8_t  NOERR or EDE if no timer available
+ */
+static uint8_t wave_run(void)
+{
+  wave_halt();
+  if (wg.func == WAVE_OFF) return NOERR;
+
+  wave_build();
+  wg.step = (uint32_t)(((uint64_t)wg.freq << 16) / WAVE_RATE);
+  wg.last = WAVE_NO_CODE;
+  wg.running = add_repeating_timer_us(-WAVE_SAMPLE_US, wave_timer, NULL, &wg.timer);
+  if (!wg.running)
+  {
+    wg.func = WAVE_OFF;
+    return EDE;
+  }
+  return NOERR;
+}
+
+/**
+ * @brief Select the function of the generator. The generator start on any function except WAVE_OFF
+ *
+ * @param func      WAVE_xxx
+ * @return uint8_t  NOERR, EOOR if function unknown, EMP if no arbitrary code loaded, EDE if no timer
+ */
+uint8_t wave_set_func(uint8_t func)
+{
+  if (func > WAVE_ARB) return EOOR;
+  if (func == WAVE_ARB && wg.arb_len == 0) return EMP;
+
+  if (func == WAVE_OFF)
+  {
+    wave_stop();
+    return NOERR;
+  }
+
+  wg.func = func;
+  wg.sent = wg.skip = wg.error = 0;
+  fprintf(stdout, "DAC waveform %d started\n", func);
+  return wave_run();
+}
+
+/**
+ * @brief Return the function of the generator
+ *
+ * @return uint8_t  WAVE_xxx
+ */
+uint8_t wave_get_func(void)
+{
+  return wg.func;
+}
+
+/**
+ * @brief Set the frequency, applied immediately if the generator is running
+ *
+ * @param freq      Frequency in Hz (WAVE_MIN_FREQ to WAVE_MAX_FREQ)
+ * @return uint8_t  NOERR or EOOR
+ */
+uint8_t wave_set_freq(q16_t freq)
+{
+  if (freq < WAVE_MIN_FREQ || freq > WAVE_MAX_FREQ) return EOOR;
+
+  wg.freq = freq;
+  wg.step = (uint32_t)(((uint64_t)wg.freq << 16) / WAVE_RATE);  // 32 bits write, used as is by the timer
+  return NOERR;
+}
+
+/**
+ * @brief Return the frequency
+ *
+ * @return q16_t  Frequency in Hz
+ */
+q16_t wave_get_freq(void)
+{
+  return wg.freq;
+}
+
+/**
+ * @brief Set the amplitude, the table is rebuilt if the generator is running
+ *
+ * @param ampl      Amplitude peak to peak in V (0 to MAXDACVOLT)
+ * @return uint8_t  NOERR, EOOR or EDE
+ */
+uint8_t wave_set_ampl(q16_t ampl)
+{
+  if (ampl < 0 || ampl > Q16(MAXDACVOLT)) return EOOR;
+
+  wg.ampl = ampl;
+  return wg.running ? wave_run() : NOERR;
+}
+
+/**
+ * @brief Return the amplitude
+ *
+ * @return q16_t  Amplitude peak to peak in V
+ */
+q16_t wave_get_ampl(void)
+{
+  return wg.ampl;
+}
+
+/**
+ * @brief Set the offset (middle level), the table is rebuilt if the generator is running.
+ *        Levels outside of the DAC range are limited.
+ *
+ * @param offset    Offset in V (0 to MAXDACVOLT)
+ * @return uint8_t  NOERR, EOOR or EDE
+ */
+uint8_t wave_set_offset(q16_t offset)
+{
+  if (offset < Q16(MINDACVOLT) || offset > Q16(MAXDACVOLT)) return EOOR;
+
+  wg.offset = offset;
+  return wg.running ? wave_run() : NOERR;
+}
+
+/**
+ * @brief Return the offset
+ *
+ * @return q16_t  Offset in V
+ */
+q16_t wave_get_offset(void)
+{
+  return wg.offset;
+}
+
+/**
+ * @brief Load arbitrary DAC codes, 16 bits little endian, 0 to 4095.
+ *        The table is rebuilt if the arbitrary function is running.
+ *
+ * @param data      Codes received
+ * @param len       Number of bytes
+ * @param append    Codes added after the codes already loaded
+ * @return uint8_t  NOERR, ECE if odd number of bytes, EOOR if code or size out of range
+ */
+uint8_t wave_arb_load(const uint8_t* data, size_t len, bool append)
+{
+  uint32_t start = append ? wg.arb_len : 0;
+  uint16_t code;
+
+  if (len & 1) return ECE;
+  if (start + len / 2 > WAVE_MAX_POINTS) return EOOR;
+
+  for (size_t i = 0; i < len; i += 2)
+  {
+    code = data[i] | (data[i + 1] << 8);
+    if (code > 4095) return EOOR;
+  }
+
+  for (size_t i = 0; i < len; i += 2)
+  {
+    wg.arb[start + i / 2] = data[i] | (data[i + 1] << 8);
+  }
+  wg.arb_len = start + len / 2;
+
+  return (wg.running && wg.func == WAVE_ARB) ? wave_run() : NOERR;
+}
+
+/**
+ * @brief Return the number of arbitrary codes loaded
+ *
+ * @return uint32_t  Number of codes
+ */
+uint32_t wave_arb_points(void)
+{
+  return wg.arb_len;
+}
+
+/**
+ * @brief Stop the generator, the DAC is set to the offset
+ */
+void wave_stop(void)
+{
+  if (!wg.running) return;
+
+  wave_halt();
+  wg.func = WAVE_OFF;
+  dev_mcp4725_set_fast(i2c0, MCP4725_ADDR0, dac_volt_to_code(wg.offset));
+  fprintf(stdout, "DAC waveform stopped: %lu samples, %lu skipped, %lu errors\n", wg.sent, wg.skip, wg.error);
+}